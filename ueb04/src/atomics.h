@@ -0,0 +1,41 @@
+#ifndef __ATOMICS_H__
+#define __ATOMICS_H__
+/**
+ * @file
+ * Schnittstelle fuer atomare Zugriffe.
+ * Makros fuer den Austausch einzelner Werte zwischen den Threads des
+ * Programms (Worker, Simulation, Export, Texturlader und GLUT-Thread).
+ * Geladen wird mit acquire-, geschrieben mit release-Semantik. Ohne GCC-kompatiblen
+ * Compiler laufen Simulation und Export nicht auf eigenen Threads (siehe
+ * simulationThread.c und heightExport.c), die Makros greifen dann einfach
+ * direkt zu.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+#ifdef __GNUC__
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_EXCHANGE(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#define ATOMIC_ADD_FETCH(p, v) __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+#else
+#define ATOMIC_LOAD(p) (*(p))
+#define ATOMIC_STORE(p, v) (*(p) = (v))
+#define ATOMIC_EXCHANGE(p, v) exchangeUnsynchronized((p), (v))
+#define ATOMIC_ADD_FETCH(p, v) (*(p) += (v))
+
+/**
+ * Tauscht einen Wert ohne Synchronisation, nur fuer Uebersetzungen ohne Threads
+ * @param target zu tauschender Wert (In/Out)
+ * @param value neuer Wert
+ * @return alter Wert
+ */
+static __inline unsigned int exchangeUnsynchronized(unsigned int *target, unsigned int value)
+{
+  unsigned int old = *target;
+  *target = value;
+  return old;
+}
+#endif
+
+#endif
@@ -0,0 +1,301 @@
+/**
+ * @file
+ * Checkpoint-Modul.
+ * Das Modul sichert den Zustand der Wassersimulation in eine Datei und stellt
+ * ihn daraus wieder her. Auf einen Kopf fester Groesse folgen ab einer
+ * Seitengrenze die Hoehen und Geschwindigkeiten genau im Speicherlayout der
+ * Simulation (inkl. Geisterrand). Zum Laden wird die Datei daher nur
+ * eingeblendet (mmap) und geprueft, ohne Parsen und ohne Zwischenpuffer.
+ * Die Felder werden anschliessend zeilenweise aus der Einblendung in die
+ * Felder der Simulation kopiert; das Laden ist also eine gepruefte Kopie mit
+ * linearem Aufwand in der Anzahl der Punkte, kein Einblenden der Felder
+ * selbst.
+ *
+ * Gesichert wird in zwei Schritten: der Zustand wird bei angehaltener
+ * Simulation in einen Puffer kopiert, ein Hintergrund-Thread schreibt diesen
+ * in eine temporaere Datei und benennt sie erst danach um, sodass nie ein
+ * halb geschriebener Checkpoint entsteht.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* ---- Eigene Header einbinden ---- */
+#include "checkpoint.h"
+#include "logic.h"
+#include "scene.h"
+#include "simulationThread.h"
+
+/** Kennung am Anfang jeder Checkpoint-Datei */
+#define CHECKPOINT_MAGIC "UEB04CKP"
+
+/** Version des Dateiformats, bei Aenderungen am Kopf oder Layout erhoehen */
+#define CHECKPOINT_FORMAT_VERSION (1)
+
+/** Beginn der Felder in der Datei (Seitengrenze, damit sie in der Einblendung ausgerichtet liegen) */
+#define CHECKPOINT_DATA_OFFSET (4096)
+
+/** Groesste SIMD-Breite, auf deren Vielfaches die Zeilen eines Checkpoints aufgerundet sein koennen */
+#define CHECKPOINT_MAX_ROW_ALIGNMENT (8)
+
+/** Voreingestellte Datei fuer Checkpoints */
+#define CHECKPOINT_DEFAULT_FILE "ueb04.checkpoint"
+
+/** Kopf einer Checkpoint-Datei */
+typedef struct
+{
+  char magic[8];
+  GLuint formatVersion;
+  GLuint dataOffset;
+  SimulationState state;
+  GLint boatCount;
+  CGVector3f boats[AMOUNT_BOATS];
+} CheckpointHeader;
+
+/** Datei, in die gesichert und aus der geladen wird */
+static const char *g_checkpointFile = CHECKPOINT_DEFAULT_FILE;
+
+/** Zu schreibender Inhalt der Datei (Kopf und Felder) */
+static char *g_writeBuffer = NULL;
+
+/** Groesse des zu schreibenden Inhalts in Byte */
+static size_t g_writeSize = 0;
+
+#ifndef WIN32
+/** Thread, der den Checkpoint schreibt */
+static pthread_t g_writer;
+
+/** Laeuft gerade ein Schreibvorgang? */
+static GLboolean g_writing = GL_FALSE;
+#endif
+
+/**
+ * Schreibt den Puffer in eine temporaere Datei und benennt diese um
+ * @param arg unbenutzt
+ * @return immer NULL
+ */
+static void *writeCheckpoint(void *arg)
+{
+  char tempFile[FILENAME_MAX];
+  FILE *file = NULL;
+  GLboolean written = GL_FALSE;
+
+  snprintf(tempFile, sizeof(tempFile), "%s.tmp", g_checkpointFile);
+  file = fopen(tempFile, "wb");
+  if (file != NULL)
+  {
+    written = fwrite(g_writeBuffer, 1, g_writeSize, file) == g_writeSize;
+    written = (fclose(file) == 0) && written;
+  }
+
+  if (!written || (rename(tempFile, g_checkpointFile) != 0))
+  {
+    fprintf(stderr, "Checkpoint konnte nicht nach %s geschrieben werden\n", g_checkpointFile);
+    remove(tempFile);
+  }
+
+  free(g_writeBuffer);
+  g_writeBuffer = NULL;
+  return NULL;
+}
+
+/**
+ * Blendet eine Datei nur lesend in den Speicher ein (ohne mmap: liest sie ein)
+ * @param path Pfad der Datei
+ * @param size Groesse der Datei in Byte (Out)
+ * @return Inhalt der Datei, NULL bei Fehler
+ */
+static const char *mapFile(const char *path, size_t *size)
+{
+#ifndef WIN32
+  const char *data = NULL;
+  struct stat info;
+  int file = open(path, O_RDONLY);
+
+  if (file < 0)
+  {
+    return NULL;
+  }
+  if ((fstat(file, &info) == 0) && (info.st_size > 0))
+  {
+    *size = (size_t)info.st_size;
+    data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (data == MAP_FAILED)
+    {
+      data = NULL;
+    }
+  }
+  //die Einblendung bleibt auch nach dem Schliessen erhalten
+  close(file);
+  return data;
+#else
+  char *data = NULL;
+  FILE *file = fopen(path, "rb");
+
+  if (file == NULL)
+  {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  data = malloc(*size);
+  if ((data != NULL) && (fread(data, 1, *size, file) != *size))
+  {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+#endif
+}
+
+/**
+ * Gibt eine mit mapFile eingeblendete Datei wieder frei
+ * @param data Inhalt der Datei
+ * @param size Groesse der Datei in Byte
+ */
+static void unmapFile(const char *data, size_t size)
+{
+#ifndef WIN32
+  munmap((void *)data, size);
+#else
+  (void)size;
+  free((void *)data);
+#endif
+}
+
+void setCheckpointFile(const char *path)
+{
+  finishCheckpoint();
+  g_checkpointFile = path;
+}
+
+void saveCheckpoint(void)
+{
+  CheckpointHeader header;
+  size_t fieldSize = 0;
+  GLfloat *fields = NULL;
+
+  //hoechstens ein Schreibvorgang gleichzeitig
+  finishCheckpoint();
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.formatVersion = CHECKPOINT_FORMAT_VERSION;
+  header.dataOffset = CHECKPOINT_DATA_OFFSET;
+  header.boatCount = AMOUNT_BOATS;
+  memcpy(header.boats, getBoats(), sizeof(header.boats));
+
+  lockSimulation();
+  captureSimulationState(&header.state);
+  fieldSize = (size_t)(header.state.side + 2) * header.state.stride;
+  g_writeSize = CHECKPOINT_DATA_OFFSET + 2 * fieldSize * sizeof(GLfloat);
+  g_writeBuffer = calloc(g_writeSize, 1);
+  if (g_writeBuffer == NULL)
+  {
+    exit(1);
+  }
+  fields = (GLfloat *)(g_writeBuffer + CHECKPOINT_DATA_OFFSET);
+  captureSimulationFields(fields, fields + fieldSize);
+  unlockSimulation();
+
+  memcpy(g_writeBuffer, &header, sizeof(header));
+
+#ifndef WIN32
+  g_writing = (pthread_create(&g_writer, NULL, writeCheckpoint, NULL) == 0);
+  if (!g_writing)
+  {
+    writeCheckpoint(NULL);
+  }
+#else
+  writeCheckpoint(NULL);
+#endif
+}
+
+GLint loadCheckpoint(void)
+{
+  size_t size = 0;
+  size_t fieldSize = 0;
+  const char *data = NULL;
+  const CheckpointHeader *header = NULL;
+  const GLfloat *fields = NULL;
+  size_t rowLength = 0;
+  GLint side = 0;
+  GLint i = 0;
+
+  //ein noch laufender Schreibvorgang koennte die Datei gerade ersetzen
+  finishCheckpoint();
+
+  data = mapFile(g_checkpointFile, &size);
+  if (data == NULL)
+  {
+    fprintf(stderr, "Checkpoint %s konnte nicht gelesen werden\n", g_checkpointFile);
+    return 0;
+  }
+
+  header = (const CheckpointHeader *)data;
+  //erst die Aufloesung begrenzen, danach kann in size_t ohne Ueberlauf gerechnet werden
+  if ((size >= CHECKPOINT_DATA_OFFSET) &&
+      (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) == 0) &&
+      (header->formatVersion == CHECKPOINT_FORMAT_VERSION) &&
+      (header->dataOffset == CHECKPOINT_DATA_OFFSET) &&
+      (header->state.side >= MIN_AMOUNT_VERTICES) && (header->state.side <= MAX_AMOUNT_VERTICES) &&
+      (header->state.solver >= 0) && (header->state.solver < AMOUNT_WATER_SOLVERS) &&
+      (header->boatCount == AMOUNT_BOATS))
+  {
+    //Zeile mit Geisterrand, hoechstens auf die groesste SIMD-Breite aufgerundet
+    rowLength = (size_t)header->state.side + 2;
+    if (((size_t)header->state.stride >= rowLength) &&
+        ((size_t)header->state.stride <= (rowLength + CHECKPOINT_MAX_ROW_ALIGNMENT - 1) /
+                                             CHECKPOINT_MAX_ROW_ALIGNMENT * CHECKPOINT_MAX_ROW_ALIGNMENT))
+    {
+      fieldSize = rowLength * (size_t)header->state.stride;
+    }
+    if ((fieldSize > 0) && ((size - CHECKPOINT_DATA_OFFSET) / (2 * sizeof(GLfloat)) >= fieldSize))
+    {
+      fields = (const GLfloat *)(data + CHECKPOINT_DATA_OFFSET);
+      lockSimulation();
+      restoreSimulation(&header->state, fields, fields + fieldSize);
+      unlockSimulation();
+
+      //die Hoehe der Boote ergibt sich aus dem Wasser
+      for (i = 0; i < AMOUNT_BOATS; i++)
+      {
+        getBoats()[i][0] = header->boats[i][0];
+        getBoats()[i][2] = header->boats[i][2];
+      }
+      side = header->state.side;
+    }
+  }
+
+  if (side == 0)
+  {
+    fprintf(stderr, "%s ist kein gueltiger Checkpoint\n", g_checkpointFile);
+  }
+  unmapFile(data, size);
+  return side;
+}
+
+void finishCheckpoint(void)
+{
+#ifndef WIN32
+  if (g_writing)
+  {
+    pthread_join(g_writer, NULL);
+    g_writing = GL_FALSE;
+  }
+#endif
+}
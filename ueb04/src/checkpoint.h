@@ -0,0 +1,42 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+/**
+ * @file
+ * Schnittstelle des Checkpoint-Moduls.
+ * Das Modul sichert den Zustand der Wassersimulation (Aufloesung, Hoehen,
+ * Geschwindigkeiten, Verfahren, simulierte Zeit und Boote) in eine Datei und
+ * stellt ihn daraus wieder her. Geschrieben wird im Hintergrund, gelesen wird
+ * ueber mmap ohne Parsen, da die Felder unveraendert in der Datei liegen;
+ * nach der Pruefung werden sie in einem Durchlauf in die Simulation kopiert.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/**
+ * Setzt die Datei, in die gesichert und aus der geladen wird
+ * @param path Pfad der Datei (wird nicht kopiert)
+ */
+void setCheckpointFile(const char *path);
+
+/**
+ * Sichert den aktuellen Zustand. Kopiert wird sofort (bei angehaltener
+ * Simulation), geschrieben im Hintergrund; ein noch laufender
+ * Schreibvorgang wird vorher abgewartet.
+ */
+void saveCheckpoint(void);
+
+/**
+ * Stellt den zuletzt gesicherten Zustand wieder her.
+ * @return Anzahl der Punkte pro Seite des geladenen Zustands, 0 bei Fehler
+ */
+GLint loadCheckpoint(void);
+
+/**
+ * Wartet auf das Ende eines laufenden Schreibvorgangs
+ */
+void finishCheckpoint(void);
+
+#endif
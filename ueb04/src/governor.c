@@ -0,0 +1,240 @@
+/**
+ * @file
+ * Regler-Modul.
+ * Das Modul haelt eine Ziel-Bildrate auf zwei Ebenen:
+ * - Pro Takt der Simulation werden nur so viele Schritte berechnet, wie in
+ *   einen festen Anteil der Taktdauer passen (gemessen am gleitenden Mittel
+ *   der Kosten eines Schrittes). Ist die Simulation zu teuer, laeuft sie
+ *   langsamer als die Echtzeit, statt mit jedem Takt mehr aufholen zu muessen.
+ * - Einmal pro Messperiode wird anhand der Bildrate und des Anteils
+ *   verworfener Schritte entschieden, ob die Aufloesung sinken oder wieder
+ *   steigen soll. Gesenkt wird erst nach mehreren schlechten Messungen in
+ *   Folge unter einer unteren Schwelle, erhoeht erst nach mehreren guten ueber
+ *   einer deutlich hoeheren Schwelle. Nach jeder Aenderung wird gewartet, bis
+ *   die Messungen die neue Aufloesung widerspiegeln, und eine zu langsame
+ *   Aufloesung wird fuer eine (bei Wiederholung wachsende) Zeit nicht wieder
+ *   erreicht.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+/* ---- Eigene Header einbinden ---- */
+#include "governor.h"
+#include "simulationThread.h"
+
+/** Voreingestellte Ziel-Bildrate */
+#define GOVERNOR_DEFAULT_FPS (30.0f)
+
+/** Abstand der Entscheidungen in Sekunden (so lang wie ein Messfenster der Bildrate) */
+#define GOVERNOR_PERIOD (1.0)
+
+/** Wartezeit nach einer Aenderung der Aufloesung in Sekunden, bis wieder gemessen wird */
+#define GOVERNOR_SETTLE_TIME (2.5)
+
+/** Unter diesem Anteil der Ziel-Bildrate ist eine Messung schlecht */
+#define GOVERNOR_LOWER_BAND (0.9f)
+
+/** Ueber diesem Anteil der Ziel-Bildrate ist eine Messung gut */
+#define GOVERNOR_UPPER_BAND (1.3f)
+
+/** Anzahl schlechter Messungen in Folge, nach denen die Aufloesung sinkt */
+#define GOVERNOR_DOWN_READINGS (2)
+
+/** Anzahl guter Messungen in Folge, nach denen die Aufloesung steigt */
+#define GOVERNOR_UP_READINGS (3)
+
+/** Grenzen des Faktors, um den die Aufloesung auf einmal sinkt */
+#define GOVERNOR_MIN_SCALE_DOWN (0.5f)
+#define GOVERNOR_MAX_SCALE_DOWN (0.9f)
+
+/** Faktor, um den die Aufloesung auf einmal steigt */
+#define GOVERNOR_SCALE_UP (1.25f)
+
+/** Kleinste Aufloesung, die der Regler waehlt */
+#define GOVERNOR_MIN_SIDE (32)
+
+/** Anteil der Taktdauer, den die Simulation rechnen darf */
+#define SIMULATION_BUDGET (0.5)
+
+/** Ab diesem Anteil verworfener Schritte ist eine Messung schlecht */
+#define MAX_DROP_RATIO (0.05f)
+
+/** Gewicht einer neuen Messung im gleitenden Mittel der Schrittkosten */
+#define STEP_COST_WEIGHT (0.2)
+
+/** Zeit in Sekunden, fuer die eine zu langsame Aufloesung gesperrt wird, und deren Hoechstwert */
+#define CEILING_BACKOFF (20.0)
+#define MAX_CEILING_BACKOFF (160.0)
+
+/** Ist der Regler eingeschaltet? */
+static GLboolean g_active = GL_FALSE;
+
+/** Ziel-Bildrate */
+static GLfloat g_targetFps = GOVERNOR_DEFAULT_FPS;
+
+/* ---- Zustand der Simulation (nur bei gehaltener Simulationssperre) ---- */
+
+/** Gleitendes Mittel der Kosten eines Schrittes in Sekunden, 0 solange unbekannt */
+static double g_stepCost = 0.0;
+
+/** Faellige und davon verworfene Schritte seit der letzten Entscheidung */
+static GLuint g_requestedSteps = 0;
+static GLuint g_droppedSteps = 0;
+
+/* ---- Zustand der Entscheidungen (nur GLUT-Thread) ---- */
+
+/** Zeitpunkt der letzten Entscheidung bzw. Aenderung der Aufloesung */
+static double g_lastEvaluation = 0.0;
+static double g_lastChange = 0.0;
+
+/** Aufloesung bei der letzten Entscheidung */
+static GLint g_lastSide = 0;
+
+/** Anzahl schlechter bzw. guter Messungen in Folge */
+static GLint g_lowReadings = 0;
+static GLint g_highReadings = 0;
+
+/** Zuletzt zu langsame Aufloesung, die bis g_ceilingUntil nicht wieder erreicht wird */
+static GLint g_ceilingSide = 0;
+static double g_ceilingUntil = -MAX_CEILING_BACKOFF;
+
+/** Aktuelle Sperrzeit fuer zu langsame Aufloesungen */
+static double g_ceilingBackoff = CEILING_BACKOFF;
+
+/**
+ * Setzt die Messungen zurueck, z.B. nach einer Aenderung der Aufloesung
+ * @param time aktuelle Zeit
+ */
+static void restartReadings(double time)
+{
+  g_lastChange = time;
+  g_lowReadings = 0;
+  g_highReadings = 0;
+
+  //die Kosten eines Schrittes haengen von der Aufloesung ab
+  lockSimulation();
+  g_stepCost = 0.0;
+  g_requestedSteps = 0;
+  g_droppedSteps = 0;
+  unlockSimulation();
+}
+
+void setGovernorTarget(GLfloat fps)
+{
+  g_targetFps = fps > 0.0f ? fps : GOVERNOR_DEFAULT_FPS;
+  g_active = GL_TRUE;
+}
+
+void toggleGovernor(void)
+{
+  g_active = !g_active;
+  restartReadings(getGovernorTime());
+  if (g_active)
+  {
+    printf("Bildratenregler an, Ziel %.0f FPS\n", g_targetFps);
+  }
+  else
+  {
+    printf("Bildratenregler aus\n");
+  }
+}
+
+double getGovernorTime(void)
+{
+#ifndef WIN32
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+#else
+  //ohne Simulationsthread wird nur auf dem GLUT-Thread gemessen
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+GLint limitSimulationSteps(GLint steps, double interval)
+{
+  GLint allowed = steps;
+
+  if (g_active && (g_stepCost > 0.0) && (steps > 0))
+  {
+    allowed = (GLint)(SIMULATION_BUDGET * interval / g_stepCost);
+    //mindestens ein Schritt, damit die Simulation nie ganz stehen bleibt
+    allowed = allowed < 1 ? 1 : (allowed > steps ? steps : allowed);
+  }
+  g_requestedSteps += steps;
+  g_droppedSteps += steps - allowed;
+  return allowed;
+}
+
+void recordSimulationSteps(GLint steps, double seconds)
+{
+  double cost = 0.0;
+
+  if (steps > 0)
+  {
+    cost = seconds / steps;
+    g_stepCost = g_stepCost > 0.0 ? g_stepCost + STEP_COST_WEIGHT * (cost - g_stepCost) : cost;
+  }
+}
+
+GLint governResolution(GLfloat fps, GLint side, GLint maxSide)
+{
+  double time = getGovernorTime();
+  GLint newSide = side;
+  GLfloat dropRatio = 0.0f;
+  GLfloat scale = 0.0f;
+
+  if (side != g_lastSide)
+  {
+    //auch Aenderungen durch den Benutzer muessen sich erst in den Messungen zeigen
+    g_lastSide = side;
+    restartReadings(time);
+  }
+
+  if (g_active && (time - g_lastEvaluation >= GOVERNOR_PERIOD))
+  {
+    g_lastEvaluation = time;
+    lockSimulation();
+    dropRatio = g_requestedSteps > 0 ? (GLfloat)g_droppedSteps / (GLfloat)g_requestedSteps : 0.0f;
+    g_requestedSteps = 0;
+    g_droppedSteps = 0;
+    unlockSimulation();
+
+    if (time - g_lastChange >= GOVERNOR_SETTLE_TIME)
+    {
+      g_lowReadings = ((fps < g_targetFps * GOVERNOR_LOWER_BAND) || (dropRatio > MAX_DROP_RATIO)) ? g_lowReadings + 1 : 0;
+      g_highReadings = ((fps > g_targetFps * GOVERNOR_UPPER_BAND) && (dropRatio == 0.0f)) ? g_highReadings + 1 : 0;
+
+      if ((g_lowReadings >= GOVERNOR_DOWN_READINGS) && (side > GOVERNOR_MIN_SIDE))
+      {
+        //Zeichnen und Simulation kosten etwa proportional zur Anzahl der Punkte
+        scale = sqrtf(fminf(fps / g_targetFps, 1.0f - dropRatio));
+        scale = fmaxf(GOVERNOR_MIN_SCALE_DOWN, fminf(GOVERNOR_MAX_SCALE_DOWN, scale));
+        newSide = (GLint)(side * scale);
+        newSide = newSide < GOVERNOR_MIN_SIDE ? GOVERNOR_MIN_SIDE : newSide;
+
+        //scheitert dieselbe Stufe kurz nach Ablauf der Sperre erneut, wird laenger gesperrt
+        g_ceilingBackoff = (time - g_ceilingUntil < g_ceilingBackoff) ? fmin(2.0 * g_ceilingBackoff, MAX_CEILING_BACKOFF)
+                                                                       : CEILING_BACKOFF;
+        g_ceilingSide = side;
+        g_ceilingUntil = time + g_ceilingBackoff;
+      }
+      else if ((g_highReadings >= GOVERNOR_UP_READINGS) && (side < maxSide))
+      {
+        newSide = (GLint)(side * GOVERNOR_SCALE_UP) + 1;
+        newSide = newSide > maxSide ? maxSide : newSide;
+        if ((time < g_ceilingUntil) && (newSide >= g_ceilingSide))
+        {
+          newSide = g_ceilingSide - 1;
+        }
+        newSide = newSide < side ? side : newSide;
+      }
+    }
+  }
+  return newSide;
+}
@@ -0,0 +1,66 @@
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+/**
+ * @file
+ * Schnittstelle des Regler-Moduls.
+ * Der Regler haelt eine Ziel-Bildrate: er begrenzt die Simulationsschritte
+ * pro Takt auf ein Zeitbudget (die Simulation laeuft dann langsamer statt
+ * immer laengere Takte zu brauchen) und passt die Aufloesung des Gitters an,
+ * wenn die Bildrate dauerhaft unter dem Ziel liegt, die Simulation Schritte
+ * verwerfen muss oder wieder genug Reserve da ist. Getrennte Schwellen,
+ * mehrere Messungen in Folge, eine Wartezeit nach jeder Aenderung und eine
+ * Obergrenze fuer zuletzt zu langsame Aufloesungen verhindern ein Pendeln.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/**
+ * Setzt die Ziel-Bildrate und schaltet den Regler ein
+ * @param fps Ziel-Bildrate in Bildern pro Sekunde
+ */
+void setGovernorTarget(GLfloat fps);
+
+/**
+ * Schaltet den Regler ein bzw. aus
+ */
+void toggleGovernor(void);
+
+/**
+ * Liefert die Zeit der Uhr, mit der der Regler die Kosten der Simulation misst
+ * @return Zeit in Sekunden
+ */
+double getGovernorTime(void);
+
+/**
+ * Begrenzt die Schritte eines Taktes auf das Zeitbudget der Simulation.
+ * Ohne aktiven Regler werden alle Schritte zugelassen. Aufruf von der
+ * Simulation (bei gehaltener Sperre).
+ * @param steps faellige Schritte
+ * @param interval Dauer des Taktes in Sekunden
+ * @return Anzahl der Schritte, die berechnet werden sollen
+ */
+GLint limitSimulationSteps(GLint steps, double interval);
+
+/**
+ * Teilt dem Regler die Dauer der berechneten Schritte mit. Aufruf von der
+ * Simulation (bei gehaltener Sperre).
+ * @param steps Anzahl der berechneten Schritte
+ * @param seconds dafuer benoetigte Zeit in Sekunden
+ */
+void recordSimulationSteps(GLint steps, double seconds);
+
+/**
+ * Bestimmt die Aufloesung, die der Regler fuer die aktuelle Bildrate
+ * vorsieht. Aufruf einmal pro Bild auf dem GLUT-Thread, entschieden wird
+ * hoechstens einmal pro Messperiode.
+ * @param fps aktuelle Bildrate
+ * @param side aktuelle Anzahl der Punkte pro Seite
+ * @param maxSide vom Benutzer gewaehlte Anzahl, ueber die der Regler nicht hinausgeht
+ * @return gewuenschte Anzahl der Punkte pro Seite
+ */
+GLint governResolution(GLfloat fps, GLint side, GLint maxSide);
+
+#endif
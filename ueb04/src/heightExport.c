@@ -0,0 +1,609 @@
+/**
+ * @file
+ * Export-Modul.
+ * Das Modul schreibt die Hoehen des Wassers als Zeitreihe in eine Datei. Die
+ * Simulation quantisiert die Hoehen alle paar Schritte auf 16 Bit und legt
+ * sie in einen von wenigen vorab angelegten Plaetzen einer Warteschlange. Ein
+ * Hintergrund-Thread bildet die Differenz zum vorherigen Bild (die Hoehen
+ * aendern sich von Bild zu Bild wenig, die Differenzen sind daher klein und
+ * gut komprimierbar), trennt nieder- und hoeherwertige Bytes und komprimiert
+ * das Ergebnis im LZ4-Blockformat. Ist die Warteschlange voll, weil die Platte
+ * nicht nachkommt, verwirft die Simulation das Bild, statt zu warten; die
+ * Differenz bezieht sich immer auf das zuletzt geschriebene Bild.
+ *
+ * Alle EXPORT_KEYFRAME_INTERVAL Bilder und nach jeder Aenderung der
+ * Aufloesung wird ein Schluesselbild ohne Differenz geschrieben, sodass ein
+ * Leser ueber den Index am Dateiende jedes Bild erreicht, ohne die ganze
+ * Datei zu entpacken.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+/* ---- Eigene Header einbinden ---- */
+#include "heightExport.h"
+#include "atomics.h"
+#include "logic.h"
+#include "simulationThread.h"
+
+/** Kennung am Anfang jeder Exportdatei */
+#define EXPORT_MAGIC "UEB04HTS"
+
+/** Version des Dateiformats, bei Aenderungen am Kopf, Index oder Bildaufbau erhoehen */
+#define EXPORT_FORMAT_VERSION (1)
+
+/** Voreingestellte Datei fuer den Export */
+#define EXPORT_DEFAULT_FILE "ueb04.heights"
+
+/** Voreingestellte Anzahl Simulationsschritte zwischen zwei Bildern */
+#define EXPORT_DEFAULT_STEPS (16)
+
+/** Hoehe einer Quantisierungsstufe (Wertebereich etwa +-4) */
+#define EXPORT_HEIGHT_SCALE (1.0f / 8192.0f)
+
+/** Abstand der Schluesselbilder in Bildern */
+#define EXPORT_KEYFRAME_INTERVAL (64)
+
+/** Plaetze der Warteschlange zwischen Simulation und Schreib-Thread */
+#define EXPORT_QUEUE_FRAMES (8)
+
+/** Bits des Hashs ueber vier Byte, mit dem der Kompressor Wiederholungen sucht */
+#define LZ_HASH_BITS (14)
+
+/** Mindestlaenge einer Wiederholung */
+#define LZ_MIN_MATCH (4)
+
+/** Die letzten Bytes eines Blocks sind im LZ4-Format immer Literale */
+#define LZ_LAST_LITERALS (5)
+
+/** Eine Wiederholung muss mindestens so weit vor dem Blockende beginnen */
+#define LZ_MATCH_LIMIT (12)
+
+/** Maximaler Abstand einer Wiederholung */
+#define LZ_MAX_OFFSET (65535)
+
+/** Maximale Groesse eines komprimierten Blocks von n Byte */
+#define LZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+/** Kopf einer Exportdatei */
+typedef struct
+{
+  char magic[8];
+  uint32_t formatVersion;
+  float heightScale;
+  uint32_t keyframeInterval;
+  uint32_t frameCount;
+  uint64_t indexOffset;
+} ExportHeader;
+
+/** Eintrag des Index am Dateiende, einer je Bild */
+typedef struct
+{
+  uint64_t offset;
+  uint32_t size;
+  uint32_t side;
+  uint32_t step;
+  uint32_t keyframe;
+  double time;
+} ExportIndexEntry;
+
+/** Platz der Warteschlange mit einem quantisierten Bild */
+typedef struct
+{
+  int16_t *heights;
+  size_t capacity;
+  GLint side;
+  GLuint step;
+  double time;
+} ExportSlot;
+
+/** Datei fuer den naechsten Export */
+static const char *g_exportFile = EXPORT_DEFAULT_FILE;
+
+/** Simulationsschritte zwischen zwei Bildern */
+static GLint g_exportSteps = EXPORT_DEFAULT_STEPS;
+
+/** Laeuft gerade ein Export? (nur bei gehaltener Simulationssperre geaendert) */
+static GLboolean g_exporting = GL_FALSE;
+
+/** Schritt, ab dem das naechste Bild faellig ist */
+static GLuint g_nextExportStep = 0;
+
+/** Verworfene Bilder des laufenden Exports */
+static GLuint g_droppedFrames = 0;
+
+/** Warteschlange, gefuellt von der Simulation, geleert vom Schreib-Thread */
+static ExportSlot g_queue[EXPORT_QUEUE_FRAMES];
+
+/** Anzahl der insgesamt eingereihten Bilder (schreibt nur die Simulation) */
+static GLuint g_queueHead = 0;
+
+/** Anzahl der insgesamt geschriebenen Bilder (schreibt nur der Schreib-Thread) */
+static GLuint g_queueTail = 0;
+
+/* ---- Zustand des Schreib-Threads ---- */
+
+/** Geoeffnete Exportdatei */
+static FILE *g_file = NULL;
+
+/** Ist beim Schreiben ein Fehler aufgetreten? */
+static GLboolean g_writeFailed = GL_FALSE;
+
+/** Aktuelle Position in der Datei */
+static uint64_t g_fileOffset = 0;
+
+/** Index der bisher geschriebenen Bilder */
+static ExportIndexEntry *g_index = NULL;
+
+/** Anzahl der Bilder im Index */
+static GLuint g_frameCount = 0;
+
+/** Platz fuer so viele Eintraege im Index */
+static GLuint g_indexCapacity = 0;
+
+/** Quantisierte Hoehen des zuletzt geschriebenen Bildes */
+static int16_t *g_previous = NULL;
+
+/** Seitenlaenge des zuletzt geschriebenen Bildes, 0 vor dem ersten Bild */
+static GLint g_previousSide = 0;
+
+/** Nach Bytes getrennte Differenzen des aktuellen Bildes */
+static unsigned char *g_planes = NULL;
+
+/** Komprimiertes aktuelles Bild */
+static unsigned char *g_compressed = NULL;
+
+/** Anzahl Werte, fuer die die Puffer des Schreib-Threads reichen */
+static size_t g_bufferCapacity = 0;
+
+/** Letzte Position je Hash beim Komprimieren */
+static GLuint g_hashTable[1 << LZ_HASH_BITS];
+
+#ifndef WIN32
+/** Thread, der die Bilder kodiert und schreibt */
+static pthread_t g_writer;
+
+/** Schuetzt das Warten des Schreib-Threads auf neue Bilder */
+static pthread_mutex_t g_queueMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Weckt den Schreib-Thread bei neuen Bildern und zum Beenden */
+static pthread_cond_t g_queueSignal = PTHREAD_COND_INITIALIZER;
+
+/** Soll der Schreib-Thread nach den wartenden Bildern enden? */
+static GLboolean g_stopWriter = GL_FALSE;
+#endif
+
+/**
+ * Liest vier Byte ohne Anforderungen an die Ausrichtung
+ * @param p Adresse
+ * @return gelesener Wert
+ */
+static uint32_t read32(const unsigned char *p)
+{
+  uint32_t value;
+
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/**
+ * Schreibt die Fortsetzung einer Laenge ab 15 (Bytes zu je 255 und Rest)
+ * @param op Ziel
+ * @param length Rest der Laenge
+ * @return Position hinter den geschriebenen Bytes
+ */
+static unsigned char *writeLength(unsigned char *op, size_t length)
+{
+  while (length >= 255)
+  {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (unsigned char)length;
+  return op;
+}
+
+/**
+ * Schreibt eine Sequenz des LZ4-Formats: Literale und ggf. eine Wiederholung
+ * @param op Ziel
+ * @param literals Beginn der Literale
+ * @param literalLength Anzahl der Literale
+ * @param offset Abstand der Wiederholung, 0 fuer die letzte Sequenz ohne Wiederholung
+ * @param matchLength Laenge der Wiederholung (mind. LZ_MIN_MATCH)
+ * @return Position hinter der Sequenz
+ */
+static unsigned char *writeSequence(unsigned char *op, const unsigned char *literals, size_t literalLength,
+                                    size_t offset, size_t matchLength)
+{
+  unsigned char *token = op++;
+
+  *token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+  if (literalLength >= 15)
+  {
+    op = writeLength(op, literalLength - 15);
+  }
+  memcpy(op, literals, literalLength);
+  op += literalLength;
+
+  if (offset > 0)
+  {
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+    matchLength -= LZ_MIN_MATCH;
+    *token |= (unsigned char)(matchLength >= 15 ? 15 : matchLength);
+    if (matchLength >= 15)
+    {
+      op = writeLength(op, matchLength - 15);
+    }
+  }
+  return op;
+}
+
+/**
+ * Komprimiert einen Block im LZ4-Blockformat (gierig, eine Hashtabelle ueber
+ * je vier Byte). Lesbar z.B. mit lz4.block.decompress aus Python.
+ * @param src Eingabe
+ * @param length Laenge der Eingabe
+ * @param dst Ziel, mindestens LZ_BOUND(length) Byte (Out)
+ * @return Laenge des komprimierten Blocks
+ */
+static size_t compressBlock(const unsigned char *src, size_t length, unsigned char *dst)
+{
+  const unsigned char *ip = src;
+  const unsigned char *anchor = src;
+  const unsigned char *end = src + length;
+  const unsigned char *matchEnd = end - LZ_LAST_LITERALS;
+  const unsigned char *searchEnd = length > LZ_MATCH_LIMIT ? end - LZ_MATCH_LIMIT : src;
+  const unsigned char *ref = NULL;
+  unsigned char *op = dst;
+  uint32_t sequence = 0;
+  uint32_t hash = 0;
+  size_t matchLength = 0;
+
+  memset(g_hashTable, 0, sizeof(g_hashTable));
+  while (ip < searchEnd)
+  {
+    sequence = read32(ip);
+    hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+    ref = src + g_hashTable[hash];
+    g_hashTable[hash] = (GLuint)(ip - src);
+
+    if ((ref < ip) && (ip - ref <= LZ_MAX_OFFSET) && (read32(ref) == sequence))
+    {
+      matchLength = LZ_MIN_MATCH;
+      while ((ip + matchLength < matchEnd) && (ref[matchLength] == ip[matchLength]))
+      {
+        matchLength++;
+      }
+      op = writeSequence(op, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), matchLength);
+      ip += matchLength;
+      anchor = ip;
+    }
+    else
+    {
+      ip++;
+    }
+  }
+
+  op = writeSequence(op, anchor, (size_t)(end - anchor), 0, 0);
+  return (size_t)(op - dst);
+}
+
+/**
+ * Schreibt Daten an die aktuelle Position der Exportdatei. Nach einem Fehler
+ * wird nichts mehr geschrieben.
+ * @param data Daten
+ * @param size Laenge in Byte
+ */
+static void writeExport(const void *data, size_t size)
+{
+  if (!g_writeFailed && (fwrite(data, 1, size, g_file) != size))
+  {
+    fprintf(stderr, "Export nach %s fehlgeschlagen\n", g_exportFile);
+    g_writeFailed = GL_TRUE;
+  }
+  g_fileOffset += size;
+}
+
+/**
+ * Kodiert ein Bild der Warteschlange, schreibt es und traegt es in den Index ein
+ * @param slot Bild
+ */
+static void encodeFrame(const ExportSlot *slot)
+{
+  size_t count = (size_t)slot->side * slot->side;
+  GLboolean keyframe = (g_frameCount % EXPORT_KEYFRAME_INTERVAL == 0) || (slot->side != g_previousSide);
+  ExportIndexEntry *entry = NULL;
+  uint16_t value = 0;
+  size_t size = 0;
+  size_t i;
+
+  if (count > g_bufferCapacity)
+  {
+    g_previous = realloc(g_previous, count * sizeof(int16_t));
+    g_planes = realloc(g_planes, 2 * count);
+    g_compressed = realloc(g_compressed, LZ_BOUND(2 * count));
+    if (!g_previous || !g_planes || !g_compressed)
+    {
+      exit(1);
+    }
+    g_bufferCapacity = count;
+  }
+  if (g_frameCount == g_indexCapacity)
+  {
+    g_indexCapacity = g_indexCapacity > 0 ? 2 * g_indexCapacity : 256;
+    g_index = realloc(g_index, g_indexCapacity * sizeof(ExportIndexEntry));
+    if (!g_index)
+    {
+      exit(1);
+    }
+  }
+
+  //Differenz modulo 2^16, getrennt nach nieder- und hoeherwertigen Bytes:
+  //kleine Differenzen ergeben lange Folgen von 0x00 bzw. 0xFF
+  for (i = 0; i < count; i++)
+  {
+    value = (uint16_t)(keyframe ? slot->heights[i] : slot->heights[i] - g_previous[i]);
+    g_planes[i] = (unsigned char)(value & 0xFF);
+    g_planes[count + i] = (unsigned char)(value >> 8);
+  }
+  memcpy(g_previous, slot->heights, count * sizeof(int16_t));
+  g_previousSide = slot->side;
+
+  size = compressBlock(g_planes, 2 * count, g_compressed);
+  entry = &g_index[g_frameCount++];
+  entry->offset = g_fileOffset;
+  entry->size = (uint32_t)size;
+  entry->side = (uint32_t)slot->side;
+  entry->step = slot->step;
+  entry->keyframe = keyframe;
+  entry->time = slot->time;
+  writeExport(g_compressed, size);
+}
+
+/**
+ * Haengt den Index an, traegt ihn im Kopf ein und schliesst die Datei
+ */
+static void finishFile(void)
+{
+  ExportHeader header;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, EXPORT_MAGIC, sizeof(header.magic));
+  header.formatVersion = EXPORT_FORMAT_VERSION;
+  header.heightScale = EXPORT_HEIGHT_SCALE;
+  header.keyframeInterval = EXPORT_KEYFRAME_INTERVAL;
+  header.frameCount = g_frameCount;
+  header.indexOffset = g_fileOffset;
+
+  writeExport(g_index, g_frameCount * sizeof(ExportIndexEntry));
+  if (!g_writeFailed && (fseek(g_file, 0, SEEK_SET) == 0))
+  {
+    writeExport(&header, sizeof(header));
+  }
+  if ((fclose(g_file) != 0) && !g_writeFailed)
+  {
+    fprintf(stderr, "Export nach %s fehlgeschlagen\n", g_exportFile);
+  }
+  g_file = NULL;
+
+  free(g_index);
+  free(g_previous);
+  free(g_planes);
+  free(g_compressed);
+  g_index = NULL;
+  g_previous = NULL;
+  g_planes = NULL;
+  g_compressed = NULL;
+  g_indexCapacity = 0;
+  g_bufferCapacity = 0;
+}
+
+#ifndef WIN32
+/**
+ * Schreib-Thread: kodiert die eingereihten Bilder, bis der Export beendet
+ * wird und keine Bilder mehr warten
+ * @param arg unbenutzt
+ * @return immer NULL
+ */
+static void *runWriter(void *arg)
+{
+  GLboolean stop = GL_FALSE;
+
+  while (!stop)
+  {
+    pthread_mutex_lock(&g_queueMutex);
+    while ((g_queueTail == ATOMIC_LOAD(&g_queueHead)) && !g_stopWriter)
+    {
+      pthread_cond_wait(&g_queueSignal, &g_queueMutex);
+    }
+    stop = (g_queueTail == ATOMIC_LOAD(&g_queueHead));
+    pthread_mutex_unlock(&g_queueMutex);
+
+    if (!stop)
+    {
+      encodeFrame(&g_queue[g_queueTail % EXPORT_QUEUE_FRAMES]);
+      ATOMIC_STORE(&g_queueTail, g_queueTail + 1);
+    }
+  }
+  return NULL;
+}
+#endif
+
+/**
+ * Gibt das im naechsten Platz der Warteschlange abgelegte Bild an den
+ * Schreib-Thread weiter (ohne Threads: schreibt es sofort)
+ */
+static void pushFrame(void)
+{
+#ifndef WIN32
+  ATOMIC_STORE(&g_queueHead, g_queueHead + 1);
+  pthread_mutex_lock(&g_queueMutex);
+  pthread_cond_signal(&g_queueSignal);
+  pthread_mutex_unlock(&g_queueMutex);
+#else
+  encodeFrame(&g_queue[g_queueHead % EXPORT_QUEUE_FRAMES]);
+  g_queueHead++;
+  g_queueTail++;
+#endif
+}
+
+/**
+ * Startet den Export in die eingestellte Datei
+ */
+static void startExport(void)
+{
+  ExportHeader header;
+
+  g_file = fopen(g_exportFile, "wb");
+  if (g_file == NULL)
+  {
+    fprintf(stderr, "Export nach %s fehlgeschlagen\n", g_exportFile);
+    return;
+  }
+
+  //Platzhalter, der Kopf wird beim Beenden mit Anzahl und Index ueberschrieben
+  memset(&header, 0, sizeof(header));
+  g_writeFailed = GL_FALSE;
+  g_fileOffset = 0;
+  g_frameCount = 0;
+  g_previousSide = 0;
+  writeExport(&header, sizeof(header));
+
+  g_queueHead = 0;
+  g_queueTail = 0;
+  g_droppedFrames = 0;
+#ifndef WIN32
+  g_stopWriter = GL_FALSE;
+  if (pthread_create(&g_writer, NULL, runWriter, NULL) != 0)
+  {
+    fprintf(stderr, "Export nach %s fehlgeschlagen\n", g_exportFile);
+    fclose(g_file);
+    g_file = NULL;
+    return;
+  }
+#endif
+
+  lockSimulation();
+  g_nextExportStep = 0;
+  g_exporting = GL_TRUE;
+  unlockSimulation();
+  printf("Export nach %s gestartet\n", g_exportFile);
+}
+
+void setExportOptions(const char *path, GLint steps)
+{
+  if (path != NULL)
+  {
+    g_exportFile = path;
+  }
+  g_exportSteps = steps > 0 ? steps : EXPORT_DEFAULT_STEPS;
+}
+
+void toggleExport(void)
+{
+  if (g_exporting)
+  {
+    stopExport();
+  }
+  else
+  {
+    startExport();
+  }
+}
+
+void exportSimulationFrame(void)
+{
+  SimulationState state;
+  ExportSlot *slot = NULL;
+  const GLfloat *heights = NULL;
+  GLfloat value = 0.0f;
+  size_t count = 0;
+  GLint x, y;
+
+  if (g_exporting)
+  {
+    captureSimulationState(&state);
+    if (state.stepCount >= g_nextExportStep)
+    {
+      g_nextExportStep = state.stepCount - state.stepCount % g_exportSteps + g_exportSteps;
+
+      //volle Warteschlange: Bild verwerfen, die Simulation wartet nie auf die Platte
+      if (g_queueHead - ATOMIC_LOAD(&g_queueTail) >= EXPORT_QUEUE_FRAMES)
+      {
+        g_droppedFrames++;
+      }
+      else
+      {
+        //der Platz gehoert bis zum Einreihen allein der Simulation
+        slot = &g_queue[g_queueHead % EXPORT_QUEUE_FRAMES];
+        count = (size_t)state.side * state.side;
+        if (count > slot->capacity)
+        {
+          free(slot->heights);
+          slot->heights = malloc(count * sizeof(int16_t));
+          if (!slot->heights)
+          {
+            exit(1);
+          }
+          slot->capacity = count;
+        }
+
+        heights = getSimulationHeights();
+        for (y = 0; y < state.side; y++)
+        {
+          for (x = 0; x < state.side; x++)
+          {
+            //Runden per Abschneiden von +-0.5, das laesst sich vektorisieren
+            value = heights[y * state.stride + x] * (1.0f / EXPORT_HEIGHT_SCALE);
+            value = value < -32768.0f ? -32768.0f : (value > 32767.0f ? 32767.0f : value);
+            slot->heights[y * state.side + x] = (int16_t)(value + (value < 0.0f ? -0.5f : 0.5f));
+          }
+        }
+        slot->side = state.side;
+        slot->step = state.stepCount;
+        slot->time = state.time;
+        pushFrame();
+      }
+    }
+  }
+}
+
+void stopExport(void)
+{
+  GLint i;
+
+  if (g_exporting)
+  {
+    lockSimulation();
+    g_exporting = GL_FALSE;
+    unlockSimulation();
+
+#ifndef WIN32
+    pthread_mutex_lock(&g_queueMutex);
+    g_stopWriter = GL_TRUE;
+    pthread_cond_signal(&g_queueSignal);
+    pthread_mutex_unlock(&g_queueMutex);
+    pthread_join(g_writer, NULL);
+#endif
+
+    finishFile();
+    printf("Export nach %s beendet: %u Bilder, %u verworfen\n", g_exportFile, g_frameCount, g_droppedFrames);
+
+    for (i = 0; i < EXPORT_QUEUE_FRAMES; i++)
+    {
+      free(g_queue[i].heights);
+      g_queue[i].heights = NULL;
+      g_queue[i].capacity = 0;
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef __HEIGHTEXPORT_H__
+#define __HEIGHTEXPORT_H__
+/**
+ * @file
+ * Schnittstelle des Export-Moduls.
+ * Das Modul schreibt die Hoehen des Wassers alle paar Simulationsschritte
+ * als Zeitreihe in eine Datei: auf 16 Bit quantisiert, als Differenz zum
+ * vorherigen Bild und mit einem schnellen LZ-Verfahren (LZ4-Blockformat)
+ * komprimiert. Kodiert und geschrieben wird auf einem Hintergrund-Thread,
+ * die Simulation gibt nur die quantisierten Hoehen in eine Warteschlange
+ * begrenzter Laenge ab und wartet nie auf die Platte.
+ *
+ * Aufbau der Datei (alle Werte little-endian):
+ * - Kopf (ExportHeader): Kennung "UEB04HTS", Version, Hoehe pro
+ *   Quantisierungsstufe, Abstand der Schluesselbilder, Anzahl der Bilder und
+ *   Position des Index
+ * - die komprimierten Bilder hintereinander
+ * - der Index: je Bild Position, komprimierte Groesse, Seitenlaenge,
+ *   Simulationsschritt, Schluesselbild-Flag und simulierte Zeit
+ * Entpackt enthaelt ein Bild erst die niederwertigen, dann die hoeherwertigen
+ * Bytes der side * side 16-Bit-Werte (zeilenweise). Bei Schluesselbildern
+ * sind das die quantisierten Hoehen, sonst die Differenz zum vorherigen Bild.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/**
+ * Setzt Datei und Abstand der Bilder fuer den naechsten Export
+ * @param path Pfad der Datei (wird nicht kopiert), NULL behaelt die voreingestellte
+ * @param steps Anzahl der Simulationsschritte zwischen zwei Bildern, 0 fuer die Voreinstellung
+ */
+void setExportOptions(const char *path, GLint steps);
+
+/**
+ * Startet bzw. beendet den Export. Beim Beenden werden alle noch
+ * wartenden Bilder geschrieben und der Index angehaengt.
+ */
+void toggleExport(void);
+
+/**
+ * Gibt ein Bild ab, wenn seit dem letzten Bild genug Schritte simuliert
+ * wurden. Ist die Warteschlange voll, wird das Bild verworfen statt zu
+ * warten. Aufruf von der Simulation (bei gehaltener Sperre).
+ */
+void exportSimulationFrame(void);
+
+/**
+ * Beendet einen laufenden Export
+ */
+void stopExport(void);
+
+#endif
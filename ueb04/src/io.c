@@ -14,6 +14,9 @@
 #include <stdio.h>
 #include <limits.h>
 
+/* GLEW muss vor allen anderen OpenGL-Headern eingebunden werden */
+#include <GL/glew.h>
+
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #else
@@ -27,14 +30,16 @@
 #include "stringOutput.h"
 #include "logic.h"
 #include "texture.h"
+#include "workers.h"
+#include "simulationThread.h"
+#include "checkpoint.h"
+#include "heightExport.h"
+#include "governor.h"
 #include <math.h>
 
 
 
 /* ---- Konstanten ---- */
-#define MAX_AMOUNT_VERTICES (100)
-#define MIN_AMOUNT_VERTICES (2)
-
 /** Anzahl der Aufrufe der Timer-Funktion pro Sekunde */
 #define TIMER_CALLS_PS 360
 
@@ -47,12 +52,16 @@
 #define MAX_RADIUS 75.0f
 
 //Makros fuer die Projektion
+#define FIELD_OF_VIEW 70.0f
 #define NEAR_CLIPPING_PLANE 0.1f
 #define FAR_CLIPPING_PLANE 500.0f
 
 /** Anzahl Simulationsschritte pro Sekunde*/
 #define SIM_STEPS_PS (800)
 
+/** Anzahl Simulationsschritte pro Sekunde beim impliziten Verfahren (grobe Schritte) */
+#define IMPLICIT_STEPS_PS (10)
+
 /* ---- Globale Daten ---- */
 double interval = 0.0f;
 double lastIdleCallTime = 0.0f;
@@ -64,7 +73,11 @@ int lastClickedBoat = boat1;
 
 GLboolean isFullscreen = GL_FALSE;
 GLboolean isPaused = GL_FALSE;
+//Laeuft die Simulation auf einem eigenen Thread?
+GLboolean isSimulationThreaded = GL_FALSE;
 GLboolean pickSpheres = GL_TRUE;
+//vom Benutzer gewaehlte Aufloesung, hoeher geht der Bildratenregler nicht
+GLint userResolution = 0;
 /* ---- Funktionen ---- */
 
 /**
@@ -121,60 +134,23 @@ GLint calcNumLength(GLint num)
 }
 
 /**
- * Verarbeitung der Picking-Ergebnisse.
- * Findet den Treffer, der dem Betrachter am naechsten liegt und gibt die
- * Namen dieses Treffers aus.
- * @param numHits Anzahl der getroffenen Objekte (In).
- * @param buffer Buffer, in dem die Treffer gespeichert sind (In).
+ * Verarbeitung des Picking-Ergebnisses.
+ * @param picked Index des getroffenen Punktes bzw. Nummer des Bootes, -1 ohne Treffer
+ * @param click mit welcher Maustaste gepickt wurde
  */
 static void
-processHits(GLint numHits, GLuint buffer[], mouseButtons click)
+processHit(GLint picked, mouseButtons click)
 {
-  /* Anzahl der Namen des Treffers, der am naechsten zum Betrachter ist */
-  GLint numOfClosestNames = 0;
-  /* Anzahl der Namen des Treffers, der am naechsten zum Betrachter ist */
-  GLuint *ptrClosestNames = NULL;
-
-  /* Laufvariable - Nummer des akt. verarbeiteten Treffers */
-  GLint i;
-  /* Laufvariable - Zeiger auf den Beginn des Hit-Records */
-  GLuint *ptr = (GLuint *)buffer;
-
-  /* DepthBuffer - Wert */
-  GLuint minZ = 0xffffffff;
-
-  if (numHits > 0)
+  if (picked >= 0)
   {
-    /* Alle Treffer verarbeiten */
-    for (i = 0; i < numHits; i++)
+    if (pickSpheres)
     {
-      /* Ist der Treffer naeher dran, als der bisher naechste? */
-      if (*(ptr + 1) < minZ)
-      {
-        /* Anzahl der Namen merken */
-        numOfClosestNames = *ptr;
-        /* Zeiger auf den ersten Namen merken */
-        ptrClosestNames = ptr + 3;
-        /* als neuen minimalen Tiefenwert merken */
-        minZ = *(ptr + 1);
-      }
-      /* zum Beginn des naechsten Hit-Records springen */
-      /* Schrittweite: Anzahl-Feld + minZ-Feld + maxZ-Feld + Namen-Felder */
-      ptr += 3 + *ptr;
+      pickedVertex((GLuint)picked, click);
     }
-
-    /* Alle Namen des Treffers ausgeben, der am naechsten zum Betrachter liegt */
-    for (i = 0; i < numOfClosestNames; i++, ptrClosestNames++)
+    else
     {
-      if (pickSpheres)
-      {
-        pickedVertex(*ptrClosestNames, click);
-      }
-      else
-      {
-        lastClickedBoat = *ptrClosestNames;
-        setLight1State(lastClickedBoat);
-      }
+      lastClickedBoat = picked;
+      setLight1State(lastClickedBoat);
     }
   }
 }
@@ -191,7 +167,7 @@ static void
 setProjection(GLdouble aspect)
 {
   /* perspektivische Projektion */
-  gluPerspective(70.0,                /* Oeffnungswinkel */
+  gluPerspective(FIELD_OF_VIEW,       /* Oeffnungswinkel */
                  aspect,              /* Seitenverhaeltnis */
                  NEAR_CLIPPING_PLANE, /* nahe Clipping-Ebene */
                  FAR_CLIPPING_PLANE /* ferne Clipping-Ebene */);
@@ -214,68 +190,62 @@ setCamera(void)
 
 /**
  * Picking. Auswahl von Szenenobjekten durch Klicken mit der Maus.
+ * Der Strahl von der Kamera durch den Mauszeiger wird auf der CPU mit den
+ * pickbaren Objekten geschnitten, es wird nichts neu gezeichnet.
  * @param click mit welcher Maustaste gepickt wurde
  */
 static void
 pick(int x, int y, mouseButtons click)
 {
-  /** Groesse des Buffers fuer Picking Ergebnisse */
-#define SELECTBUFSIZE 512
-
-  /* Viewport (Darstellungsbereich des Fensters) */
-  GLint viewport[4];
-
-  /* Puffer fuer Picking-Ergebnis */
-  GLuint buffer[SELECTBUFSIZE];
-
-  /* Anzahl der getroffenen Namen beim Picking */
-  GLint numHits;
-
-  /* aktuellen Viewport ermitteln */
-  glGetIntegerv(GL_VIEWPORT, viewport);
-
-  /* Puffer festlegen, Name-Stack leeren und Rendermode wechseln */
-  glSelectBuffer(SELECTBUFSIZE, buffer);
-  glInitNames();
-  glRenderMode(GL_SELECT);
-
-  /* Nachfolgende Operationen beeinflussen Projektionsmatrix */
-  glMatrixMode(GL_PROJECTION);
-  /* Matrix zuruecksetzen - Einheitsmatrix laden */
-  glLoadIdentity();
-
-  gluPickMatrix(x, glutGet(GLUT_WINDOW_HEIGHT) - y, 5, 5, viewport);
-
-  setProjection((double)glutGet(GLUT_WINDOW_WIDTH) /
-                (double)glutGet(GLUT_WINDOW_HEIGHT));
-
-  /* Nachfolgende Operationen beeinflussen Modelviewmatrix */
-  glMatrixMode(GL_MODELVIEW);
-  /* Matrix zuruecksetzen - Einheitsmatrix laden */
-  glLoadIdentity();
-
-  setCamera();
-
-  /* Zeichnen nur der pickbaren Objekte */
-  drawScenePickable(pickSpheres);
+  /* Augpunkt wie in setCamera */
+  CGVector3f eye = {getCameraRadius() * sin(getCameraTheta()) * cos(getCameraPhi()),
+                    getCameraRadius() * cos(getCameraTheta()),
+                    getCameraRadius() * sin(getCameraTheta()) * sin(getCameraPhi())};
+  Ray ray;
 
-  /* Zeichnen beenden und auswerten */
-  glFlush();
+  calcPickRay(eye, FIELD_OF_VIEW, x, y,
+              glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT), &ray);
 
-  /* Nachfolgende Operationen beeinflussen Projektionsmatrix */
-  glMatrixMode(GL_PROJECTION);
-  /* Matrix zuruecksetzen - Einheitsmatrix laden */
-  glLoadIdentity();
-
-  setProjection((double)glutGet(GLUT_WINDOW_WIDTH) /
-                (double)glutGet(GLUT_WINDOW_HEIGHT));
+  //Verarbeiten des Treffers
+  processHit(pickScene(&ray, pickSpheres), click);
+}
 
-  numHits = glRenderMode(GL_RENDER);
+/**
+ * Setzt die Aufloesung des Mesh in Logik und Darstellung,
+ * begrenzt auf MIN_AMOUNT_VERTICES bis MAX_AMOUNT_VERTICES Punkte pro Seite
+ * @param amountVerticesSide gewuenschte Anzahl der Punkte pro Seite
+ */
+static void
+setMeshResolution(GLint amountVerticesSide)
+{
+  if (amountVerticesSide > MAX_AMOUNT_VERTICES)
+  {
+    amountVerticesSide = MAX_AMOUNT_VERTICES;
+  }
+  if (amountVerticesSide < MIN_AMOUNT_VERTICES)
+  {
+    amountVerticesSide = MIN_AMOUNT_VERTICES;
+  }
 
-  /*   GLGETERROR; */
+  if (amountVerticesSide != getAmountVertices())
+  {
+    lockSimulation();
+    updateLogic(amountVerticesSide);
+    unlockSimulation();
+    updateVertexArray(amountVerticesSide);
+  }
+}
 
-  //Verarbeiten der Treffer
-  processHits(numHits, buffer, click);
+/**
+ * Setzt die Aufloesung des Mesh auf Wunsch des Benutzers, sie ist zugleich
+ * die Obergrenze fuer den Bildratenregler
+ * @param amountVerticesSide gewuenschte Anzahl der Punkte pro Seite
+ */
+static void
+setUserResolution(GLint amountVerticesSide)
+{
+  setMeshResolution(amountVerticesSide);
+  userResolution = getAmountVertices();
 }
 
 /**
@@ -298,6 +268,7 @@ handleKeyboardEvent(int key, int status, GLboolean isSpecialKey, int x,
   /* temporaere Variablen fuer Zustaende */
   int state = 0;
   GLboolean boolState = GL_TRUE;
+  GLint side = 0;
 
   /** Keycode der ESC-Taste */
 #define ESC 27
@@ -361,6 +332,21 @@ handleKeyboardEvent(int key, int status, GLboolean isSpecialKey, int x,
         glutPostRedisplay();
         break;
 
+        /* Zustand der Simulation sichern (im Hintergrund) */
+      case GLUT_KEY_F7:
+        saveCheckpoint();
+        break;
+
+        /* gesicherten Zustand der Simulation laden */
+      case GLUT_KEY_F8:
+        side = loadCheckpoint();
+        if ((side > 0) && (side != getAmountVertices()))
+        {
+          updateVertexArray(side);
+          userResolution = side;
+        }
+        break;
+
         // Togglen des Vollbildmodus
       case GLUT_KEY_F12:
         isFullscreen = !isFullscreen;
@@ -384,8 +370,12 @@ handleKeyboardEvent(int key, int status, GLboolean isSpecialKey, int x,
       case 'q':
       case 'Q':
       case ESC:
+        stopExport();
+        stopSimulationThread();
+        finishCheckpoint();
         freeAllocatedMem();
         freeAllocatedMemLogic();
+        freeWorkers();
         exit(0);
         break;
         /* naeher ranzoomen */
@@ -448,19 +438,19 @@ handleKeyboardEvent(int key, int status, GLboolean isSpecialKey, int x,
         break;
         /* Punte hinzufügen */
       case '+':
-        if (getAmountVertices() < MAX_AMOUNT_VERTICES)
-        {
-          updateLogic(expand);
-          updateVertexArray(expand);
-        }
+        setUserResolution(getAmountVertices() + 1);
         break;
         /* Punkte entfernen */
       case '-':
-        if (getAmountVertices() > MIN_AMOUNT_VERTICES)
-        {
-          updateLogic(shrink);
-          updateVertexArray(shrink);
-        }
+        setUserResolution(getAmountVertices() - 1);
+        break;
+        /* Anzahl der Punkte verdoppeln */
+      case '*':
+        setUserResolution(getAmountVertices() * 2);
+        break;
+        /* Anzahl der Punkte halbieren */
+      case '/':
+        setUserResolution(getAmountVertices() / 2);
         break;
         /* Anzeigen der Texturen umschalten */
       case 't':
@@ -469,6 +459,23 @@ handleKeyboardEvent(int key, int status, GLboolean isSpecialKey, int x,
         setTexturingStatus(state);
         glutPostRedisplay();
         break;
+        /* Export der Hoehen starten/beenden */
+      case 'e':
+      case 'E':
+        toggleExport();
+        break;
+        /* Bildratenregler an/aus */
+      case 'g':
+      case 'G':
+        toggleGovernor();
+        break;
+        /* Verfeinerung der Simulation (adaptives Gitter) an/aus */
+      case 'a':
+      case 'A':
+        lockSimulation();
+        setRefinement(!getRefinement());
+        unlockSimulation();
+        break;
         /* Anzeigen der Kugeln umschalten */
       case 's':
       case 'S':
@@ -477,7 +484,16 @@ handleKeyboardEvent(int key, int status, GLboolean isSpecialKey, int x,
         /* Simulation pausieren*/
       case 'p':
       case 'P':
+        lockSimulation();
         isPaused = !isPaused;
+        unlockSimulation();
+        break;
+        /* Verfahren wechseln: explizite, implizite Simulation, spektrales Meer */
+      case 'm':
+      case 'M':
+        lockSimulation();
+        setWaterSolver((waterSolver)((getWaterSolver() + 1) % AMOUNT_WATER_SOLVERS));
+        unlockSimulation();
         break;
 
       case 'h':
@@ -616,7 +632,7 @@ set3DViewport(GLint x, GLint y, GLint width, GLint height)
   glViewport(x, y, width, height);
 
   /* Perspektivische Darstellung */
-  gluPerspective(70,                  /* oeffnungswinkel */
+  gluPerspective(FIELD_OF_VIEW,       /* oeffnungswinkel */
                  aspect,              /* Seitenverhaeltnis */
                  NEAR_CLIPPING_PLANE, /* nahe Clipping-Ebene */
                  FAR_CLIPPING_PLANE); /* ferne Clipping-Ebene */
@@ -673,6 +689,9 @@ cbDisplay(void)
   glutSetWindowTitle(fpsOutputBuffer);
   /* Framerate berechnen */
   fps = frameRate();
+
+  /* Aufloesung an die Framerate anpassen (nur bei eingeschaltetem Regler) */
+  setMeshResolution(governResolution(fps, getAmountVertices(), userResolution));
 }
 
 /**
@@ -684,14 +703,43 @@ void simulationController(double interval)
   /* der accumulator sammelt die Zeitintervalle, bis diese insgesamt groesser sind als eine Simulationszeit
      (die durch das Makro SIM_STEPS_PS festgelegt wird). Die Simulation erfolgt dann immer in gelich grossen Zeitstuecken*/
   static double accumulator;
+  GLint steps = 0;
+  double start = 0.0;
+  /* das implizite Verfahren ist unbedingt stabil und kommt mit wenigen groben Schritten aus */
+  double stepsPerSecond = getWaterSolver() == implicitSolver ? IMPLICIT_STEPS_PS : SIM_STEPS_PS;
+  /* bei feinen Gittern wird das Zeitintervall verkleinert, damit die Simulation stabil bleibt */
+  double stepInterval = getStableStepInterval() < (1.0f / stepsPerSecond) ? getStableStepInterval() : (1.0f / stepsPerSecond);
   accumulator += interval;
-  while (accumulator >= (1.0f / SIM_STEPS_PS))
+  while (accumulator >= stepInterval)
   {
+    steps++;
+    accumulator -= stepInterval;
+  }
+
+  /* der Regler laesst nur so viele Schritte zu, wie in das Zeitbudget passen, der Rest verfaellt */
+  steps = limitSimulationSteps(steps, interval);
 
-    simulateWater(1.0f / SIM_STEPS_PS);
+  /* alle faelligen Schritte am Stueck berechnen lassen, damit die Worker-Threads nur einmal geweckt werden */
+  start = getGovernorTime();
+  simulateWaterSteps(steps, stepInterval);
+  recordSimulationSteps(steps, getGovernorTime() - start);
+}
 
-    accumulator -= (1.0f / SIM_STEPS_PS);
+/**
+ * Ein Takt der Simulation: Anstoesse (z.B. Picks) einrastern, Simulation fortschreiben
+ * und den neuen Stand fuer die Darstellung veroeffentlichen. Laeuft auf dem
+ * Simulationsthread oder, falls es diesen nicht gibt, in den GLUT-Callbacks.
+ * @param interval seit dem letzten Takt vergangene Zeit in Sekunden
+ */
+static void simulationTick(double interval)
+{
+  processImpulses();
+  if (!isPaused)
+  {
+    simulationController(interval);
+    exportSimulationFrame();
   }
+  publishSimulation();
 }
 
 /**
@@ -707,9 +755,9 @@ cbIdle(void)
 
   /* Seit dem letzten Funktionsaufruf vergangene Zeit in Sekunden */
   double IdleInterval = (double)(thisCallTime - lastIdleCallTime) / 1000.0f;
-  if (!isPaused)
+  if (!isSimulationThreaded)
   {
-    simulationController(IdleInterval);
+    simulationTick(IdleInterval);
   }
   lastIdleCallTime = thisCallTime;
 }
@@ -729,13 +777,11 @@ cbTimer(int lastCallTime)
 
   /* Seit dem letzten Funktionsaufruf vergangene Zeit in Sekunden */
   interval = (double)(thisCallTime - lastCallTime) / 1000.0f;
-  if (!isPaused)
+  if (!isSimulationThreaded)
   {
-    simulationController(interval);
+    simulationTick(interval);
   }
 
-  updateNormals();
-
   calcLight1Rotation(interval);
 
   /* Wieder als Timer-Funktion registrieren */
@@ -813,7 +859,16 @@ int initAndStartIO(char *title, int width, int height)
   /* Fenster erzeugen */
   windowID = glutCreateWindow(title);
 
-  if (windowID)
+  /* GLEW initialisieren, Pufferobjekte setzen mindestens OpenGL 1.5 voraus */
+  if (windowID && ((glewInit() != GLEW_OK) || !GLEW_VERSION_1_5))
+  {
+    /* DEBUG-Ausgabe */
+    INFO(("...fehlgeschlagen (OpenGL 1.5 wird benoetigt).\n\n"));
+
+    glutDestroyWindow(windowID);
+    windowID = 0;
+  }
+  else if (windowID)
   {
 
     /* DEBUG-Ausgabe */
@@ -825,6 +880,8 @@ int initAndStartIO(char *title, int width, int height)
     initLogic();
     if (initScene())
     {
+      userResolution = getAmountVertices();
+
       /* DEBUG-Ausgabe */
       INFO(("...fertig.\n\n"));
 
@@ -835,6 +892,9 @@ int initAndStartIO(char *title, int width, int height)
 
         registerCallbacks();
 
+        /* Simulation auf eigenem Thread starten, ohne Threads laeuft sie in den Callbacks */
+        isSimulationThreaded = startSimulationThread(simulationTick);
+
         /* DEBUG-Ausgabe */
         INFO(("...fertig.\n\n"));
 
@@ -19,232 +19,2463 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <string.h>
 
 /* ---- Eigene Header einbinden ---- */
 #include "logic.h"
+#include "ocean.h"
 #include "scene.h"
+#include "simd.h"
+#include "atomics.h"
+#include "workers.h"
 
 /** Anzahl der Drehungen des rotierenden Lichtes pro Sekunde */
 #define LIGHT1_ROTATIONS_PS 0.25f
 
 #define ATTENUATION (0.999f)
 #define WAVE_SPEED (1.0f)
-#define WAVE_WIDTH ((2.0f) / (getAmountVertices() - (1)))
+/** Abstand zweier Wassersaeulen bei einem Gitter mit side Punkten pro Seite */
+#define WAVE_WIDTH(side) ((2.0f) / ((side) - (1)))
 
 #define PICK_HEIGHT (0.5f)
 
+/** Anteil des stabilen Zeitintervalls (1 / sqrt(2)), der hoechstens ausgenutzt wird */
+#define CFL_SAFETY (0.5)
+
+/**
+ * Kantenlaenge einer Kachel der Ruheerkennung in Wassersaeulen. Ein Vielfaches
+ * der SIMD-Breite, damit die Aufteilung einer Zeile in SIMD- und Einzelberechnung
+ * dieselbe ist wie beim Berechnen der ganzen Zeile.
+ */
+#define TILE_SIZE (32)
+
+/**
+ * Alle so viele Schritte wird die Aktivitaet der Kacheln neu bestimmt. Eine
+ * Stoerung breitet sich pro Schritt um hoechstens eine Saeule aus und kann
+ * daher in dieser Zeit die wache Nachbarkachel nicht durchqueren.
+ */
+#define SLEEP_CADENCE (16)
+
+/** Kacheln, deren Geschwindigkeiten darunter liegen, gelten als ruhend */
+#define SLEEP_VELOCITY (1e-3f)
+
+/** Kacheln, deren Beschleunigung (Kraft aus der Kruemmung) darunter liegt, gelten als ruhend */
+#define SLEEP_ACCELERATION (1e-2f)
+
+#ifndef MIN
+/** Minimum zweier Zahlen */
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+/** Maximum zweier Zahlen */
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Anzahl der Eintraege der Warteschlange fuer Anstoesse (Zweierpotenz) */
+#define IMPULSE_QUEUE_SIZE (4096)
+
+/** Markiert im mittleren Index des Dreifachpuffers einen noch nicht abgeholten Stand */
+#define SNAPSHOT_FRESH (4u)
+
+/** Feine Zellen pro Seite eines Patches: eine verfeinerte Kachel hat den halben Saeulenabstand */
+#define PATCH_SIDE (2 * TILE_SIZE)
+
+/** Zeilenlaenge eines Patches inkl. Geisterrand, aufgerundet auf ein Vielfaches der SIMD-Breite */
+#define PATCH_STRIDE (((PATCH_SIDE + 2 + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH)
+
+/** Anzahl der Werte eines Feldes eines Patches inkl. Geisterrand */
+#define PATCH_CELLS ((PATCH_SIDE + 2) * PATCH_STRIDE)
+
+/**
+ * Kruemmung (Nachbarsumme minus vierfache Hoehe im groben Gitter), ab der eine
+ * aktive Kachel verfeinert wird. Verfeinerte Kacheln bleiben es bis unter die
+ * Haelfte (Hysterese), damit sie nicht bei jeder Pruefung wechseln.
+ */
+#define REFINE_CURVATURE (0.02f)
+
+/** Hoechstens jede so vielte Kachel wird verfeinert */
+#define REFINE_SHARE (4)
+
+/** Seiten eines Patches, Index der Flussregister */
+#define SIDE_WEST (0)
+#define SIDE_EAST (1)
+#define SIDE_NORTH (2)
+#define SIDE_SOUTH (3)
+
 /* ---- Konstanten ---- */
 
-/** Status der der Lichtberechnung (an/aus) */
-static GLboolean g_lightingState = GL_TRUE;
+/** Status der der Lichtberechnung (an/aus) */
+static GLboolean g_lightingState = GL_TRUE;
+
+/** Status der ersten Lichtquelle (an/aus) */
+static GLboolean g_light0State = 1;
+
+/** Status der zweiten Lichtquelle (rotierend/aus/boot1/boot2) */
+static light1State g_light1State = 0;
+
+/** Rotationswinkel der zweiten Lichtquelle. */
+static float g_light1RotationAngle = 0.0f;
+
+/** Anzahl der Wassersaeulen pro Seite (ohne Geisterrand) */
+static GLint g_gridSide = 0;
+
+/**
+ * Laenge einer Zeile im Speicher: Seitenlaenge plus je eine Geisterzelle links
+ * und rechts, aufgerundet auf ein Vielfaches der SIMD-Breite
+ */
+static GLint g_gridStride = 0;
+
+/**
+ * Hoehen der Wassersaeulen in einem dynamisch alloziierten Array.
+ * Das Gitter ist von einem Rand aus Geisterzellen umgeben, die stets die Hoehe
+ * der benachbarten Randzelle tragen. Dadurch entfallen beim Bilden der
+ * Nachbarsumme alle Randabfragen.
+ */
+static GLfloat *heights;
+
+/** Zwischenspeicher fuer die neu berechneten Hoehen (gleiches Layout wie heights) */
+static GLfloat *nextHeights;
+
+/** Geschwindigkeiten der Wassersaeulen (gleiches Layout wie heights) */
+static GLfloat *velocities;
+
+/** Stand der Simulation, wird bei jeder Aenderung der Hoehen erhoeht */
+static GLuint g_simulationVersion = 0;
+
+/**
+ * Veroeffentlichter Stand der Simulation: Kopie der Hoehen und
+ * Geschwindigkeiten (gleiches Layout wie heights) und der Hoehen der Patches
+ * mit dem zugehoerigen Stand
+ */
+typedef struct
+{
+    GLfloat *heights;
+    GLfloat *velocities;
+    GLuint version;
+    /** Patches des Standes, ihre Hoehen liegen kompakt in patchHeights */
+    RefinedPatch *patches;
+    GLfloat *patchHeights;
+    GLint patchCount;
+    /** Stand der Aufteilung in Patches (g_patchLayout) */
+    GLuint patchLayout;
+} Snapshot;
+
+/**
+ * Dreifachpuffer der veroeffentlichten Staende. Die Simulation schreibt in
+ * den hinteren Puffer und tauscht ihn atomar gegen den mittleren, die
+ * Darstellung tauscht den vorderen Puffer gegen den mittleren, wenn dieser
+ * einen neuen Stand enthaelt. Keine Seite muss je auf die andere warten.
+ */
+static Snapshot g_snapshots[3];
+
+/** Index des hinteren Puffers, nur von der Simulation benutzt */
+static GLuint g_snapshotBack = 2;
+
+/** Index des mittleren Puffers, ggf. mit SNAPSHOT_FRESH, wird nur atomar getauscht */
+static GLuint g_snapshotMiddle = 1;
+
+/** Index des vorderen Puffers, nur von der Darstellung benutzt */
+static GLuint g_snapshotFront = 0;
+
+/** Zuletzt veroeffentlichter Stand der Simulation */
+static GLuint g_publishedVersion = 0;
+
+/**
+ * Ringpuffer der Anstoesse mit genau einem Schreiber (GLUT-Thread) und einem
+ * Leser (Simulation). g_impulseHead wird nur vom Schreiber, g_impulseTail
+ * nur vom Leser veraendert, beide laufen ueber den Puffer hinaus.
+ */
+static Impulse g_impulseQueue[IMPULSE_QUEUE_SIZE];
+static GLuint g_impulseHead = 0;
+static GLuint g_impulseTail = 0;
+
+/** Anzahl der Kacheln pro Seite, in die das Gitter fuer die Ruheerkennung zerlegt ist */
+static GLint g_tilesSide = 0;
+
+/** je Kachel: Wasser bewegt sich noch (Geschwindigkeit oder Kruemmung ueber der Schwelle) */
+static GLboolean *g_tileActive = NULL;
+
+/** je Kachel: wird simuliert, da sie selbst oder eine Nachbarkachel aktiv ist */
+static GLboolean *g_tileAwake = NULL;
+
+/** Anzahl der wachen Kacheln */
+static GLint g_awakeTiles = 0;
+
+/**
+ * Verfeinerte Kachel (Patch) des expliziten Verfahrens: Hoehen und
+ * Geschwindigkeiten mit halbem Saeulenabstand, jede grobe Saeule hat vier
+ * feine Zellen. Die feine Zelle (fx, fy) liegt bei (fy + 1) * PATCH_STRIDE +
+ * fx + 1 und gehoert zur Saeule (tileX * TILE_SIZE + fx / 2, tileY * TILE_SIZE
+ * + fy / 2). Der Geisterrand wird vor jedem feinen Schritt aus den
+ * Nachbarpatches bzw. dem groben Gitter befuellt.
+ */
+typedef struct
+{
+    /** Kachel, die der Patch verfeinert */
+    GLint tileX;
+    GLint tileY;
+    /** Anzahl der feinen Zellen pro Zeile bzw. Spalte (am Rand des Gitters weniger als PATCH_SIDE) */
+    GLint cellsX;
+    GLint cellsY;
+    /** gemeinsamer Speicher der drei Felder */
+    GLfloat *memory;
+    GLfloat *heights;
+    GLfloat *nextHeights;
+    GLfloat *velocities;
+    /**
+     * Flussregister je Seite und grober Saeule entlang der Seite: Summe der
+     * Fluesse, die die feinen Schritte ueber die Seite gerechnet haben, als
+     * Beitrag zur Geschwindigkeit bzw. Hoehe (ohne den Faktor der Kraft)
+     */
+    GLfloat fluxVelocity[4][TILE_SIZE];
+    GLfloat fluxHeight[4][TILE_SIZE];
+} Patch;
+
+/** Verfeinert das explizite Verfahren Kacheln mit starker Kruemmung? */
+static GLboolean g_refinement = GL_TRUE;
+
+/** je Kachel: Patch, der sie verfeinert, oder NULL */
+static Patch **g_tilePatch = NULL;
+
+/** Liste der Patches, ihre Anzahl und die Hoechstzahl (Budget) */
+static Patch **g_patches = NULL;
+static GLint g_patchCount = 0;
+static GLint g_patchCapacity = 0;
+
+/** Stand der Aufteilung in Patches, wird bei jedem Verfeinern und Vergroebern erhoeht */
+static GLuint g_patchLayout = 0;
+
+/** je Kachel: Kruemmung bei der letzten Pruefung, nur fuer die Auswahl der Patches */
+static GLfloat *g_tileCurvature = NULL;
+
+/** Kacheln, die verfeinert werden sollen, nach Kruemmung sortiert */
+static GLint *g_refineCandidates = NULL;
+
+/** Anzahl der insgesamt berechneten Simulationsschritte, bestimmt den Takt der Ruheerkennung */
+static GLuint g_stepCount = 0;
+
+/** Verfahren, mit dem die Hoehen berechnet werden */
+static waterSolver g_waterSolver = explicitSolver;
+
+/** Simulierte Zeit in Sekunden, bestimmt u.a. den Zustand des spektralen Verfahrens */
+static double g_simulationTime = 0.0;
+
+/**
+ * Vorberechnete Thomas-Elimination des impliziten Verfahrens: obere
+ * Nebendiagonale nach der Elimination und Kehrwerte der Pivotelemente
+ */
+static GLfloat *g_adiUpper = NULL;
+static GLfloat *g_adiInvPivot = NULL;
+
+/** Seitenlaenge und Kopplung a, fuer die die Elimination vorberechnet ist */
+static GLint g_adiSide = 0;
+static GLfloat g_adiCoupling = 0.0f;
+
+/** Privater Zwischenspeicher jedes Workers fuer die zeitliche Blockung */
+static GLfloat **g_workerScratch = NULL;
+
+/** Groesse der privaten Zwischenspeicher in Anzahl GLfloat */
+static size_t *g_workerScratchSize = NULL;
+
+/** Rechnet das explizite Verfahren auf Feldern in halber Genauigkeit? */
+static GLboolean g_halfStorage = GL_FALSE;
+
+/**
+ * Hoehen und Geschwindigkeiten in halber Genauigkeit (IEEE binary16, gleiches
+ * Layout wie heights) fuer das explizite Verfahren. Es gibt je zwei Puffer,
+ * ein Block von Schritten liest aus dem aktuellen und schreibt in den anderen.
+ */
+static GLushort *g_packedHeights[2] = {NULL, NULL};
+static GLushort *g_packedVelocities[2] = {NULL, NULL};
+
+/** Index des aktuellen Puffers der gepackten Felder */
+static GLint g_packedCurrent = 0;
+
+/** Seitenlaenge, fuer die die gepackten Felder angelegt sind */
+static GLint g_packedSide = 0;
+
+/**
+ * Enthalten die GLfloat-Felder (heights, velocities) bzw. die gepackten Felder
+ * den aktuellen Zustand? Mindestens eines von beiden ist immer aktuell.
+ */
+static GLboolean g_floatFieldsFresh = GL_TRUE;
+static GLboolean g_packedFieldsFresh = GL_FALSE;
+
+/**
+ * Liefert den Index der Wassersaeule (x, y) im Speicher inkl. Geisterrand
+ * @param x Spalte der Wassersaeule
+ * @param y Zeile der Wassersaeule
+ * @return Index im Hoehen- bzw. Geschwindigkeitsarray
+ */
+static GLint gridIndex(GLint x, GLint y)
+{
+    return (y + 1) * g_gridStride + (x + 1);
+}
+
+/**
+ * Berechnet die Zeilenlaenge im Speicher fuer eine Seitenlaenge
+ * @param side Anzahl der Wassersaeulen pro Seite
+ * @return Zeilenlaenge inkl. Geisterrand
+ */
+static GLint calcStride(GLint side)
+{
+    return ((side + 2 + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+}
+
+/**
+ * Reserviert ein mit 0 initialisiertes Gitter inkl. Geisterrand,
+ * beendet das Programm, wenn kein Speicher verfuegbar ist
+ * @param side Anzahl der Wassersaeulen pro Seite
+ * @return Zeiger auf das Gitter
+ */
+static GLfloat *allocGrid(GLint side)
+{
+    GLfloat *grid = calloc((size_t)(side + 2) * calcStride(side), sizeof(GLfloat));
+    if (grid == NULL)
+    {
+        exit(1);
+    }
+    return grid;
+}
+
+/**
+ * Wandelt einen Wert in halbe Genauigkeit um (gerundet zur naechsten, bei
+ * Gleichstand zur geraden Zahl wie F16C)
+ * @param value Wert
+ * @return Bitmuster des Wertes in halber Genauigkeit
+ */
+static GLushort floatToHalf(GLfloat value)
+{
+    GLuint bits = 0;
+    GLuint sign = 0;
+    GLuint mantissa = 0;
+    GLuint rest = 0;
+    GLuint halfway = 0;
+    GLuint half = 0;
+    GLint exponent = 0;
+    GLint shift = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+    sign = (bits >> 16) & 0x8000;
+    exponent = (GLint)((bits >> 23) & 0xFF) - 127 + 15;
+    mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF)
+    {
+        //unendlich bzw. keine Zahl
+        half = 0x7C00 | (mantissa != 0 ? 0x200 : 0);
+    }
+    else if (exponent >= 31)
+    {
+        half = 0x7C00;
+    }
+    else if (exponent <= 0)
+    {
+        //denormalisiert bzw. zu klein
+        if (exponent >= -10)
+        {
+            mantissa |= 0x800000;
+            shift = 14 - exponent;
+            half = mantissa >> shift;
+            rest = mantissa & ((1u << shift) - 1);
+            halfway = 1u << (shift - 1);
+            half += (rest > halfway) || ((rest == halfway) && (half & 1));
+        }
+    }
+    else
+    {
+        //ein Uebertrag beim Runden erhoeht korrekt den Exponenten (ggf. bis unendlich)
+        half = ((GLuint)exponent << 10) | (mantissa >> 13);
+        rest = mantissa & 0x1FFF;
+        half += (rest > 0x1000) || ((rest == 0x1000) && (half & 1));
+    }
+    return (GLushort)(sign | half);
+}
+
+/**
+ * Wandelt einen Wert halber Genauigkeit in GLfloat um
+ * @param value Bitmuster des Wertes in halber Genauigkeit
+ * @return Wert
+ */
+static GLfloat halfToFloat(GLushort value)
+{
+    GLuint sign = (GLuint)(value & 0x8000) << 16;
+    GLuint exponent = (value >> 10) & 0x1F;
+    GLuint mantissa = value & 0x3FF;
+    GLuint bits = 0;
+    GLfloat result = 0.0f;
+
+    if (exponent == 0)
+    {
+        //denormalisiert: mantissa * 2^-24
+        result = (GLfloat)mantissa * 5.9604644775390625e-8f;
+        result = sign ? -result : result;
+    }
+    else
+    {
+        bits = sign | (exponent == 31 ? 0x7F800000 : (exponent + 112) << 23) | (mantissa << 13);
+        memcpy(&result, &bits, sizeof(result));
+    }
+    return result;
+}
+
+/**
+ * Wandelt Werte in halbe Genauigkeit um
+ * @param src Werte
+ * @param dst Ziel (Out)
+ * @param count Anzahl der Werte
+ */
+static void packValues(const GLfloat *src, GLushort *dst, size_t count)
+{
+    size_t i = 0;
+
+#ifdef SIMD_HALF
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+    {
+        SIMD_STORE_HALF(dst + i, SIMD_LOAD(src + i));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dst[i] = floatToHalf(src[i]);
+    }
+}
+
+/**
+ * Wandelt Werte halber Genauigkeit in GLfloat um
+ * @param src Werte in halber Genauigkeit
+ * @param dst Ziel (Out)
+ * @param count Anzahl der Werte
+ */
+static void unpackValues(const GLushort *src, GLfloat *dst, size_t count)
+{
+    size_t i = 0;
+
+#ifdef SIMD_HALF
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+    {
+        SIMD_STORE(dst + i, SIMD_LOAD_HALF(src + i));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dst[i] = halfToFloat(src[i]);
+    }
+}
+
+/**
+ * Stellt sicher, dass heights und velocities den aktuellen Zustand enthalten
+ * (entpackt die gepackten Felder, wenn zuletzt auf diesen gerechnet wurde)
+ */
+static void syncFloatFields(void)
+{
+    size_t count = (size_t)(g_gridSide + 2) * g_gridStride;
+
+    if (!g_floatFieldsFresh)
+    {
+        unpackValues(g_packedHeights[g_packedCurrent], heights, count);
+        unpackValues(g_packedVelocities[g_packedCurrent], velocities, count);
+        g_floatFieldsFresh = GL_TRUE;
+    }
+}
+
+/**
+ * Stellt sicher, dass die gepackten Felder fuer die aktuelle Seitenlaenge
+ * angelegt sind und den aktuellen Zustand enthalten
+ */
+static void syncPackedFields(void)
+{
+    size_t count = (size_t)(g_gridSide + 2) * g_gridStride;
+    GLint i = 0;
+
+    if (g_packedSide != g_gridSide)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            free(g_packedHeights[i]);
+            free(g_packedVelocities[i]);
+            g_packedHeights[i] = malloc(count * sizeof(GLushort));
+            g_packedVelocities[i] = malloc(count * sizeof(GLushort));
+            if ((g_packedHeights[i] == NULL) || (g_packedVelocities[i] == NULL))
+            {
+                exit(1);
+            }
+        }
+        g_packedSide = g_gridSide;
+        g_packedFieldsFresh = GL_FALSE;
+    }
+    if (!g_packedFieldsFresh)
+    {
+        packValues(heights, g_packedHeights[g_packedCurrent], count);
+        packValues(velocities, g_packedVelocities[g_packedCurrent], count);
+        g_packedFieldsFresh = GL_TRUE;
+    }
+}
+
+/**
+ * Legt die drei Puffer der veroeffentlichten Staende fuer die aktuelle
+ * Seitenlaenge neu an und setzt den aktuellen Stand direkt in den vorderen
+ * Puffer. Patches gibt es zu diesem Zeitpunkt keine (siehe allocTiles), ihre
+ * Puffer werden fuer das Budget der Seitenlaenge angelegt. Darf nur
+ * aufgerufen werden, waehrend die Simulation nicht rechnet und die
+ * Darstellung nicht liest.
+ */
+static void allocSnapshots(void)
+{
+    GLint i = 0;
+    size_t size = (size_t)(g_gridSide + 2) * g_gridStride * sizeof(GLfloat);
+
+    for (i = 0; i < 3; i++)
+    {
+        free(g_snapshots[i].heights);
+        free(g_snapshots[i].velocities);
+        free(g_snapshots[i].patches);
+        free(g_snapshots[i].patchHeights);
+        g_snapshots[i].heights = allocGrid(g_gridSide);
+        g_snapshots[i].velocities = allocGrid(g_gridSide);
+        g_snapshots[i].patches = malloc(g_patchCapacity * sizeof(RefinedPatch));
+        g_snapshots[i].patchHeights = malloc((size_t)g_patchCapacity * SQUARE(PATCH_SIDE) * sizeof(GLfloat));
+        if ((g_snapshots[i].patches == NULL) || (g_snapshots[i].patchHeights == NULL))
+        {
+            exit(1);
+        }
+        g_snapshots[i].version = g_simulationVersion;
+        g_snapshots[i].patchCount = 0;
+        g_snapshots[i].patchLayout = g_patchLayout;
+    }
+    memcpy(g_snapshots[0].heights, heights, size);
+    memcpy(g_snapshots[0].velocities, velocities, size);
+
+    g_snapshotFront = 0;
+    g_snapshotMiddle = 1;
+    g_snapshotBack = 2;
+    g_publishedVersion = g_simulationVersion;
+}
+
+/**
+ * Setzt die Geisterzellen einer Zeile auf die Werte der Randzellen
+ * @param row Zeiger auf die erste Wassersaeule der Zeile
+ */
+static void refreshGhostColumns(GLfloat *row)
+{
+    row[-1] = row[0];
+    row[g_gridSide] = row[g_gridSide - 1];
+}
+
+/**
+ * Setzt die obere und untere Geisterzeile eines Gitters auf die Werte der
+ * ersten bzw. letzten Zeile
+ * @param grid Gitter, dessen Rand aktualisiert wird
+ */
+static void refreshGhostRows(GLfloat *grid)
+{
+    memcpy(grid, grid + g_gridStride, g_gridStride * sizeof(GLfloat));
+    memcpy(grid + (g_gridSide + 1) * g_gridStride, grid + g_gridSide * g_gridStride, g_gridStride * sizeof(GLfloat));
+}
+
+/**
+ * Setzt den kompletten Geisterrand eines Gitters auf die Werte der Randzellen
+ * @param grid Gitter, dessen Rand aktualisiert wird
+ */
+static void refreshGhostBorder(GLfloat *grid)
+{
+    GLint y = 0;
+    for (y = 0; y < g_gridSide; y++)
+    {
+        refreshGhostColumns(grid + gridIndex(0, y));
+    }
+    refreshGhostRows(grid);
+}
+
+/**
+ * Gibt alle Patches frei. Die groben Saeulen darunter enthalten stets den
+ * Mittelwert ihrer feinen Zellen, die Wellen laufen daher mit der groben
+ * Aufloesung weiter.
+ */
+static void dropPatches(void)
+{
+    GLint i = 0;
+
+    for (i = 0; i < g_patchCount; i++)
+    {
+        g_tilePatch[g_patches[i]->tileY * g_tilesSide + g_patches[i]->tileX] = NULL;
+        free(g_patches[i]->memory);
+        free(g_patches[i]);
+    }
+    if (g_patchCount > 0)
+    {
+        g_patchCount = 0;
+        g_patchLayout++;
+        g_simulationVersion++;
+    }
+}
+
+/**
+ * Legt die Kacheln der Ruheerkennung fuer die aktuelle Seitenlaenge an,
+ * alle Kacheln sind zunaechst aktiv und unverfeinert
+ */
+static void allocTiles(void)
+{
+    GLint i = 0;
+
+    dropPatches();
+    g_tilesSide = (g_gridSide + TILE_SIZE - 1) / TILE_SIZE;
+    g_patchCapacity = MAX(SQUARE(g_tilesSide) / REFINE_SHARE, 1);
+    free(g_tileActive);
+    free(g_tileAwake);
+    free(g_tilePatch);
+    free(g_tileCurvature);
+    free(g_refineCandidates);
+    free(g_patches);
+    g_tileActive = malloc(SQUARE(g_tilesSide) * sizeof(GLboolean));
+    g_tileAwake = malloc(SQUARE(g_tilesSide) * sizeof(GLboolean));
+    g_tilePatch = malloc(SQUARE(g_tilesSide) * sizeof(Patch *));
+    g_tileCurvature = malloc(SQUARE(g_tilesSide) * sizeof(GLfloat));
+    g_refineCandidates = malloc(SQUARE(g_tilesSide) * sizeof(GLint));
+    g_patches = malloc(g_patchCapacity * sizeof(Patch *));
+    if ((g_tileActive == NULL) || (g_tileAwake == NULL) || (g_tilePatch == NULL) || (g_tileCurvature == NULL) ||
+        (g_refineCandidates == NULL) || (g_patches == NULL))
+    {
+        exit(1);
+    }
+    for (i = 0; i < SQUARE(g_tilesSide); i++)
+    {
+        g_tileActive[i] = GL_TRUE;
+        g_tileAwake[i] = GL_TRUE;
+        g_tilePatch[i] = NULL;
+    }
+    g_awakeTiles = SQUARE(g_tilesSide);
+}
+
+/**
+ * Legt eine Kachel schlafen: die Geschwindigkeiten werden 0 und beide
+ * Hoehenpuffer erhalten dieselben Werte, sodass die Kachel bis zum Aufwachen
+ * von keinem Simulationsschritt mehr angefasst werden muss.
+ * @param tx Spalte der Kachel
+ * @param ty Zeile der Kachel
+ */
+static void sleepTile(GLint tx, GLint ty)
+{
+    GLint x = tx * TILE_SIZE;
+    GLint count = MIN(TILE_SIZE, g_gridSide - x);
+    GLint y = 0;
+    GLint i = 0;
+
+    for (y = ty * TILE_SIZE; y < MIN((ty + 1) * TILE_SIZE, g_gridSide); y++)
+    {
+        i = gridIndex(x, y);
+        if (g_floatFieldsFresh)
+        {
+            memset(velocities + i, 0, count * sizeof(GLfloat));
+            memcpy(nextHeights + i, heights + i, count * sizeof(GLfloat));
+        }
+        //in halber Genauigkeit ist +0 ebenfalls das Bitmuster 0
+        if (g_packedFieldsFresh)
+        {
+            memset(g_packedVelocities[g_packedCurrent] + i, 0, count * sizeof(GLushort));
+        }
+    }
+}
+
+/**
+ * Bestimmt aus den aktiven Kacheln die wachen Kacheln (aktiv oder aktive
+ * Nachbarkachel) und legt Kacheln schlafen, die nicht mehr wach sind
+ */
+static void refreshTilesAwake(void)
+{
+    GLint tx, ty, nx, ny;
+    GLboolean awake = GL_FALSE;
+
+    g_awakeTiles = 0;
+    for (ty = 0; ty < g_tilesSide; ty++)
+    {
+        for (tx = 0; tx < g_tilesSide; tx++)
+        {
+            awake = GL_FALSE;
+            for (ny = MAX(ty - 1, 0); ny <= MIN(ty + 1, g_tilesSide - 1); ny++)
+            {
+                for (nx = MAX(tx - 1, 0); nx <= MIN(tx + 1, g_tilesSide - 1); nx++)
+                {
+                    awake = awake || g_tileActive[ny * g_tilesSide + nx];
+                }
+            }
+
+            if (g_tileAwake[ty * g_tilesSide + tx] && !awake)
+            {
+                sleepTile(tx, ty);
+            }
+            g_tileAwake[ty * g_tilesSide + tx] = awake;
+            g_awakeTiles += awake;
+        }
+    }
+}
+
+/**
+ * Bestimmt, ob sich das Wasser in einem Bereich noch bewegt
+ * @param h Zeiger auf die erste Wassersaeule des Bereichs in den Hoehen (mit Rand)
+ * @param v Zeiger auf die erste Wassersaeule des Bereichs in den Geschwindigkeiten
+ * @param stride Zeilenlaenge von h und v
+ * @param width Anzahl der Wassersaeulen pro Zeile des Bereichs
+ * @param rows Anzahl der Zeilen des Bereichs
+ * @param force Faktor, mit dem die Nachbarsumme in eine Kraft umgerechnet wird
+ * @return GL_TRUE, wenn Geschwindigkeit oder Beschleunigung einer Saeule ueber der Schwelle liegt
+ */
+static GLboolean isRegionActive(const GLfloat *h, const GLfloat *v, GLint stride, GLint width, GLint rows,
+                                GLfloat force)
+{
+    GLboolean active = GL_FALSE;
+    GLint x, y;
+    GLint i = 0;
+
+    for (y = 0; !active && (y < rows); y++)
+    {
+        for (x = 0; !active && (x < width); x++)
+        {
+            i = y * stride + x;
+            active = (fabsf(v[i]) > SLEEP_VELOCITY) ||
+                     (fabsf(force * (((h[i - 1] + h[i + 1]) + (h[i - stride] + h[i + stride])) - 4.0f * h[i])) > SLEEP_ACCELERATION);
+        }
+    }
+    return active;
+}
+
+/**
+ * Bestimmt fuer alle wachen Kacheln, ob sich das Wasser darin noch bewegt.
+ * Ruhende Kacheln koennen nur durch aktive Nachbarn oder Picking gestoert
+ * werden und muessen daher nicht geprueft werden. Verfeinerte Kacheln gelten
+ * als aktiv, bis regridPatches sie vergroebert. Liegt der Zustand nur in
+ * halber Genauigkeit vor, wird jede Kachel samt Rand einzeln entpackt.
+ * @param force Faktor, mit dem die Nachbarsumme in eine Kraft umgerechnet wird
+ */
+static void updateTileActivity(GLfloat force)
+{
+    GLfloat tileHeights[SQUARE(TILE_SIZE + 2)];
+    GLfloat tileVelocities[SQUARE(TILE_SIZE + 2)];
+    GLint tx, ty, x, y;
+    GLint width = 0;
+    GLint rows = 0;
+    GLint i = 0;
+    GLboolean active = GL_FALSE;
+
+    for (ty = 0; ty < g_tilesSide; ty++)
+    {
+        for (tx = 0; tx < g_tilesSide; tx++)
+        {
+            if (g_tileAwake[ty * g_tilesSide + tx])
+            {
+                x = tx * TILE_SIZE;
+                y = ty * TILE_SIZE;
+                width = MIN(TILE_SIZE, g_gridSide - x);
+                rows = MIN(TILE_SIZE, g_gridSide - y);
+                if (g_floatFieldsFresh)
+                {
+                    active = isRegionActive(heights + gridIndex(x, y), velocities + gridIndex(x, y), g_gridStride,
+                                            width, rows, force);
+                }
+                else
+                {
+                    for (i = -1; i <= rows; i++)
+                    {
+                        unpackValues(g_packedHeights[g_packedCurrent] + gridIndex(x - 1, y + i),
+                                     tileHeights + (i + 1) * (TILE_SIZE + 2), width + 2);
+                        unpackValues(g_packedVelocities[g_packedCurrent] + gridIndex(x - 1, y + i),
+                                     tileVelocities + (i + 1) * (TILE_SIZE + 2), width + 2);
+                    }
+                    active = isRegionActive(tileHeights + TILE_SIZE + 3, tileVelocities + TILE_SIZE + 3,
+                                            TILE_SIZE + 2, width, rows, force);
+                }
+                //verfeinerte Kacheln bleiben wach, bis sie vergroebert werden
+                g_tileActive[ty * g_tilesSide + tx] = active || (g_tilePatch[ty * g_tilesSide + tx] != NULL);
+            }
+        }
+    }
+    refreshTilesAwake();
+}
+
+void freeAllocatedMemLogic(void)
+{
+    GLint i = 0;
+    free(heights);
+    free(nextHeights);
+    free(velocities);
+    for (i = 0; i < getWorkerCount(); i++)
+    {
+        free(g_workerScratch[i]);
+    }
+    free(g_workerScratch);
+    free(g_workerScratchSize);
+    dropPatches();
+    free(g_tileActive);
+    free(g_tileAwake);
+    free(g_tilePatch);
+    free(g_tileCurvature);
+    free(g_refineCandidates);
+    free(g_patches);
+    free(g_adiUpper);
+    free(g_adiInvPivot);
+    for (i = 0; i < 2; i++)
+    {
+        free(g_packedHeights[i]);
+        free(g_packedVelocities[i]);
+    }
+    for (i = 0; i < 3; i++)
+    {
+        free(g_snapshots[i].heights);
+        free(g_snapshots[i].velocities);
+        free(g_snapshots[i].patches);
+        free(g_snapshots[i].patchHeights);
+    }
+    freeOcean();
+}
+
+void initLogic(void)
+{
+    g_gridSide = START_AMOUNT_VERTICES;
+    g_gridStride = calcStride(g_gridSide);
+    heights = allocGrid(g_gridSide);
+    nextHeights = allocGrid(g_gridSide);
+    velocities = allocGrid(g_gridSide);
+    allocTiles();
+    allocSnapshots();
+
+    //die Zwischenspeicher der Worker werden erst bei Bedarf angelegt
+    g_workerScratch = calloc(getWorkerCount(), sizeof(GLfloat *));
+    g_workerScratchSize = calloc(getWorkerCount(), sizeof(size_t));
+    if ((g_workerScratch == NULL) || (g_workerScratchSize == NULL))
+    {
+        exit(1);
+    }
+}
+
+double getStableStepInterval(void)
+{
+    //das implizite Verfahren ist unbedingt stabil, das spektrale berechnet jeden Zeitpunkt direkt
+    if (g_waterSolver != explicitSolver)
+    {
+        return DBL_MAX;
+    }
+    //explizites Verfahren in 2D ist stabil fuer WAVE_SPEED * dt / Abstand <= 1 / sqrt(2)
+    return CFL_SAFETY * WAVE_WIDTH(g_gridSide) / WAVE_SPEED;
+}
+
+/**
+ * Berechnet die Hoehen des spektralen Verfahrens zur aktuellen simulierten Zeit
+ */
+static void evaluateSpectralHeights(void)
+{
+    evaluateOcean(g_simulationTime, heights + gridIndex(0, 0), g_gridStride, g_gridSide);
+    refreshGhostBorder(heights);
+    g_simulationVersion++;
+}
+
+/**
+ * Uebertraegt die Werte eines Gitters in ein Gitter anderer Groesse. Beide
+ * Gitter ueberspannen dieselbe Flaeche, die Werte werden bilinear
+ * interpoliert, sodass die Wellen beim Wechsel der Aufloesung erhalten bleiben.
+ * @param oldGrid Quellgitter mit dem aktuellen Layout
+ * @param newSide Seitenlaenge des neuen Gitters
+ * @return neues Gitter, das Quellgitter wird freigegeben
+ */
+static GLfloat *resizeGrid(GLfloat *oldGrid, GLint newSide)
+{
+    GLint newStride = calcStride(newSide);
+    GLfloat *newGrid = allocGrid(newSide);
+    GLfloat scale = newSide > 1 ? (GLfloat)(g_gridSide - 1) / (GLfloat)(newSide - 1) : 0.0f;
+    const GLfloat *row0 = NULL;
+    const GLfloat *row1 = NULL;
+    GLfloat fx, fy;
+    GLint x, y, x0, x1, y0;
+
+    for (y = 0; y < newSide; y++)
+    {
+        y0 = MIN((GLint)(y * scale), g_gridSide - 1);
+        fy = y * scale - y0;
+        row0 = oldGrid + gridIndex(0, y0);
+        row1 = oldGrid + gridIndex(0, MIN(y0 + 1, g_gridSide - 1));
+        for (x = 0; x < newSide; x++)
+        {
+            x0 = MIN((GLint)(x * scale), g_gridSide - 1);
+            x1 = MIN(x0 + 1, g_gridSide - 1);
+            fx = x * scale - x0;
+            newGrid[(y + 1) * newStride + x + 1] = (1.0f - fy) * ((1.0f - fx) * row0[x0] + fx * row0[x1]) +
+                                                   fy * ((1.0f - fx) * row1[x0] + fx * row1[x1]);
+        }
+    }
+    free(oldGrid);
+    return newGrid;
+}
+
+void updateLogic(GLint amountVerticesSide)
+{
+    GLint newSide = amountVerticesSide;
+
+    syncFloatFields();
+    g_packedFieldsFresh = GL_FALSE;
+    heights = resizeGrid(heights, newSide);
+    velocities = resizeGrid(velocities, newSide);
+    free(nextHeights);
+    nextHeights = allocGrid(newSide);
+
+    g_gridSide = newSide;
+    g_gridStride = calcStride(newSide);
+    refreshGhostBorder(heights);
+    allocTiles();
+    g_simulationVersion++;
+
+    if (g_waterSolver == spectralSolver)
+    {
+        evaluateSpectralHeights();
+    }
+    allocSnapshots();
+}
+
+/**
+ * Berechnet eine Zeile der Wassersimulation.
+ * Die gewichtete Summe der Nachbarhoehen (Nachbarn mit +1, der Punkt selbst
+ * mit -4) wird ohne Randabfragen gebildet, da der Geisterrand die Hoehe der
+ * Randzellen enthaelt. Es werden SIMD_WIDTH Wassersaeulen gleichzeitig berechnet.
+ * @param h Zeiger auf die erste Wassersaeule der Zeile in den aktuellen Hoehen
+ * @param hNext Zeiger auf die erste Wassersaeule der Zeile in den neuen Hoehen
+ * @param v Zeiger auf die erste Wassersaeule der Zeile in den Geschwindigkeiten
+ * @param count Anzahl der Wassersaeulen der Zeile
+ * @param stride Zeilenlaenge des Gitters (g_gridStride bzw. PATCH_STRIDE)
+ * @param force Faktor, mit dem die Nachbarsumme in eine Kraft umgerechnet wird
+ * @param dt Zeitintervall, das simuliert wird in Sekunden
+ * @param attenuation Daempfung der Geschwindigkeit pro Schritt
+ */
+static void simulateRow(const GLfloat *h, GLfloat *hNext, GLfloat *v, GLint count, GLint stride, GLfloat force,
+                        GLfloat dt, GLfloat attenuation)
+{
+    GLint x = 0;
+    GLfloat neighbours = 0.0f;
+
+#if SIMD_WIDTH > 1
+    const SIMD_FLOAT vecForce = SIMD_SET1(force);
+    const SIMD_FLOAT vecDt = SIMD_SET1(dt);
+    const SIMD_FLOAT vecAttenuation = SIMD_SET1(attenuation);
+    const SIMD_FLOAT vecFour = SIMD_SET1(4.0f);
+    SIMD_FLOAT centre, sum, vel;
+
+    for (; x + SIMD_WIDTH <= count; x += SIMD_WIDTH)
+    {
+        centre = SIMD_LOAD(h + x);
+        sum = SIMD_ADD(SIMD_ADD(SIMD_LOAD(h + x - 1), SIMD_LOAD(h + x + 1)),
+                       SIMD_ADD(SIMD_LOAD(h + x - stride), SIMD_LOAD(h + x + stride)));
+        sum = SIMD_SUB(sum, SIMD_MUL(vecFour, centre));
+        vel = SIMD_ADD(SIMD_LOAD(v + x), SIMD_MUL(SIMD_MUL(sum, vecForce), vecDt));
+        vel = SIMD_MUL(vel, vecAttenuation);
+        SIMD_STORE(v + x, vel);
+        SIMD_STORE(hNext + x, SIMD_ADD(centre, SIMD_MUL(vel, vecDt)));
+    }
+#endif
+
+    //Restliche Wassersaeulen der Zeile einzeln berechnen
+    for (; x < count; x++)
+    {
+        neighbours = ((h[x - 1] + h[x + 1]) + (h[x - stride] + h[x + stride])) - 4.0f * h[x];
+        v[x] = (v[x] + neighbours * force * dt) * attenuation;
+        hNext[x] = h[x] + v[x] * dt;
+    }
+}
+
+/** Mindestanzahl an Zeilen pro Streifen, damit sich das Verteilen auf Threads lohnt */
+#define MIN_ROWS_PER_STRIP (16)
+
+/** Hoechstzahl an Schritten, die am Stueck fuer eine Zeile berechnet werden (zeitliche Blockung) */
+#define MAX_TIME_BLOCK (8)
+
+/** Speicher, in dem die Zeilen einer Wellenfront Platz finden sollen (Anteil des L2-Caches) */
+#define TIME_BLOCK_CACHE_BYTES (256 * 1024)
+
+/** Speicher, in dem ein entpackter Teilstreifen samt Halo Platz finden soll (halbe Genauigkeit) */
+#define PACKED_STRIP_CACHE_BYTES (1024 * 1024)
+
+/**
+ * Parameter eines Simulationsauftrags fuer die Worker
+ */
+typedef struct
+{
+    GLint steps;     /**< Anzahl der Simulationsschritte */
+    GLint timeBlock; /**< Anzahl der Schritte, die pro Block am Stueck berechnet werden */
+    GLfloat force;   /**< Faktor, mit dem die Nachbarsumme in eine Kraft umgerechnet wird */
+    GLfloat dt;      /**< Zeitintervall eines Schrittes in Sekunden */
+} SimulationJob;
+
+/**
+ * Berechnet eine Zeile eines Simulationsschrittes und fuehrt den Geisterrand
+ * der neuen Hoehen mit (Geisterspalten, an Ober- und Unterkante auch die Geisterzeile)
+ * @param h Zeiger auf die erste Wassersaeule der Zeile in den aktuellen Hoehen
+ * @param hNext Zeiger auf die erste Wassersaeule der Zeile in den neuen Hoehen
+ * @param v Zeiger auf die erste Wassersaeule der Zeile in den Geschwindigkeiten
+ * @param y Zeile im Gitter
+ * @param force Faktor, mit dem die Nachbarsumme in eine Kraft umgerechnet wird
+ * @param dt Zeitintervall, das simuliert wird in Sekunden
+ */
+static void simulateGridRow(const GLfloat *h, GLfloat *hNext, GLfloat *v, GLint y, GLfloat force, GLfloat dt)
+{
+    const GLboolean *awake = g_tileAwake + (y / TILE_SIZE) * g_tilesSide;
+    GLint first = 0;
+    GLint last = 0;
+
+    if (g_awakeTiles == SQUARE(g_tilesSide))
+    {
+        simulateRow(h, hNext, v, g_gridSide, g_gridStride, force, dt, ATTENUATION);
+    }
+    else
+    {
+        //nur zusammenhaengende Abschnitte wacher Kacheln berechnen, ruhende sind in beiden Puffern gleich
+        while (first < g_tilesSide)
+        {
+            if (!awake[first])
+            {
+                first++;
+            }
+            else
+            {
+                last = first + 1;
+                while ((last < g_tilesSide) && awake[last])
+                {
+                    last++;
+                }
+                simulateRow(h + first * TILE_SIZE, hNext + first * TILE_SIZE, v + first * TILE_SIZE,
+                            MIN(last * TILE_SIZE, g_gridSide) - first * TILE_SIZE, g_gridStride, force, dt,
+                            ATTENUATION);
+                first = last;
+            }
+        }
+    }
+    refreshGhostColumns(hNext);
+
+    if (y == 0)
+    {
+        memcpy(hNext - 1 - g_gridStride, hNext - 1, g_gridStride * sizeof(GLfloat));
+    }
+    if (y == g_gridSide - 1)
+    {
+        memcpy(hNext - 1 + g_gridStride, hNext - 1, g_gridStride * sizeof(GLfloat));
+    }
+}
+
+/**
+ * Berechnet mehrere Simulationsschritte als Wellenfront ueber die Zeilen
+ * (zeitliche Blockung). In einem Durchlauf der Front wird Schritt 1 fuer Zeile r,
+ * Schritt 2 fuer Zeile r - 1, ... berechnet. Die Zeilen, die ein Schritt liest,
+ * wurden kurz zuvor vom vorherigen Schritt geschrieben und liegen noch im Cache,
+ * sodass das Gitter pro Block nur einmal aus dem Speicher gelesen wird.
+ * Jede Zeile wird mit derselben Funktion wie beim schrittweisen Rechnen
+ * berechnet, das Ergebnis ist daher bitgenau identisch.
+ * Zeilen ausserhalb von [first, last) werden nur soweit berechnet, wie sie fuer
+ * spaetere Schritte der Zielzeilen gebraucht werden.
+ * @param buffers die beiden Hoehenpuffer, buffers[0] enthaelt den Ausgangszustand,
+ *        das Ergebnis liegt anschliessend in buffers[steps % 2]
+ * @param v Geschwindigkeiten (werden direkt aktualisiert)
+ * @param rowOffset Zeile des Gitters, die in den Puffern an erster Stelle liegt
+ * @param first erste Zeile, die nach allen Schritten gueltig sein muss
+ * @param last Zeile hinter der letzten Zeile, die gueltig sein muss
+ * @param steps Anzahl der Schritte
+ * @param force Faktor, mit dem die Nachbarsumme in eine Kraft umgerechnet wird
+ * @param dt Zeitintervall eines Schrittes in Sekunden
+ */
+static void simulateWavefront(GLfloat *buffers[2], GLfloat *v, GLint rowOffset, GLint first, GLint last,
+                              GLint steps, GLfloat force, GLfloat dt)
+{
+    GLint frontFirst = MAX(first - (steps - 1), 0);
+    GLint frontLast = MIN(last + (steps - 1), g_gridSide) + (steps - 1);
+    GLint front = 0;
+    GLint step = 0;
+    GLint y = 0;
+    GLint lower = 0;
+    GLint upper = 0;
+    GLint i = 0;
+
+    for (front = frontFirst; front < frontLast; front++)
+    {
+        for (step = 1; step <= steps; step++)
+        {
+            //Bereich, den dieser Schritt fuer die spaeteren Schritte liefern muss
+            lower = MAX(first - (steps - step), 0);
+            upper = MIN(last + (steps - step), g_gridSide);
+            y = front - (step - 1);
+
+            if ((y >= lower) && (y < upper))
+            {
+                i = (y - rowOffset) * g_gridStride + 1;
+                simulateGridRow(buffers[(step - 1) % 2] + i, buffers[step % 2] + i, v + i, y, force, dt);
+            }
+        }
+    }
+}
+
+/**
+ * Berechnet einen Streifen von Zeilen fuer alle Schritte eines Auftrags.
+ * Das Gitter wird in zusammenhaengende Zeilenstreifen zerlegt, jeder Worker
+ * liest nur die jeweils angrenzende Zeile (Halo) der Nachbarstreifen mit. Da
+ * alle Worker in den einen Puffer schreiben und aus dem anderen lesen, genuegt
+ * eine Barriere pro Schritt, bevor die Puffer getauscht werden.
+ * @param worker Nummer des Workers
+ * @param workerCount Anzahl der beteiligten Worker
+ * @param arg Parameter des Auftrags (SimulationJob)
+ */
+static void simulateStrip(GLint worker, GLint workerCount, void *arg)
+{
+    const SimulationJob *job = arg;
+    GLint firstRow = g_gridSide * worker / workerCount;
+    GLint lastRow = g_gridSide * (worker + 1) / workerCount;
+    GLfloat *current = heights;
+    GLfloat *next = nextHeights;
+    GLfloat *swap = NULL;
+    GLint step = 0;
+    GLint y = 0;
+    GLint i = 0;
+
+    for (step = 0; step < job->steps; step++)
+    {
+        for (y = firstRow; y < lastRow; y++)
+        {
+            i = gridIndex(0, y);
+            simulateGridRow(current + i, next + i, velocities + i, y, job->force, job->dt);
+        }
+
+        //alle Zeilen des Schrittes muessen fertig sein, bevor die Puffer getauscht werden
+        if (step < job->steps - 1)
+        {
+            waitAtBarrier();
+        }
+        swap = current;
+        current = next;
+        next = swap;
+    }
+}
+
+/**
+ * Liefert den privaten Zwischenspeicher eines Workers, vergroessert ihn bei Bedarf
+ * @param worker Nummer des Workers
+ * @param count benoetigte Anzahl GLfloat
+ * @return Zwischenspeicher
+ */
+static GLfloat *reserveWorkerScratch(GLint worker, size_t count)
+{
+    if (g_workerScratchSize[worker] < count)
+    {
+        g_workerScratch[worker] = realloc(g_workerScratch[worker], count * sizeof(GLfloat));
+        if (g_workerScratch[worker] == NULL)
+        {
+            exit(1);
+        }
+        g_workerScratchSize[worker] = count;
+    }
+    return g_workerScratch[worker];
+}
+
+/**
+ * Berechnet einen Streifen von Zeilen mit zeitlicher Blockung.
+ * Jeder Worker kopiert seinen Streifen samt einem Halo von timeBlock Zeilen in
+ * seinen privaten Zwischenspeicher, berechnet dort timeBlock Schritte als
+ * Wellenfront (die Halo-Zeilen werden dabei redundant mitgerechnet) und
+ * schreibt nur die eigenen Zeilen zurueck. Statt einer Barriere pro Schritt
+ * sind so nur zwei Barrieren pro Block noetig.
+ * @param worker Nummer des Workers
+ * @param workerCount Anzahl der beteiligten Worker
+ * @param arg Parameter des Auftrags (SimulationJob)
+ */
+static void simulateStripBlocked(GLint worker, GLint workerCount, void *arg)
+{
+    const SimulationJob *job = arg;
+    GLint firstRow = g_gridSide * worker / workerCount;
+    GLint lastRow = g_gridSide * (worker + 1) / workerCount;
+    //Kopierbereich inkl. Halo, an den Kanten inkl. der Geisterzeile
+    GLint copyFirst = MAX(firstRow - job->timeBlock, -1);
+    GLint copyLast = MIN(lastRow + job->timeBlock, g_gridSide + 1);
+    GLint writeFirst = firstRow == 0 ? -1 : firstRow;
+    GLint writeLast = lastRow == g_gridSide ? g_gridSide + 1 : lastRow;
+    size_t rowCount = (size_t)(copyLast - copyFirst) * g_gridStride;
+    GLfloat *buffers[2];
+    GLfloat *v = NULL;
+    GLint done = 0;
+    GLint steps = 0;
+
+    buffers[0] = reserveWorkerScratch(worker, 3 * rowCount);
+    buffers[1] = buffers[0] + rowCount;
+    v = buffers[1] + rowCount;
+
+    for (done = 0; done < job->steps; done += steps)
+    {
+        steps = MIN(job->steps - done, job->timeBlock);
+
+        memcpy(buffers[0], heights + (copyFirst + 1) * g_gridStride, rowCount * sizeof(GLfloat));
+        if (g_awakeTiles < SQUARE(g_tilesSide))
+        {
+            //ruhende Kacheln werden nicht berechnet und muessen in beiden Puffern stehen
+            memcpy(buffers[1], buffers[0], rowCount * sizeof(GLfloat));
+        }
+        memcpy(v, velocities + (copyFirst + 1) * g_gridStride, rowCount * sizeof(GLfloat));
+        //erst zurueckschreiben, wenn alle Worker ihren Ausgangszustand kopiert haben
+        waitAtBarrier();
+
+        simulateWavefront(buffers, v, copyFirst, firstRow, lastRow, steps, job->force, job->dt);
+
+        memcpy(heights + (writeFirst + 1) * g_gridStride, buffers[steps % 2] + (writeFirst - copyFirst) * g_gridStride,
+               (size_t)(writeLast - writeFirst) * g_gridStride * sizeof(GLfloat));
+        memcpy(velocities + (writeFirst + 1) * g_gridStride, v + (writeFirst - copyFirst) * g_gridStride,
+               (size_t)(writeLast - writeFirst) * g_gridStride * sizeof(GLfloat));
+        //erst weiterkopieren, wenn alle Worker ihren Streifen zurueckgeschrieben haben
+        waitAtBarrier();
+    }
+}
+
+/**
+ * Berechnet einen Streifen von Zeilen auf den Feldern in halber Genauigkeit.
+ * Der Streifen wird in Teilstreifen zerlegt, die samt Halo in den privaten
+ * Zwischenspeicher entpackt werden und dort im Cache bleiben. Gerechnet wird
+ * wie bei simulateStripBlocked mit GLfloat als Wellenfront ueber timeBlock
+ * Schritte, gerundet wird nur beim Zurueckschreiben. Da jeder Block aus dem
+ * aktuellen Puffer liest und in den anderen schreibt, genuegt eine Barriere
+ * pro Block und die Teilstreifen brauchen keine Synchronisation.
+ * @param worker Nummer des Workers
+ * @param workerCount Anzahl der beteiligten Worker
+ * @param arg Parameter des Auftrags (SimulationJob)
+ */
+static void simulateStripPacked(GLint worker, GLint workerCount, void *arg)
+{
+    const SimulationJob *job = arg;
+    GLint firstRow = g_gridSide * worker / workerCount;
+    GLint lastRow = g_gridSide * (worker + 1) / workerCount;
+    GLint stripRows = MAX(PACKED_STRIP_CACHE_BYTES / (3 * g_gridStride * (GLint)sizeof(GLfloat)) - 2 * job->timeBlock,
+                          MIN_ROWS_PER_STRIP);
+    size_t rowCount = (size_t)(stripRows + 2 * job->timeBlock + 2) * g_gridStride;
+    size_t count = 0;
+    GLfloat *buffers[2];
+    GLfloat *v = NULL;
+    GLint current = g_packedCurrent;
+    GLint first, last, copyFirst, writeFirst, writeLast;
+    GLint done = 0;
+    GLint steps = 0;
+
+    buffers[0] = reserveWorkerScratch(worker, 3 * rowCount);
+    buffers[1] = buffers[0] + rowCount;
+    v = buffers[1] + rowCount;
+
+    for (done = 0; done < job->steps; done += steps)
+    {
+        steps = MIN(job->steps - done, job->timeBlock);
+
+        for (first = firstRow; first < lastRow; first = last)
+        {
+            last = MIN(first + stripRows, lastRow);
+            //Kopierbereich inkl. Halo, an den Kanten inkl. der Geisterzeile
+            copyFirst = MAX(first - steps, -1);
+            count = (size_t)(MIN(last + steps, g_gridSide + 1) - copyFirst) * g_gridStride;
+            unpackValues(g_packedHeights[current] + (copyFirst + 1) * g_gridStride, buffers[0], count);
+            if (g_awakeTiles < SQUARE(g_tilesSide))
+            {
+                //ruhende Kacheln werden nicht berechnet und muessen in beiden Puffern stehen
+                memcpy(buffers[1], buffers[0], count * sizeof(GLfloat));
+            }
+            unpackValues(g_packedVelocities[current] + (copyFirst + 1) * g_gridStride, v, count);
+
+            simulateWavefront(buffers, v, copyFirst, first, last, steps, job->force, job->dt);
+
+            writeFirst = first == 0 ? -1 : first;
+            writeLast = last == g_gridSide ? g_gridSide + 1 : last;
+            count = (size_t)(writeLast - writeFirst) * g_gridStride;
+            packValues(buffers[steps % 2] + (writeFirst - copyFirst) * g_gridStride,
+                       g_packedHeights[1 - current] + (writeFirst + 1) * g_gridStride, count);
+            packValues(v + (writeFirst - copyFirst) * g_gridStride,
+                       g_packedVelocities[1 - current] + (writeFirst + 1) * g_gridStride, count);
+        }
+
+        //der naechste Block liest, was alle Worker in den anderen Puffer geschrieben haben
+        if ((workerCount > 1) && (done + steps < job->steps))
+        {
+            waitAtBarrier();
+        }
+        current = 1 - current;
+    }
+}
+
+/**
+ * Bestimmt, wie viele Schritte am Stueck berechnet werden, sodass die Zeilen
+ * einer Wellenfront im Cache Platz finden
+ * @param stripRows Anzahl der Zeilen pro Streifen
+ * @param workerCount Anzahl der beteiligten Worker
+ * @return Anzahl der Schritte pro Block (mindestens 1)
+ */
+static GLint calcTimeBlock(GLint stripRows, GLint workerCount)
+{
+    //pro Schritt der Front liegen die Zeilen zweier Hoehenpuffer und der Geschwindigkeiten im Cache
+    GLint timeBlock = TIME_BLOCK_CACHE_BYTES / (3 * g_gridStride * (GLint)sizeof(GLfloat)) - 2;
+
+    if (timeBlock > MAX_TIME_BLOCK)
+    {
+        timeBlock = MAX_TIME_BLOCK;
+    }
+    //bei mehreren Workern wird der Halo redundant gerechnet, er soll den Streifen nicht dominieren
+    if ((workerCount > 1) && (timeBlock > stripRows / 2))
+    {
+        timeBlock = stripRows / 2;
+    }
+    return timeBlock < 1 ? 1 : timeBlock;
+}
+
+/**
+ * Berechnet mehrere Simulationsschritte mit unveraenderten wachen Kacheln
+ * @param steps Anzahl der Simulationsschritte
+ * @param stepInterval Zeitintervall eines Schrittes in Sekunden
+ */
+static void simulateWaterChunk(GLint steps, double stepInterval)
+{
+    SimulationJob job;
+    GLfloat *buffers[2];
+    GLint workerCount = g_gridSide / MIN_ROWS_PER_STRIP;
+    GLint done = 0;
+    GLint blockSteps = 0;
+
+    if (steps > 0)
+    {
+        if (workerCount > getWorkerCount())
+        {
+            workerCount = getWorkerCount();
+        }
+        if (workerCount < 1)
+        {
+            workerCount = 1;
+        }
+
+        job.steps = steps;
+        job.dt = (GLfloat)stepInterval;
+        //Kraft haengt von den Hoehen, der Wellengeschwindigkeit und dem Abstand der Saeulen ab
+        job.force = SQUARE(WAVE_SPEED) / SQUARE(WAVE_WIDTH(g_gridSide));
+        job.timeBlock = calcTimeBlock(g_gridSide / workerCount, workerCount);
+
+        //die Felder in der Form bereitstellen, in der gerechnet wird
+        if (g_halfStorage)
+        {
+            syncPackedFields();
+            g_floatFieldsFresh = GL_FALSE;
+        }
+        else
+        {
+            syncFloatFields();
+            g_packedFieldsFresh = GL_FALSE;
+        }
+
+        if (g_halfStorage)
+        {
+            //die Wellenfront laeuft im entpackten Teilstreifen, die volle Zeitblockung
+            //spart dort Umwandlungen, ohne den Cache zu verlassen
+            job.timeBlock = MAX_TIME_BLOCK;
+            runOnWorkers(simulateStripPacked, &job, workerCount);
+            //jeder Block hat in den jeweils anderen Puffer geschrieben
+            g_packedCurrent = (g_packedCurrent + (steps + job.timeBlock - 1) / job.timeBlock) % 2;
+        }
+        else if (workerCount == 1)
+        {
+            //ein Streifen: Wellenfront direkt auf den beiden Hoehenpuffern
+            for (done = 0; done < steps; done += blockSteps)
+            {
+                blockSteps = MIN(steps - done, job.timeBlock);
+                buffers[0] = heights;
+                buffers[1] = nextHeights;
+                simulateWavefront(buffers, velocities, -1, 0, g_gridSide, blockSteps, job.force, job.dt);
+                heights = buffers[blockSteps % 2];
+                nextHeights = buffers[(blockSteps + 1) % 2];
+            }
+        }
+        else if ((job.timeBlock > 1) && (steps > 1))
+        {
+            //mehrere Streifen mit zeitlicher Blockung, Ergebnis liegt wieder in heights
+            runOnWorkers(simulateStripBlocked, &job, workerCount);
+        }
+        else
+        {
+            runOnWorkers(simulateStrip, &job, workerCount);
+
+            //Uebernehmen der neuen Hoehenwerte: nach ungerader Schrittzahl liegen sie im Zwischenspeicher
+            if (steps % 2 == 1)
+            {
+                buffers[0] = heights;
+                heights = nextHeights;
+                nextHeights = buffers[0];
+            }
+        }
+    }
+}
+
+/**
+ * Liefert, ob gerade verfeinert wird: nur das explizite Verfahren auf
+ * GLfloat-Feldern rechnet mit Patches, die anderen Verfahren rechnen
+ * einheitlich auf dem groben Gitter
+ * @return GL_TRUE, wenn Patches angelegt und berechnet werden
+ */
+static GLboolean useRefinement(void)
+{
+    return g_refinement && (g_waterSolver == explicitSolver) && !g_halfStorage;
+}
+
+/**
+ * Verfeinert eine Kachel. Jede grobe Saeule wird auf ihre vier feinen Zellen
+ * verteilt: die Hoehen linear mit der Steigung zu den Nachbarsaeulen, die
+ * Geschwindigkeiten konstant. Der Mittelwert der vier Zellen ist in beiden
+ * Faellen der Wert der Saeule, die Verteilung erhaelt also Volumen und Impuls.
+ * @param tx Spalte der Kachel
+ * @param ty Zeile der Kachel
+ */
+static void refineTile(GLint tx, GLint ty)
+{
+    Patch *patch = malloc(sizeof(Patch));
+    GLint x0 = tx * TILE_SIZE;
+    GLint y0 = ty * TILE_SIZE;
+    GLint x, y, i, j;
+    GLfloat slopeX, slopeY;
+
+    if (patch == NULL)
+    {
+        exit(1);
+    }
+    patch->memory = calloc(3 * PATCH_CELLS, sizeof(GLfloat));
+    if (patch->memory == NULL)
+    {
+        exit(1);
+    }
+    patch->heights = patch->memory;
+    patch->nextHeights = patch->memory + PATCH_CELLS;
+    patch->velocities = patch->memory + 2 * PATCH_CELLS;
+    patch->tileX = tx;
+    patch->tileY = ty;
+    patch->cellsX = 2 * MIN(TILE_SIZE, g_gridSide - x0);
+    patch->cellsY = 2 * MIN(TILE_SIZE, g_gridSide - y0);
+
+    for (y = 0; y < patch->cellsY / 2; y++)
+    {
+        for (x = 0; x < patch->cellsX / 2; x++)
+        {
+            i = gridIndex(x0 + x, y0 + y);
+            j = (2 * y + 1) * PATCH_STRIDE + 2 * x + 1;
+            //Mittelpunkte der feinen Zellen liegen eine Viertelsaeule neben dem der groben
+            slopeX = 0.125f * (heights[i + 1] - heights[i - 1]);
+            slopeY = 0.125f * (heights[i + g_gridStride] - heights[i - g_gridStride]);
+            patch->heights[j] = heights[i] - slopeX - slopeY;
+            patch->heights[j + 1] = heights[i] + slopeX - slopeY;
+            patch->heights[j + PATCH_STRIDE] = heights[i] - slopeX + slopeY;
+            patch->heights[j + PATCH_STRIDE + 1] = heights[i] + slopeX + slopeY;
+            patch->velocities[j] = velocities[i];
+            patch->velocities[j + 1] = velocities[i];
+            patch->velocities[j + PATCH_STRIDE] = velocities[i];
+            patch->velocities[j + PATCH_STRIDE + 1] = velocities[i];
+        }
+    }
+
+    g_tilePatch[ty * g_tilesSide + tx] = patch;
+    g_patches[g_patchCount++] = patch;
+    g_patchLayout++;
+}
+
+/**
+ * Vergroebert eine Kachel: der Patch wird freigegeben, die groben Saeulen
+ * enthalten bereits die Mittelwerte der feinen Zellen
+ * @param index Index des Patches in g_patches
+ */
+static void coarsenTile(GLint index)
+{
+    Patch *patch = g_patches[index];
+
+    g_tilePatch[patch->tileY * g_tilesSide + patch->tileX] = NULL;
+    g_patches[index] = g_patches[--g_patchCount];
+    free(patch->memory);
+    free(patch);
+    g_patchLayout++;
+}
+
+/**
+ * Setzt Hoehen und Geschwindigkeiten der groben Saeulen unter einem Patch auf
+ * die Mittelwerte ihrer vier feinen Zellen (Restriktion)
+ * @param patch Patch
+ */
+static void restrictPatch(const Patch *patch)
+{
+    GLint x, y, i, j;
+
+    for (y = 0; y < patch->cellsY / 2; y++)
+    {
+        for (x = 0; x < patch->cellsX / 2; x++)
+        {
+            i = gridIndex(patch->tileX * TILE_SIZE + x, patch->tileY * TILE_SIZE + y);
+            j = (2 * y + 1) * PATCH_STRIDE + 2 * x + 1;
+            heights[i] = 0.25f * ((patch->heights[j] + patch->heights[j + 1]) +
+                                  (patch->heights[j + PATCH_STRIDE] + patch->heights[j + PATCH_STRIDE + 1]));
+            velocities[i] = 0.25f * ((patch->velocities[j] + patch->velocities[j + 1]) +
+                                     (patch->velocities[j + PATCH_STRIDE] + patch->velocities[j + PATCH_STRIDE + 1]));
+        }
+    }
+}
+
+/**
+ * Liefert die Hoehe einer feinen Zelle ausserhalb eines Patches fuer dessen
+ * Geisterrand. Liegt sie in einem anderen Patch, wird dessen Wert verwendet,
+ * sonst wird im groben Gitter linear interpoliert: raeumlich mit der Steigung
+ * zu den Nachbarsaeulen (der Mittelwert der vier Zellen einer Saeule ist deren
+ * Wert), zeitlich zwischen dem Stand vor (nextHeights) und nach (heights) dem
+ * groben Schritt.
+ * @param gx Spalte der feinen Zelle im ganzen Gitter (0 bis 2 * g_gridSide - 1)
+ * @param gy Zeile der feinen Zelle im ganzen Gitter
+ * @param theta Anteil des groben Schrittes, der bereits berechnet ist (0 oder 0.5)
+ * @return Hoehe der feinen Zelle
+ */
+static GLfloat sampleFineHeight(GLint gx, GLint gy, GLfloat theta)
+{
+    const Patch *patch = g_tilePatch[(gy / 2 / TILE_SIZE) * g_tilesSide + gx / 2 / TILE_SIZE];
+    GLint i = gridIndex(gx / 2, gy / 2);
+    GLfloat offsetX = (gx % 2) ? 0.125f : -0.125f;
+    GLfloat offsetY = (gy % 2) ? 0.125f : -0.125f;
+    GLfloat before, after;
+
+    if (patch != NULL)
+    {
+        return patch->heights[(gy - 2 * patch->tileY * TILE_SIZE + 1) * PATCH_STRIDE +
+                              gx - 2 * patch->tileX * TILE_SIZE + 1];
+    }
+    before = nextHeights[i] + offsetX * (nextHeights[i + 1] - nextHeights[i - 1]) +
+             offsetY * (nextHeights[i + g_gridStride] - nextHeights[i - g_gridStride]);
+    after = heights[i] + offsetX * (heights[i + 1] - heights[i - 1]) +
+            offsetY * (heights[i + g_gridStride] - heights[i - g_gridStride]);
+    return (1.0f - theta) * before + theta * after;
+}
+
+/**
+ * Befuellt den Geisterrand eines Patches. Am Rand des Gitters traegt er wie
+ * beim groben Gitter die Hoehe der benachbarten Zelle, sonst die Hoehe der
+ * feinen Zelle dahinter (sampleFineHeight).
+ * @param patch Patch
+ * @param theta Anteil des groben Schrittes, der bereits berechnet ist
+ */
+static void fillPatchGhosts(Patch *patch, GLfloat theta)
+{
+    GLfloat *h = patch->heights;
+    GLint gx = 2 * patch->tileX * TILE_SIZE;
+    GLint gy = 2 * patch->tileY * TILE_SIZE;
+    GLint i = 0;
+
+    for (i = 0; i < patch->cellsY; i++)
+    {
+        h[(i + 1) * PATCH_STRIDE] = gx == 0 ? h[(i + 1) * PATCH_STRIDE + 1] : sampleFineHeight(gx - 1, gy + i, theta);
+        h[(i + 1) * PATCH_STRIDE + patch->cellsX + 1] = gx + patch->cellsX == 2 * g_gridSide
+                                                            ? h[(i + 1) * PATCH_STRIDE + patch->cellsX]
+                                                            : sampleFineHeight(gx + patch->cellsX, gy + i, theta);
+    }
+    for (i = 0; i < patch->cellsX; i++)
+    {
+        h[i + 1] = gy == 0 ? h[PATCH_STRIDE + i + 1] : sampleFineHeight(gx + i, gy - 1, theta);
+        h[(patch->cellsY + 1) * PATCH_STRIDE + i + 1] = gy + patch->cellsY == 2 * g_gridSide
+                                                            ? h[patch->cellsY * PATCH_STRIDE + i + 1]
+                                                            : sampleFineHeight(gx + i, gy + patch->cellsY, theta);
+    }
+}
+
+/**
+ * Berechnet einen feinen Schritt eines Patches. Vorher werden die Fluesse
+ * ueber die Seiten (Hoehe hinter der Seite minus Hoehe davor) je grober Saeule
+ * in die Flussregister addiert, gewichtet mit ihrem Beitrag zu Geschwindigkeit
+ * und Hoehe am Ende des groben Schrittes.
+ * @param patch Patch
+ * @param job Parameter der feinen Schritte (Kraft und Zeitintervall)
+ * @param attenuation Daempfung pro feinem Schritt
+ * @param weightVelocity Gewicht der Fluesse fuer die Geschwindigkeit
+ * @param weightHeight Gewicht der Fluesse fuer die Hoehe
+ */
+static void stepPatch(Patch *patch, const SimulationJob *job, GLfloat attenuation, GLfloat weightVelocity,
+                      GLfloat weightHeight)
+{
+    const GLfloat *h = patch->heights;
+    GLfloat *swap = NULL;
+    GLfloat flux = 0.0f;
+    GLint i, j;
+
+    for (i = 0; i < patch->cellsY; i++)
+    {
+        j = (i + 1) * PATCH_STRIDE + 1;
+        flux = h[j - 1] - h[j];
+        patch->fluxVelocity[SIDE_WEST][i / 2] += weightVelocity * flux;
+        patch->fluxHeight[SIDE_WEST][i / 2] += weightHeight * flux;
+        j += patch->cellsX - 1;
+        flux = h[j + 1] - h[j];
+        patch->fluxVelocity[SIDE_EAST][i / 2] += weightVelocity * flux;
+        patch->fluxHeight[SIDE_EAST][i / 2] += weightHeight * flux;
+    }
+    for (i = 0; i < patch->cellsX; i++)
+    {
+        j = PATCH_STRIDE + 1 + i;
+        flux = h[j - PATCH_STRIDE] - h[j];
+        patch->fluxVelocity[SIDE_NORTH][i / 2] += weightVelocity * flux;
+        patch->fluxHeight[SIDE_NORTH][i / 2] += weightHeight * flux;
+        j += (patch->cellsY - 1) * PATCH_STRIDE;
+        flux = h[j + PATCH_STRIDE] - h[j];
+        patch->fluxVelocity[SIDE_SOUTH][i / 2] += weightVelocity * flux;
+        patch->fluxHeight[SIDE_SOUTH][i / 2] += weightHeight * flux;
+    }
+
+    for (i = 0; i < patch->cellsY; i++)
+    {
+        j = (i + 1) * PATCH_STRIDE + 1;
+        simulateRow(patch->heights + j, patch->nextHeights + j, patch->velocities + j, patch->cellsX, PATCH_STRIDE,
+                    job->force, job->dt, attenuation);
+    }
+    swap = patch->heights;
+    patch->heights = patch->nextHeights;
+    patch->nextHeights = swap;
+}
+
+/**
+ * Berechnet die feinen Schritte eines groben Schrittes fuer die Patches eines
+ * Workers. Alle Patches befuellen zuerst ihren Geisterrand (sie lesen dabei
+ * nur das Innere der Nachbarpatches), erst nach einer Barriere wird gerechnet.
+ * Die Gewichte der Flussregister ergeben sich aus der Daempfung a pro feinem
+ * Schritt: ein Fluss im ersten Schritt geht mit a^2 dt in die Geschwindigkeit
+ * und mit (a + a^2) dt^2 in die Hoehe am Ende des groben Schrittes ein, ein
+ * Fluss im zweiten Schritt mit a dt bzw. a dt^2.
+ * @param worker Nummer des Workers
+ * @param workerCount Anzahl der beteiligten Worker
+ * @param arg Parameter der feinen Schritte (SimulationJob)
+ */
+static void simulatePatches(GLint worker, GLint workerCount, void *arg)
+{
+    const SimulationJob *job = arg;
+    GLfloat attenuation = sqrtf(ATTENUATION);
+    GLfloat weightVelocity, weightHeight;
+    GLint step = 0;
+    GLint p = 0;
+
+    for (p = worker; p < g_patchCount; p += workerCount)
+    {
+        memset(g_patches[p]->fluxVelocity, 0, sizeof(g_patches[p]->fluxVelocity));
+        memset(g_patches[p]->fluxHeight, 0, sizeof(g_patches[p]->fluxHeight));
+    }
+
+    for (step = 0; step < job->steps; step++)
+    {
+        for (p = worker; p < g_patchCount; p += workerCount)
+        {
+            fillPatchGhosts(g_patches[p], (GLfloat)step / job->steps);
+        }
+        if (workerCount > 1)
+        {
+            waitAtBarrier();
+        }
+
+        weightVelocity = job->dt * (step == 0 ? SQUARE(attenuation) : attenuation);
+        weightHeight = SQUARE(job->dt) * (step == 0 ? attenuation + SQUARE(attenuation) : attenuation);
+        for (p = worker; p < g_patchCount; p += workerCount)
+        {
+            stepPatch(g_patches[p], job, attenuation, weightVelocity, weightHeight);
+        }
+        //der naechste Geisterrand liest die neuen Hoehen aller Patches
+        if ((workerCount > 1) && (step < job->steps - 1))
+        {
+            waitAtBarrier();
+        }
+    }
+}
+
+/**
+ * Gleicht die Fluesse zwischen einem Patch und den unverfeinerten Saeulen an
+ * seinen Seiten ab (Refluxing): der grobe Schritt hat die Saeule neben dem
+ * Patch mit dem Fluss zur groben Saeule unter dem Patch berechnet, der Patch
+ * mit den feinen Fluessen seiner Register. Die grobe Saeule erhaelt statt des
+ * groben Flusses das Negative der feinen Fluesse, so dass Volumen und Impuls
+ * ueber die Grenze der Stufen genau erhalten bleiben.
+ * @param patch Patch
+ * @param force Faktor der Kraft im groben Gitter
+ * @param dt Zeitintervall des groben Schrittes
+ */
+static void refluxPatch(const Patch *patch, GLfloat force, GLfloat dt)
+{
+    //Versatz von der Saeule unter dem Patch zur Saeule daneben und Schrittweite entlang der Seite
+    const GLint outward[4] = {-1, 1, -g_gridStride, g_gridStride};
+    const GLint along[4] = {g_gridStride, g_gridStride, 1, 1};
+    const GLint neighbourX[4] = {-1, 1, 0, 0};
+    const GLint neighbourY[4] = {0, 0, -1, 1};
+    GLint x0 = patch->tileX * TILE_SIZE;
+    GLint y0 = patch->tileY * TILE_SIZE;
+    GLint first[4];
+    GLint count[4];
+    GLint side, k, i, tx, ty;
+    GLfloat coarseFlux = 0.0f;
+
+    first[SIDE_WEST] = gridIndex(x0, y0);
+    first[SIDE_EAST] = gridIndex(x0 + patch->cellsX / 2 - 1, y0);
+    first[SIDE_NORTH] = gridIndex(x0, y0);
+    first[SIDE_SOUTH] = gridIndex(x0, y0 + patch->cellsY / 2 - 1);
+    count[SIDE_WEST] = count[SIDE_EAST] = patch->cellsY / 2;
+    count[SIDE_NORTH] = count[SIDE_SOUTH] = patch->cellsX / 2;
+
+    for (side = 0; side < 4; side++)
+    {
+        tx = patch->tileX + neighbourX[side];
+        ty = patch->tileY + neighbourY[side];
+        //am Rand des Gitters gibt es keinen Fluss, zwischen Patches ist er bereits fein
+        if ((tx >= 0) && (tx < g_tilesSide) && (ty >= 0) && (ty < g_tilesSide) &&
+            (g_tilePatch[ty * g_tilesSide + tx] == NULL))
+        {
+            for (k = 0; k < count[side]; k++)
+            {
+                i = first[side] + k * along[side];
+                //Fluss des groben Schrittes in die Saeule daneben (nextHeights ist der Stand davor)
+                coarseFlux = nextHeights[i] - nextHeights[i + outward[side]];
+                velocities[i + outward[side]] -= force * (patch->fluxVelocity[side][k] + ATTENUATION * dt * coarseFlux);
+                heights[i + outward[side]] -=
+                    force * (patch->fluxHeight[side][k] + ATTENUATION * SQUARE(dt) * coarseFlux);
+            }
+        }
+    }
+}
+
+/**
+ * Berechnet einen Schritt mit Patches: erst das grobe Gitter, dann jeder
+ * Patch mit zwei feinen Schritten (halber Saeulenabstand, halbes
+ * Zeitintervall, Daempfung sqrt(ATTENUATION)), danach werden die Fluesse an
+ * den Grenzen abgeglichen und die groben Saeulen unter den Patches auf die
+ * Mittelwerte der feinen Zellen gesetzt.
+ * @param stepInterval Zeitintervall des groben Schrittes in Sekunden
+ */
+static void simulateRefinedStep(double stepInterval)
+{
+    SimulationJob job;
+    GLfloat force = SQUARE(WAVE_SPEED) / SQUARE(WAVE_WIDTH(g_gridSide));
+    GLint p = 0;
+
+    //danach liegt in heights der neue, in nextHeights der vorherige Stand
+    simulateWaterChunk(1, stepInterval);
 
-/** Status der ersten Lichtquelle (an/aus) */
-static GLboolean g_light0State = 1;
+    job.steps = 2;
+    job.timeBlock = 1;
+    job.dt = 0.5f * (GLfloat)stepInterval;
+    job.force = 4.0f * force;
+    runOnWorkers(simulatePatches, &job, MIN(g_patchCount, getWorkerCount()));
 
-/** Status der zweiten Lichtquelle (rotierend/aus/boot1/boot2) */
-static light1State g_light1State = 0;
+    for (p = 0; p < g_patchCount; p++)
+    {
+        refluxPatch(g_patches[p], force, (GLfloat)stepInterval);
+        restrictPatch(g_patches[p]);
+    }
+    refreshGhostBorder(heights);
+}
 
-/** Rotationswinkel der zweiten Lichtquelle. */
-static float g_light1RotationAngle = 0.0f;
+/**
+ * Vergleicht zwei Kacheln nach ihrer Kruemmung (absteigend) fuer qsort
+ * @param a Zeiger auf den Index der ersten Kachel
+ * @param b Zeiger auf den Index der zweiten Kachel
+ * @return negativ, wenn die erste Kachel staerker gekruemmt ist
+ */
+static int compareTileCurvature(const void *a, const void *b)
+{
+    GLfloat curvatureA = g_tileCurvature[*(const GLint *)a];
+    GLfloat curvatureB = g_tileCurvature[*(const GLint *)b];
 
-/** Hoehen der Wassersaeulen in einem dynamisch alloziierten Array*/
-static GLfloat *heights;
+    return (curvatureA < curvatureB) - (curvatureA > curvatureB);
+}
 
-/** Hoehen der Wassersaeulen in einem dynamisch alloziierten Array*/
-static GLfloat *velocities;
+/**
+ * Bestimmt die groesste Kruemmung (Betrag von Nachbarsumme minus vierfacher
+ * Hoehe) einer Kachel im groben Gitter, unter Patches aus den Mittelwerten
+ * @param tx Spalte der Kachel
+ * @param ty Zeile der Kachel
+ * @return groesste Kruemmung
+ */
+static GLfloat measureTileCurvature(GLint tx, GLint ty)
+{
+    GLfloat curvature = 0.0f;
+    GLint x, y, i;
 
-void freeAllocatedMemLogic(void)
+    for (y = ty * TILE_SIZE; y < MIN((ty + 1) * TILE_SIZE, g_gridSide); y++)
+    {
+        for (x = tx * TILE_SIZE; x < MIN((tx + 1) * TILE_SIZE, g_gridSide); x++)
+        {
+            i = gridIndex(x, y);
+            curvature = fmaxf(curvature, fabsf(((heights[i - 1] + heights[i + 1]) +
+                                                (heights[i - g_gridStride] + heights[i + g_gridStride])) -
+                                               4.0f * heights[i]));
+        }
+    }
+    return curvature;
+}
+
+/**
+ * Passt die Patches an den aktuellen Zustand an: aktive Kacheln mit starker
+ * Kruemmung werden verfeinert, Patches, deren Kruemmung unter die Haelfte der
+ * Schwelle faellt, vergroebert. Uebersteigen die Kandidaten das Budget, werden
+ * die am staerksten gekruemmten verfeinert.
+ */
+static void regridPatches(void)
 {
-    free(heights);
-    free(velocities);
+    GLint count = 0;
+    GLint i = 0;
+    GLboolean refined = GL_FALSE;
+
+    for (i = 0; i < SQUARE(g_tilesSide); i++)
+    {
+        g_tileCurvature[i] = g_tileActive[i] ? measureTileCurvature(i % g_tilesSide, i / g_tilesSide) : 0.0f;
+        refined = g_tilePatch[i] != NULL;
+        if (g_tileCurvature[i] > (refined ? 0.5f * REFINE_CURVATURE : REFINE_CURVATURE))
+        {
+            g_refineCandidates[count++] = i;
+        }
+    }
+    if (count > g_patchCapacity)
+    {
+        qsort(g_refineCandidates, count, sizeof(GLint), compareTileCurvature);
+        count = g_patchCapacity;
+    }
+
+    //g_tileCurvature markiert ab hier nur noch die ausgewaehlten Kacheln
+    for (i = 0; i < SQUARE(g_tilesSide); i++)
+    {
+        g_tileCurvature[i] = 0.0f;
+    }
+    for (i = 0; i < count; i++)
+    {
+        g_tileCurvature[g_refineCandidates[i]] = 1.0f;
+    }
+    for (i = g_patchCount - 1; i >= 0; i--)
+    {
+        if (g_tileCurvature[g_patches[i]->tileY * g_tilesSide + g_patches[i]->tileX] == 0.0f)
+        {
+            coarsenTile(i);
+        }
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (g_tilePatch[g_refineCandidates[i]] == NULL)
+        {
+            refineTile(g_refineCandidates[i] % g_tilesSide, g_refineCandidates[i] / g_tilesSide);
+        }
+    }
 }
 
-void initLogic(void)
+/**
+ * Berechnet die Thomas-Elimination fuer das tridiagonale System
+ * (I - a D) x = d vor, wobei D die zweite Differenz entlang einer Zeile bzw.
+ * Spalte ist. Die Matrix hat 1 + 2a auf der Diagonalen und -a auf den
+ * Nebendiagonalen, in der ersten und letzten Zeile 1 + a (Neumann-Rand wie
+ * beim Geisterrand). Die Matrix ist fuer Zeilen und Spalten dieselbe.
+ * @param coupling Kopplung a = (Wellengeschwindigkeit * dt / Abstand)^2
+ */
+static void prepareImplicit(GLfloat coupling)
 {
-    GLint amountVerticesSide = START_AMOUNT_VERTICES;
-    heights = calloc(SQUARE(amountVerticesSide), sizeof(GLfloat));
-    if (heights != NULL)
+    GLint i = 0;
+    GLfloat diagonal = 0.0f;
+
+    if ((g_adiSide != g_gridSide) || (g_adiCoupling != coupling))
     {
-        velocities = calloc(SQUARE(amountVerticesSide), sizeof(GLfloat));
-        if (velocities == NULL)
+        free(g_adiUpper);
+        free(g_adiInvPivot);
+        g_adiUpper = malloc(g_gridSide * sizeof(GLfloat));
+        g_adiInvPivot = malloc(g_gridSide * sizeof(GLfloat));
+        if ((g_adiUpper == NULL) || (g_adiInvPivot == NULL))
         {
-            free(heights);
             exit(1);
         }
+
+        g_adiInvPivot[0] = 1.0f / (1.0f + coupling);
+        g_adiUpper[0] = -coupling * g_adiInvPivot[0];
+        for (i = 1; i < g_gridSide; i++)
+        {
+            diagonal = (i == g_gridSide - 1) ? 1.0f + coupling : 1.0f + 2.0f * coupling;
+            g_adiInvPivot[i] = 1.0f / (diagonal + coupling * g_adiUpper[i - 1]);
+            g_adiUpper[i] = -coupling * g_adiInvPivot[i];
+        }
+
+        g_adiSide = g_gridSide;
+        g_adiCoupling = coupling;
     }
-    else
+}
+
+/**
+ * Erster Halbschritt des impliziten Verfahrens fuer eine Zeile: loest
+ * (I - a Dx) hNext = h + dt v entlang der Zeile
+ * @param h Zeiger auf die erste Wassersaeule der Zeile in den aktuellen Hoehen
+ * @param hNext Zeiger auf die erste Wassersaeule der Zeile im Ergebnis (Out)
+ * @param v Zeiger auf die erste Wassersaeule der Zeile in den Geschwindigkeiten
+ * @param coupling Kopplung a
+ * @param dt Zeitintervall eines Schrittes in Sekunden
+ */
+static void solveRowImplicit(const GLfloat *h, GLfloat *hNext, const GLfloat *v, GLfloat coupling, GLfloat dt)
+{
+    GLint x = 0;
+
+    //Vorwaertselimination, die rechte Seite entsteht dabei
+    hNext[0] = (h[0] + dt * v[0]) * g_adiInvPivot[0];
+    for (x = 1; x < g_gridSide; x++)
     {
-        exit(1);
+        hNext[x] = (h[x] + dt * v[x] + coupling * hNext[x - 1]) * g_adiInvPivot[x];
+    }
+    //Rueckwaertseinsetzen
+    for (x = g_gridSide - 2; x >= 0; x--)
+    {
+        hNext[x] -= g_adiUpper[x] * hNext[x + 1];
     }
 }
 
-
-void updateLogic(expandShrinkVertices state)
+/**
+ * Zweiter Halbschritt des impliziten Verfahrens fuer die Spalten first bis
+ * last - 1: loest (I - a Dy) hNext = hNext entlang der Spalten und bestimmt
+ * daraus die neuen Geschwindigkeiten. Die Elimination laeuft zeilenweise,
+ * sodass benachbarte Spalten mit SIMD gemeinsam berechnet werden.
+ * @param h aktuelle Hoehen
+ * @param hNext Ergebnis des ersten Halbschritts, danach die neuen Hoehen (In/Out)
+ * @param first erste Spalte
+ * @param last Spalte hinter der letzten Spalte
+ * @param coupling Kopplung a
+ * @param dt Zeitintervall eines Schrittes in Sekunden
+ */
+static void solveColumnsImplicit(const GLfloat *h, GLfloat *hNext, GLint first, GLint last,
+                                 GLfloat coupling, GLfloat dt)
 {
+    GLint x = 0;
+    GLint y = 0;
     GLint i = 0;
-    GLint rowCount = -1;
-    GLint oldAmountVerticesSide = getAmountVertices();
-    GLint newAmountVerticesSide = oldAmountVerticesSide + state;
+    GLint stride = g_gridStride;
+    GLfloat velocityScale = ATTENUATION / dt;
 
-    //alte Hoehen speichern um diese beim Vergroeßern oder Verkleinern nicht zu verlieren
-    GLfloat *oldHeights = calloc(SQUARE(oldAmountVerticesSide), sizeof(GLfloat));
-    if (oldHeights == NULL)
+    //Vorwaertselimination, die erste Zeile wird nur skaliert
+    for (y = 0; y < g_gridSide; y++)
     {
-        exit(1);
+        i = gridIndex(0, y);
+        x = first;
+#if SIMD_WIDTH > 1
+        {
+            const SIMD_FLOAT vecCoupling = SIMD_SET1(y > 0 ? coupling : 0.0f);
+            const SIMD_FLOAT vecInvPivot = SIMD_SET1(g_adiInvPivot[y]);
+            for (; x + SIMD_WIDTH <= last; x += SIMD_WIDTH)
+            {
+                SIMD_STORE(hNext + i + x, SIMD_MUL(SIMD_ADD(SIMD_LOAD(hNext + i + x),
+                                                            SIMD_MUL(vecCoupling, SIMD_LOAD(hNext + i + x - stride))),
+                                                   vecInvPivot));
+            }
+        }
+#endif
+        for (; x < last; x++)
+        {
+            hNext[i + x] = (hNext[i + x] + (y > 0 ? coupling * hNext[i + x - stride] : 0.0f)) * g_adiInvPivot[y];
+        }
     }
 
-    //alte Hoehen speichernm um diese beim Vergroeßern oder Verkleinern nicht zu verlieren
-    GLfloat *oldVelocities = calloc(SQUARE(oldAmountVerticesSide), sizeof(GLfloat));
-    if (oldVelocities == NULL)
+    //Rueckwaertseinsetzen, v = (hNeu - h) / dt mit Daempfung wie beim expliziten Verfahren
+    for (y = g_gridSide - 1; y >= 0; y--)
     {
-        exit(1);
+        i = gridIndex(0, y);
+        x = first;
+#if SIMD_WIDTH > 1
+        {
+            const SIMD_FLOAT vecUpper = SIMD_SET1(y < g_gridSide - 1 ? g_adiUpper[y] : 0.0f);
+            const SIMD_FLOAT vecVelocityScale = SIMD_SET1(velocityScale);
+            SIMD_FLOAT height;
+            for (; x + SIMD_WIDTH <= last; x += SIMD_WIDTH)
+            {
+                height = SIMD_SUB(SIMD_LOAD(hNext + i + x), SIMD_MUL(vecUpper, SIMD_LOAD(hNext + i + x + stride)));
+                SIMD_STORE(hNext + i + x, height);
+                SIMD_STORE(velocities + i + x, SIMD_MUL(SIMD_SUB(height, SIMD_LOAD(h + i + x)), vecVelocityScale));
+            }
+        }
+#endif
+        for (; x < last; x++)
+        {
+            if (y < g_gridSide - 1)
+            {
+                hNext[i + x] -= g_adiUpper[y] * hNext[i + x + stride];
+            }
+            velocities[i + x] = (hNext[i + x] - h[i + x]) * velocityScale;
+        }
     }
+}
+
+/**
+ * Berechnet Schritte des impliziten Verfahrens auf einem Worker. Pro Schritt
+ * wird (I - a Dx)(I - a Dy) h' = h + dt v geloest (ADI-Zerlegung des
+ * impliziten Euler-Verfahrens), erst zeilenweise fuer die eigenen Zeilen,
+ * dann spaltenweise fuer die eigenen Spalten. Das Verfahren ist fuer jede
+ * Schrittweite stabil und daempft kurze Wellen umso staerker, je groesser
+ * der Schritt ist.
+ * @param worker Nummer des Workers
+ * @param workerCount Anzahl der beteiligten Worker
+ * @param arg Parameter des Auftrags (SimulationJob)
+ */
+static void simulateImplicitStrip(GLint worker, GLint workerCount, void *arg)
+{
+    const SimulationJob *job = arg;
+    GLfloat coupling = job->force * SQUARE(job->dt);
+    GLint firstRow = g_gridSide * worker / workerCount;
+    GLint lastRow = g_gridSide * (worker + 1) / workerCount;
+    //Spalten in Vielfachen der SIMD-Breite verteilen
+    GLint columns = (g_gridSide / workerCount + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    GLint firstColumn = MIN(worker * columns, g_gridSide);
+    GLint lastColumn = (worker == workerCount - 1) ? g_gridSide : MIN(firstColumn + columns, g_gridSide);
+    GLfloat *current = heights;
+    GLfloat *next = nextHeights;
+    GLfloat *swap = NULL;
+    GLint step = 0;
+    GLint y = 0;
+    GLint i = 0;
 
-    for (i = 0; i < SQUARE(oldAmountVerticesSide); i++)
+    for (step = 0; step < job->steps; step++)
     {
-        oldHeights[i] = heights[i];
-        oldVelocities[i] = velocities[i];
+        for (y = firstRow; y < lastRow; y++)
+        {
+            i = gridIndex(0, y);
+            solveRowImplicit(current + i, next + i, velocities + i, coupling, job->dt);
+        }
+        //die Spalten brauchen die Ergebnisse aller Zeilen
+        waitAtBarrier();
+
+        solveColumnsImplicit(current, next, firstColumn, lastColumn, coupling, job->dt);
+        //der naechste Schritt braucht die neuen Hoehen aller Spalten
+        if (step < job->steps - 1)
+        {
+            waitAtBarrier();
+        }
+        swap = current;
+        current = next;
+        next = swap;
     }
+}
+
+/**
+ * Berechnet mehrere Schritte des impliziten Verfahrens
+ * @param steps Anzahl der Simulationsschritte
+ * @param stepInterval Zeitintervall eines Schrittes in Sekunden
+ */
+static void simulateImplicit(GLint steps, double stepInterval)
+{
+    SimulationJob job;
+    GLfloat *swap = NULL;
+    GLint workerCount = MIN(g_gridSide / MIN_ROWS_PER_STRIP, getWorkerCount());
+
+    job.steps = steps;
+    job.timeBlock = 1;
+    job.dt = (GLfloat)stepInterval;
+    job.force = SQUARE(WAVE_SPEED) / SQUARE(WAVE_WIDTH(g_gridSide));
+    prepareImplicit(job.force * SQUARE(job.dt));
 
-    //Speicher des Hoehenarrays realloziieren
-    heights = realloc(heights, SQUARE(newAmountVerticesSide) * sizeof(GLfloat));
-    if (heights == NULL)
+    runOnWorkers(simulateImplicitStrip, &job, MAX(workerCount, 1));
+
+    //nach ungerader Schrittzahl liegen die neuen Hoehen im Zwischenspeicher
+    if (steps % 2 == 1)
     {
-        exit(1);
+        swap = heights;
+        heights = nextHeights;
+        nextHeights = swap;
     }
-    //Speicher des Geschwindigkeitsarrays realloziieren
-    velocities = realloc(velocities, SQUARE(newAmountVerticesSide) * sizeof(GLfloat));
-    if (velocities == NULL)
+    refreshGhostBorder(heights);
+}
+
+void simulateWaterSteps(GLint steps, double stepInterval)
+{
+    GLint chunk = 0;
+    GLint i = 0;
+
+    g_simulationTime += steps * stepInterval;
+    if (g_waterSolver == spectralSolver)
     {
-        exit(1);
+        //keine Zwischenschritte noetig, nur der Endzeitpunkt wird berechnet
+        if (steps > 0)
+        {
+            syncFloatFields();
+            evaluateSpectralHeights();
+            g_packedFieldsFresh = GL_FALSE;
+            g_stepCount += steps;
+        }
+        steps = 0;
     }
-
-    //Fuellen des neuen Hoehen- und Geschwindigkeitsrrays
-    for (i = 0; i < SQUARE(newAmountVerticesSide); i++)
+    else if (g_waterSolver == implicitSolver)
     {
-        if ((i % newAmountVerticesSide) == 0)
+        //das implizite Verfahren koppelt das ganze Gitter, ruhende Kacheln gibt es hier nicht
+        if (steps > 0)
         {
-            rowCount++;
+            syncFloatFields();
+            simulateImplicit(steps, stepInterval);
+            g_packedFieldsFresh = GL_FALSE;
+            g_stepCount += steps;
+            g_simulationVersion++;
         }
+        steps = 0;
+    }
 
-        if (state == expand)
+    while (steps > 0)
+    {
+        //die Ruheerkennung laeuft im festen Takt der Schritte, unabhaengig davon,
+        //wie viele Schritte pro Aufruf berechnet werden
+        chunk = MIN(steps, SLEEP_CADENCE - (GLint)(g_stepCount % SLEEP_CADENCE));
+        if (g_awakeTiles > 0)
         {
-            //neue Punkte haben die Hoehe und Geschwindigkeit 0
-            if (((i % newAmountVerticesSide) == (newAmountVerticesSide - 1)) || ((i / newAmountVerticesSide) == (newAmountVerticesSide - 1)))
+            if (g_patchCount > 0)
             {
-                heights[i] = 0.0f;
-                velocities[i] = 0.0f;
+                //mit Patches muessen grobe und feine Schritte einzeln abgeglichen werden
+                for (i = 0; i < chunk; i++)
+                {
+                    simulateRefinedStep(stepInterval);
+                }
             }
-            //alte Punkte behalten ihre Werte
             else
             {
-                heights[i] = oldHeights[i - rowCount];
-                velocities[i] = oldVelocities[i - rowCount];
+                simulateWaterChunk(chunk, stepInterval);
             }
+            g_simulationVersion++;
         }
-        //Beim Verkleinern werden die Randpunkte einfach abgeschnitten
-        else
+        g_stepCount += chunk;
+        steps -= chunk;
+
+        if ((g_stepCount % SLEEP_CADENCE == 0) && (g_awakeTiles > 0))
         {
-            heights[i] = oldHeights[i + rowCount];
-            velocities[i] = oldVelocities[i + rowCount];
+            updateTileActivity(SQUARE(WAVE_SPEED) / SQUARE(WAVE_WIDTH(g_gridSide)));
+            if (useRefinement())
+            {
+                regridPatches();
+            }
         }
     }
+}
+
+void simulateWater(double idleInterval)
+{
+    simulateWaterSteps(1, idleInterval);
+}
+
+GLint queueImpulses(const Impulse *impulses, GLint count)
+{
+    GLuint head = g_impulseHead;
+    GLint accepted = MIN(count, (GLint)(IMPULSE_QUEUE_SIZE - (head - ATOMIC_LOAD(&g_impulseTail))));
+    GLint i = 0;
+
+    //was nicht mehr in die Warteschlange passt, geht verloren, statt die Darstellung warten zu lassen
+    for (i = 0; i < accepted; i++)
+    {
+        g_impulseQueue[(head + i) % IMPULSE_QUEUE_SIZE] = impulses[i];
+    }
+    ATOMIC_STORE(&g_impulseHead, head + accepted);
+    return accepted;
+}
+
+void pickedVertex(GLuint index, mouseButtons click)
+{
+    GLfloat spacing = WAVE_WIDTH(g_gridSide);
+    Impulse impulse;
 
-    //Freigabe der Zwischenspeicher
-    free(oldHeights);
-    free(oldVelocities);
+    //ein Radius von einem Saeulenabstand trifft nur den Punkt selbst
+    impulse.x = -1.0f + (index % g_gridSide) * spacing;
+    impulse.z = -1.0f + (index / g_gridSide) * spacing;
+    impulse.radius = spacing;
+    impulse.amplitude = click * PICK_HEIGHT;
+    queueImpulses(&impulse, 1);
 }
 
 /**
- * Bildet eine gewichtete Summe der Hoehen von einem Punkt und seinen Nachbarn, 
- * wenn ein Nachbar außerhalb liegen wuerde, wird der Punkt selbst stattdessen genommen
- * @param i Index des Punktes, zu dem die Nachbarn gesucht sind
- * @param amountVerticesSide Anzahl der Punkte entlang einer Seite,
- *        fuer die Bestimmung, ob ein Nachbar außerhalb waere
- * @return gewichtete Summe der Hoehen: Nachbarn mit +1 und der Punkt selbst mit -4
+ * Rastert einen Anstoss in die feinen Zellen eines Patches und setzt die
+ * groben Saeulen darunter auf deren Mittelwerte
+ * @param patch Patch
+ * @param impulse Anstoss
  */
-GLfloat getNeighbourHeights(GLint i, GLint amountVerticesSide)
+static void rasterizePatchImpulse(Patch *patch, const Impulse *impulse)
 {
-    GLfloat toReturn = 0.0f;
-    // Rechter Nachbar
-    if (((i + 1) % amountVerticesSide) == 0)
+    //Mittelpunkt und Radius in feinen Zellen, die Zelle gx hat ihren Mittelpunkt bei gx / 2 - 1 / 4 Saeulen
+    GLfloat spacing = 0.5f * WAVE_WIDTH(g_gridSide);
+    GLfloat centreX = (impulse->x + 1.0f) / spacing + 0.5f - 2 * patch->tileX * TILE_SIZE;
+    GLfloat centreZ = (impulse->z + 1.0f) / spacing + 0.5f - 2 * patch->tileY * TILE_SIZE;
+    GLfloat radius = impulse->radius / spacing;
+    GLint firstX = MAX((GLint)ceilf(centreX - radius), 0);
+    GLint lastX = MIN((GLint)floorf(centreX + radius), patch->cellsX - 1);
+    GLint firstY = MAX((GLint)ceilf(centreZ - radius), 0);
+    GLint lastY = MIN((GLint)floorf(centreZ + radius), patch->cellsY - 1);
+    GLint x, y;
+    GLfloat distance2 = 0.0f;
+
+    for (y = firstY; y <= lastY; y++)
     {
-        toReturn += heights[i];
+        for (x = firstX; x <= lastX; x++)
+        {
+            distance2 = SQUARE(x - centreX) + SQUARE(y - centreZ);
+            if (distance2 < SQUARE(radius))
+            {
+                patch->heights[(y + 1) * PATCH_STRIDE + x + 1] +=
+                    impulse->amplitude * 0.5f * (1.0f + cosf((GLfloat)M_PI * sqrtf(distance2) / radius));
+            }
+        }
     }
-    else
+    restrictPatch(patch);
+}
+
+/**
+ * Rastert einen Anstoss in die Hoehen: innerhalb des Radius wird die Amplitude
+ * mit dem glatten Kern (1 + cos(pi r / radius)) / 2 gewichtet addiert. Die
+ * Kacheln, die der Anstoss beruehrt, werden als aktiv markiert und, soweit das
+ * Budget reicht, vorher verfeinert; in Patches wird der Anstoss mit der feinen
+ * Aufloesung gerastert.
+ * @param impulse Anstoss
+ */
+static void rasterizeImpulse(const Impulse *impulse)
+{
+    GLfloat spacing = WAVE_WIDTH(g_gridSide);
+    //Mittelpunkt und Radius in Saeulenabstaenden
+    GLfloat centreX = (impulse->x + 1.0f) / spacing;
+    GLfloat centreZ = (impulse->z + 1.0f) / spacing;
+    GLfloat radius = impulse->radius / spacing;
+    GLint firstX = MAX((GLint)ceilf(centreX - radius), 0);
+    GLint lastX = MIN((GLint)floorf(centreX + radius), g_gridSide - 1);
+    GLint firstY = MAX((GLint)ceilf(centreZ - radius), 0);
+    GLint lastY = MIN((GLint)floorf(centreZ + radius), g_gridSide - 1);
+    GLint x, y;
+    GLfloat distance2 = 0.0f;
+
+    if ((radius > 0.0f) && (firstX <= lastX) && (firstY <= lastY))
     {
-        toReturn += heights[i + 1];
+        if (useRefinement())
+        {
+            for (y = firstY / TILE_SIZE; y <= lastY / TILE_SIZE; y++)
+            {
+                for (x = firstX / TILE_SIZE; x <= lastX / TILE_SIZE; x++)
+                {
+                    if ((g_tilePatch[y * g_tilesSide + x] == NULL) && (g_patchCount < g_patchCapacity))
+                    {
+                        refineTile(x, y);
+                    }
+                }
+            }
+        }
+
+        for (y = firstY; y <= lastY; y++)
+        {
+            for (x = firstX; x <= lastX; x++)
+            {
+                distance2 = SQUARE(x - centreX) + SQUARE(y - centreZ);
+                if ((distance2 < SQUARE(radius)) &&
+                    (g_tilePatch[(y / TILE_SIZE) * g_tilesSide + x / TILE_SIZE] == NULL))
+                {
+                    heights[gridIndex(x, y)] += impulse->amplitude * 0.5f *
+                                                (1.0f + cosf((GLfloat)M_PI * sqrtf(distance2) / radius));
+                }
+            }
+        }
+
+        for (y = firstY / TILE_SIZE; y <= lastY / TILE_SIZE; y++)
+        {
+            for (x = firstX / TILE_SIZE; x <= lastX / TILE_SIZE; x++)
+            {
+                g_tileActive[y * g_tilesSide + x] = GL_TRUE;
+                if (g_tilePatch[y * g_tilesSide + x] != NULL)
+                {
+                    rasterizePatchImpulse(g_tilePatch[y * g_tilesSide + x], impulse);
+                }
+            }
+        }
     }
+}
+
+void processImpulses(void)
+{
+    GLuint tail = g_impulseTail;
+    GLuint head = ATOMIC_LOAD(&g_impulseHead);
 
-    //Linker Nachbar
-    if ((i % amountVerticesSide) == 0)
+    if (tail != head)
     {
-        toReturn += heights[i];
+        //das spektrale Verfahren berechnet die Hoehen jedes Mal neu, Anstoesse haetten keine Wirkung
+        if (g_waterSolver != spectralSolver)
+        {
+            syncFloatFields();
+            g_packedFieldsFresh = GL_FALSE;
+            for (; tail != head; tail++)
+            {
+                rasterizeImpulse(&g_impulseQueue[tail % IMPULSE_QUEUE_SIZE]);
+            }
+            //Geisterrand und wache Kacheln einmal fuer alle Anstoesse nachfuehren
+            refreshGhostBorder(heights);
+            refreshTilesAwake();
+            g_simulationVersion++;
+        }
+        ATOMIC_STORE(&g_impulseTail, head);
     }
-    else
+}
+
+void publishSimulation(void)
+{
+    Snapshot *snapshot = &g_snapshots[g_snapshotBack];
+    size_t size = (size_t)(g_gridSide + 2) * g_gridStride * sizeof(GLfloat);
+    RefinedPatch *patch = NULL;
+    GLint i = 0;
+    GLint y = 0;
+
+    if (g_simulationVersion != g_publishedVersion)
     {
-        toReturn += heights[i - 1];
+        if (g_floatFieldsFresh)
+        {
+            memcpy(snapshot->heights, heights, size);
+            memcpy(snapshot->velocities, velocities, size);
+        }
+        else
+        {
+            //direkt aus der halben Genauigkeit, ohne Umweg ueber heights und velocities
+            unpackValues(g_packedHeights[g_packedCurrent], snapshot->heights, size / sizeof(GLfloat));
+            unpackValues(g_packedVelocities[g_packedCurrent], snapshot->velocities, size / sizeof(GLfloat));
+        }
+        //die Hoehen der Patches kompakt hintereinander, Patches gibt es nur auf GLfloat-Feldern
+        for (i = 0; i < g_patchCount; i++)
+        {
+            patch = &snapshot->patches[i];
+            patch->tileX = g_patches[i]->tileX;
+            patch->tileY = g_patches[i]->tileY;
+            patch->cellsX = g_patches[i]->cellsX;
+            patch->cellsY = g_patches[i]->cellsY;
+            patch->stride = PATCH_SIDE;
+            patch->heights = snapshot->patchHeights + (size_t)i * SQUARE(PATCH_SIDE);
+            for (y = 0; y < patch->cellsY; y++)
+            {
+                memcpy(snapshot->patchHeights + (size_t)i * SQUARE(PATCH_SIDE) + y * PATCH_SIDE,
+                       g_patches[i]->heights + (y + 1) * PATCH_STRIDE + 1, patch->cellsX * sizeof(GLfloat));
+            }
+        }
+        snapshot->patchCount = g_patchCount;
+        snapshot->patchLayout = g_patchLayout;
+        snapshot->version = g_simulationVersion;
+        g_snapshotBack = ATOMIC_EXCHANGE(&g_snapshotMiddle, g_snapshotBack | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+        g_publishedVersion = g_simulationVersion;
     }
+}
 
-    //Unterer Nachbar
-    if ((i + amountVerticesSide) >= SQUARE(amountVerticesSide))
+void acquireSimulation(void)
+{
+    if (ATOMIC_LOAD(&g_snapshotMiddle) & SNAPSHOT_FRESH)
     {
-        toReturn += heights[i];
+        g_snapshotFront = ATOMIC_EXCHANGE(&g_snapshotMiddle, g_snapshotFront) & ~SNAPSHOT_FRESH;
     }
-    else
+}
+
+void captureSimulationState(SimulationState *state)
+{
+    state->side = g_gridSide;
+    state->stride = g_gridStride;
+    state->solver = g_waterSolver;
+    state->stepCount = g_stepCount;
+    state->time = g_simulationTime;
+}
+
+const GLfloat *getSimulationHeights(void)
+{
+    syncFloatFields();
+    return heights + gridIndex(0, 0);
+}
+
+void captureSimulationFields(GLfloat *heightsOut, GLfloat *velocitiesOut)
+{
+    size_t size = (size_t)(g_gridSide + 2) * g_gridStride * sizeof(GLfloat);
+
+    syncFloatFields();
+    memcpy(heightsOut, heights, size);
+    memcpy(velocitiesOut, velocities, size);
+}
+
+void restoreSimulation(const SimulationState *state, const GLfloat *heightsIn, const GLfloat *velocitiesIn)
+{
+    GLint y = 0;
+
+    if (state->side != g_gridSide)
     {
-        toReturn += heights[i + amountVerticesSide];
+        updateLogic(state->side);
     }
 
-    //Oberer Nachbar
-    if (i < amountVerticesSide)
+    //Zeilen einzeln inkl. Geisterspalten kopieren, die Zeilenlaenge kann von einem
+    //anderen Build mit anderer SIMD-Breite stammen
+    for (y = 0; y < g_gridSide + 2; y++)
     {
-        toReturn += heights[i];
+        memcpy(heights + y * g_gridStride, heightsIn + y * state->stride, (g_gridSide + 2) * sizeof(GLfloat));
+        memcpy(velocities + y * g_gridStride, velocitiesIn + y * state->stride, (g_gridSide + 2) * sizeof(GLfloat));
     }
-    else
+    g_floatFieldsFresh = GL_TRUE;
+    g_packedFieldsFresh = GL_FALSE;
+
+    g_waterSolver = (waterSolver)state->solver;
+    g_stepCount = state->stepCount;
+    g_simulationTime = state->time;
+    if (g_waterSolver == spectralSolver)
     {
-        toReturn += heights[i - amountVerticesSide];
+        evaluateSpectralHeights();
     }
-
-    return (toReturn - (4 * heights[i]));
+    allocTiles();
+    g_simulationVersion++;
 }
 
-void simulateWater(double idleInterval)
+GLboolean getHalfStorage(void)
 {
-    GLint i = 0;
-    GLint amountVerticesSide = getAmountVertices();
-    GLfloat f = 0.0f;
+    return g_halfStorage;
+}
 
-    //Zwischenspeicher fuer die neu berechneten Hoehen,
-    //damit diese nicht die folgenden Berechnungen beeinflussen
-    GLfloat *newHeight = calloc(SQUARE(amountVerticesSide), sizeof(GLfloat));
-    if (newHeight == NULL)
+void setHalfStorage(GLboolean state)
+{
+    //auf den gepackten Feldern wird nur einheitlich grob gerechnet
+    if (state)
     {
-        exit(1);
+        dropPatches();
     }
+    g_halfStorage = state;
+}
 
-    //Berechnung der Wassersimulation
-    for (i = 0; i < SQUARE(amountVerticesSide); i++)
-    {
-        //Kraft haengt von den Hoehen ab
-        f = SQUARE(WAVE_SPEED) * (getNeighbourHeights(i, amountVerticesSide)) / SQUARE(WAVE_WIDTH);
-        //Geschwindigkeit haengt von der Kraft ab und der Abschwaechung
-        velocities[i] = (velocities[i] + f * idleInterval) * ATTENUATION;
-        //Aenderung der Hoehen haengt von der Geschwindigkeit und dem Zeitintervall ab
-        newHeight[i] = heights[i] + velocities[i] * idleInterval;
-    }
+GLboolean getRefinement(void)
+{
+    return g_refinement;
+}
 
-    //Uebernehem der neuen Hoehenwerte
-    for (i = 0; i < SQUARE(amountVerticesSide); i++)
+void setRefinement(GLboolean state)
+{
+    if (!state)
     {
-        heights[i] = newHeight[i];
+        dropPatches();
     }
-    free(newHeight);
+    g_refinement = state;
 }
 
-void pickedVertex(GLuint index, mouseButtons click)
+GLint getRefinedPatches(const RefinedPatch **patches, GLuint *layout)
+{
+    *patches = g_snapshots[g_snapshotFront].patches;
+    *layout = g_snapshots[g_snapshotFront].patchLayout;
+    return g_snapshots[g_snapshotFront].patchCount;
+}
+
+GLint getRefinedTileSize(void)
+{
+    return TILE_SIZE;
+}
+
+waterSolver getWaterSolver(void)
 {
-    heights[index] += click * PICK_HEIGHT;
+    return g_waterSolver;
+}
+
+void setWaterSolver(waterSolver solver)
+{
+    if (solver != g_waterSolver)
+    {
+        syncFloatFields();
+        g_packedFieldsFresh = GL_FALSE;
+        //nur das explizite Verfahren rechnet mit Patches, die groben Saeulen tragen deren Mittelwerte
+        dropPatches();
+
+        //nach dem spektralen Verfahren setzt die Simulation mit den aktuellen Hoehen in Ruhe fort
+        if (g_waterSolver == spectralSolver)
+        {
+            memset(velocities, 0, (size_t)(g_gridSide + 2) * g_gridStride * sizeof(GLfloat));
+        }
+
+        g_waterSolver = solver;
+        if (solver == spectralSolver)
+        {
+            evaluateSpectralHeights();
+        }
+        else
+        {
+            //die Hoehen koennen sich ueberall geaendert haben, alle Kacheln sind wieder aktiv
+            allocTiles();
+            g_simulationVersion++;
+        }
+    }
 }
 
 /**
@@ -325,10 +2556,46 @@ void setLight1State(light1State lightState)
 
 GLfloat *getHeights(void)
 {
-    return heights;
+    return g_snapshots[g_snapshotFront].heights + gridIndex(0, 0);
 }
 
 GLfloat *getVelocities(void)
 {
-    return velocities;
+    return g_snapshots[g_snapshotFront].velocities + gridIndex(0, 0);
+}
+
+GLint getGridStride(void)
+{
+    return g_gridStride;
+}
+
+GLuint getSimulationVersion(void)
+{
+    return g_snapshots[g_snapshotFront].version;
+}
+
+void sampleWaterHeights(CGVector3f *positions, GLint count)
+{
+    GLfloat spacing = WAVE_WIDTH(g_gridSide);
+    GLint maxCell = MAX(g_gridSide - 2, 0);
+    GLint i = 0;
+    GLint cx, cz;
+    GLfloat u, v, fx, fz;
+    const GLfloat *h = NULL;
+
+    for (i = 0; i < count; i++)
+    {
+        //Gitterkoordinaten der Position, auf die Flaeche des Mesh begrenzt
+        u = MIN(MAX((positions[i][0] + 1.0f) / spacing, 0.0f), (GLfloat)(g_gridSide - 1));
+        v = MIN(MAX((positions[i][2] + 1.0f) / spacing, 0.0f), (GLfloat)(g_gridSide - 1));
+        cx = MIN((GLint)u, maxCell);
+        cz = MIN((GLint)v, maxCell);
+        fx = u - cx;
+        fz = v - cz;
+
+        //bilineare Interpolation zwischen den vier Ecken der Zelle
+        h = g_snapshots[g_snapshotFront].heights + gridIndex(cx, cz);
+        positions[i][1] = (1.0f - fz) * ((1.0f - fx) * h[0] + fx * h[1]) +
+                          fz * ((1.0f - fx) * h[g_gridStride] + fx * h[g_gridStride + 1]);
+    }
 }
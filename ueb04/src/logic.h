@@ -24,10 +24,21 @@
 void initLogic(void);
 
 /**
- * Aktualisiert die Logik, wenn das Mesh vergroebert oder verfeinert wird 
- * @param state Ob, das Mesh vergoebert oder verfeinert wird 
+ * Aktualisiert die Logik, wenn das Mesh vergroebert oder verfeinert wird.
+ * Hoehen und Geschwindigkeiten werden auf das neue Gitter ueber derselben
+ * Flaeche bilinear umgerechnet. Laeuft die Simulation
+ * auf einem eigenen Thread, muss dieser angehalten sein (lockSimulation).
+ * @param amountVerticesSide neue Anzahl der Punkte pro Seite
  */
-void updateLogic(expandShrinkVertices state);
+void updateLogic(GLint amountVerticesSide);
+
+/**
+ * Liefert das groesste Zeitintervall eines Simulationsschrittes, bei dem die
+ * Simulation fuer die aktuelle Aufloesung noch stabil ist (CFL-Bedingung).
+ * Fuer das implizite und das spektrale Verfahren gibt es keine Grenze (DBL_MAX).
+ * @return Zeitintervall in Sekunden
+ */
+double getStableStepInterval(void);
 
 /**
  * Berechnet die Wassersimulation zeitabhängig,
@@ -38,13 +49,198 @@ void updateLogic(expandShrinkVertices state);
 void simulateWater(double idleInterval);
 
 /**
- * Aktualisiert die Hoehe eines Punktes, wenn dieser gepickt wird
+ * Berechnet mehrere gleich grosse Schritte der Wassersimulation am Stueck.
+ * Die Zeilen des Gitters werden dabei auf die Worker-Threads verteilt.
+ * @param steps Anzahl der Simulationsschritte
+ * @param stepInterval Zeitintervall eines Schrittes in Sekunden
+ */
+void simulateWaterSteps(GLint steps, double stepInterval);
+
+/**
+ * Stellt Anstoesse (z.B. Picks, Regentropfen, Bugwellen) ohne Sperre in eine
+ * Warteschlange, beim naechsten processImpulses werden sie in die Hoehen
+ * gerastert (Aufruf vom GLUT-Thread).
+ * @param impulses Anstoesse
+ * @param count Anzahl der Anstoesse
+ * @return Anzahl der uebernommenen Anstoesse, bei voller Warteschlange weniger als count
+ */
+GLint queueImpulses(const Impulse *impulses, GLint count);
+
+/**
+ * Aktualisiert die Hoehe eines Punktes, wenn dieser gepickt wird.
+ * Der Pick wird als Anstoss mit einem Radius von einem Saeulenabstand in die
+ * Warteschlange gestellt (Aufruf vom GLUT-Thread).
  * @param index Index des Punktes, der gepickt wurde
  * @param click Art, wie der Punkt gepickt wurde, 
  *              bei linker Maustaste erhoehen, bei rechter Maustaste verringern
  */
 void pickedVertex(GLuint index, mouseButtons click);
 
+/**
+ * Rastert alle seit dem letzten Aufruf eingereihten Anstoesse in die Hoehen
+ * (Aufruf von der Simulation vor dem naechsten Schritt)
+ */
+void processImpulses(void);
+
+/**
+ * Veroeffentlicht den aktuellen Stand der Simulation fuer die Darstellung,
+ * sofern er sich seit der letzten Veroeffentlichung geaendert hat
+ * (Aufruf von der Simulation, blockiert nie)
+ */
+void publishSimulation(void);
+
+/**
+ * Uebernimmt den zuletzt veroeffentlichten Stand der Simulation fuer die
+ * Darstellung. getHeights, getVelocities, getSimulationVersion und
+ * sampleWaterHeights liefern bis zum naechsten Aufruf diesen Stand
+ * (Aufruf vom GLUT-Thread, blockiert nie).
+ */
+void acquireSimulation(void);
+
+/**
+ * Zustand der Simulation ohne die Felder, z.B. fuer Checkpoints
+ */
+typedef struct
+{
+    /** Anzahl der Wassersaeulen pro Seite */
+    GLint side;
+    /** Abstand zweier Zeilen in den Feldern (inkl. Geisterrand) */
+    GLint stride;
+    /** Verfahren (waterSolver) */
+    GLint solver;
+    /** Anzahl der bisher berechneten Simulationsschritte */
+    GLuint stepCount;
+    /** simulierte Zeit in Sekunden */
+    double time;
+} SimulationState;
+
+/**
+ * Liefert den Zustand der Simulation. Laeuft die Simulation auf einem eigenen
+ * Thread, muss dieser angehalten sein (lockSimulation).
+ * @param state Zustand (Out)
+ */
+void captureSimulationState(SimulationState *state);
+
+/**
+ * Liefert die Hoehen, mit denen die Simulation gerade rechnet (nicht den
+ * veroeffentlichten Stand). Zeile y beginnt bei y * stride (siehe
+ * captureSimulationState). Nur auf dem Simulationsthread bzw. bei angehaltener
+ * Simulation (lockSimulation) gueltig.
+ * @return Hoehen ohne Geisterrand
+ */
+const GLfloat *getSimulationHeights(void);
+
+/**
+ * Kopiert Hoehen und Geschwindigkeiten der Simulation samt Geisterrand
+ * ((side + 2) * stride Werte je Feld, beginnend mit der oberen Geisterzeile).
+ * Laeuft die Simulation auf einem eigenen Thread, muss dieser angehalten sein.
+ * @param heightsOut Ziel der Hoehen (Out)
+ * @param velocitiesOut Ziel der Geschwindigkeiten (Out)
+ */
+void captureSimulationFields(GLfloat *heightsOut, GLfloat *velocitiesOut);
+
+/**
+ * Stellt einen mit captureSimulationState und captureSimulationFields
+ * gesicherten Zustand wieder her, die Aufloesung wird ggf. angepasst.
+ * Beide Felder werden zeilenweise in die Felder der Simulation kopiert
+ * (linear in der Anzahl der Punkte), die Quellen duerfen danach ungueltig werden.
+ * Laeuft die Simulation auf einem eigenen Thread, muss dieser angehalten sein.
+ * @param state Zustand (Seitenlaenge, Zeilenlaenge der Felder, ...)
+ * @param heightsIn Hoehen im Layout des Zustands
+ * @param velocitiesIn Geschwindigkeiten im Layout des Zustands
+ */
+void restoreSimulation(const SimulationState *state, const GLfloat *heightsIn, const GLfloat *velocitiesIn);
+
+/**
+ * Liefert, ob das explizite Verfahren Hoehen und Geschwindigkeiten in halber
+ * Genauigkeit speichert
+ * @return GL_TRUE bei halber Genauigkeit
+ */
+GLboolean getHalfStorage(void);
+
+/**
+ * Legt fest, ob das explizite Verfahren Hoehen und Geschwindigkeiten in halber
+ * Genauigkeit (IEEE binary16) speichert. Gerechnet wird weiterhin mit GLfloat,
+ * gerundet wird nur beim Zurueckschreiben nach jedem Block von Schritten. Das
+ * halbiert den Speicherverkehr bei grossen Gittern, kostet aber Genauigkeit
+ * (etwa 3 Dezimalstellen relativ). Laeuft die Simulation auf einem eigenen
+ * Thread, muss dieser angehalten sein (lockSimulation).
+ * @param state GL_TRUE fuer halbe Genauigkeit
+ */
+void setHalfStorage(GLboolean state);
+
+/**
+ * Liefert, ob das explizite Verfahren Kacheln mit starker Kruemmung verfeinert
+ * @return GL_TRUE, wenn verfeinert wird
+ */
+GLboolean getRefinement(void);
+
+/**
+ * Legt fest, ob das explizite Verfahren Kacheln verfeinert (standardmaessig
+ * an). Aktive Kacheln mit starker Kruemmung (z.B. um Picks und Wellenfronten)
+ * werden dann durch Patches mit halbem Saeulenabstand ersetzt, die je groben
+ * Schritt zwei halbe Schritte rechnen; ruhige Kacheln werden wieder
+ * vergroebert. An den Grenzen der Stufen werden die Werte erhaltend verteilt
+ * bzw. gemittelt und die Fluesse abgeglichen, Volumen und Impuls bleiben also
+ * erhalten. Das implizite und das spektrale Verfahren sowie die halbe
+ * Genauigkeit rechnen immer einheitlich grob. Beim Ausschalten rechnet die
+ * Simulation mit den Mittelwerten der Patches weiter. Laeuft die Simulation
+ * auf einem eigenen Thread, muss dieser angehalten sein (lockSimulation).
+ * @param state GL_TRUE, um zu verfeinern
+ */
+void setRefinement(GLboolean state);
+
+/**
+ * Verfeinerte Kachel eines veroeffentlichten Standes
+ */
+typedef struct
+{
+    /** Spalte und Zeile der Kachel (Kantenlaenge getRefinedTileSize() Punkte) */
+    GLint tileX;
+    GLint tileY;
+    /** Anzahl der feinen Zellen pro Zeile bzw. Spalte, doppelt so viele wie Punkte der Kachel */
+    GLint cellsX;
+    GLint cellsY;
+    /**
+     * Hoehen der feinen Zellen zeilenweise, Zelle (fx, fy) bei fy * stride + fx.
+     * Die vier Zellen des Punktes (x, y) liegen eine Viertel Punktabstand
+     * neben ihm, ihr Mittelwert ist die Hoehe des Punktes in getHeights.
+     */
+    const GLfloat *heights;
+    GLint stride;
+} RefinedPatch;
+
+/**
+ * Liefert die verfeinerten Kacheln des mit acquireSimulation uebernommenen
+ * Standes, gueltig bis zum naechsten Aufruf von acquireSimulation
+ * @param patches verfeinerte Kacheln (Out)
+ * @param layout Stand der Aufteilung in Kacheln (Out), aendert sich nur, wenn
+ *        Kacheln verfeinert oder vergroebert werden
+ * @return Anzahl der verfeinerten Kacheln
+ */
+GLint getRefinedPatches(const RefinedPatch **patches, GLuint *layout);
+
+/**
+ * Liefert die Kantenlaenge einer Kachel, die verfeinert werden kann
+ * @return Anzahl der Punkte pro Seite einer Kachel
+ */
+GLint getRefinedTileSize(void);
+
+/**
+ * Liefert das Verfahren, mit dem die Hoehen des Wassers berechnet werden
+ * @return aktuelles Verfahren
+ */
+waterSolver getWaterSolver(void);
+
+/**
+ * Wechselt das Verfahren, mit dem die Hoehen des Wassers berechnet werden.
+ * Beim Wechsel vom spektralen Verfahren zur Simulation setzt diese mit den
+ * aktuellen Hoehen in Ruhe fort. Laeuft die Simulation auf einem eigenen
+ * Thread, muss dieser angehalten sein (lockSimulation).
+ * @param solver neues Verfahren
+ */
+void setWaterSolver(waterSolver solver);
+
 /**
  * gibt den in der Logik fuer das Hoehen- und Geschwindigkeitsarray reservierten Speicher wieder frei 
  */ 
@@ -100,15 +296,42 @@ getLight1State(void);
 void setLight1State(light1State lightState);
 
 /**
- * liefert das Hoehenarray
- * @return Zeiger auf die Hoehen
+ * liefert das Hoehenarray des mit acquireSimulation uebernommenen Standes.
+ * Die Hoehe des Punktes in Spalte x und Zeile y liegt bei
+ * getHeights()[y * getGridStride() + x].
+ * @return Zeiger auf die Hoehe des ersten Punktes
  */
 GLfloat *getHeights(void);
 
 
 /**
- * liefert das Geschwindigkeitsarray
- * @return Zeiger auf die Geschwindigkeiten
+ * liefert das Geschwindigkeitsarray des mit acquireSimulation uebernommenen
+ * Standes (gleiches Layout wie das Hoehenarray)
+ * @return Zeiger auf die Geschwindigkeit des ersten Punktes
  */
 GLfloat *getVelocities(void);
+
+/**
+ * liefert den Abstand zweier Zeilen im Hoehen- und Geschwindigkeitsarray
+ * @return Zeilenlaenge im Speicher
+ */
+GLint getGridStride(void);
+
+/**
+ * liefert den mit acquireSimulation uebernommenen Stand der Simulation. Der Wert aendert sich, sobald sich die
+ * Hoehen veraendern (Simulationsschritt, Picking, Aenderung der Aufloesung),
+ * sodass abgeleitete Daten nur bei Bedarf neu berechnet werden muessen.
+ * @return Stand der Simulation
+ */
+GLuint getSimulationVersion(void);
+
+/**
+ * Setzt die Hoehe schwimmender Objekte auf die Hoehe der Wasseroberflaeche an
+ * deren Position. Die Zelle des Gitters wird direkt aus den Koordinaten
+ * bestimmt und die Hoehe bilinear interpoliert, der Aufwand je Objekt ist
+ * daher unabhaengig von der Aufloesung des Mesh.
+ * @param positions Positionen der Objekte (x, y, z) ueber [-1, 1], y wird gesetzt (In/Out)
+ * @param count Anzahl der Objekte
+ */
+void sampleWaterHeights(CGVector3f *positions, GLint count);
 #endif
\ No newline at end of file
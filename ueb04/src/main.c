@@ -9,10 +9,73 @@
 
 /* ---- System Header einbinden ---- */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /* ---- Eigene Header einbinden ---- */
 #include "io.h"
 #include "types.h"
+#include "workers.h"
+#include "checkpoint.h"
+#include "heightExport.h"
+#include "logic.h"
+#include "governor.h"
+
+/**
+ * Wertet die Kommandozeilenparameter aus.
+ * Unterstuetzt wird --threads N fuer die Anzahl der Threads der
+ * Wassersimulation (0 oder ohne Angabe: Anzahl der Prozessorkerne) und
+ * --checkpoint DATEI fuer die Datei, in die F7 sichert und aus der F8 laedt.
+ * Mit --export DATEI und --export-steps N werden Datei und Abstand in
+ * Simulationsschritten des mit e gestarteten Exports der Hoehen gesetzt.
+ * --half speichert die Felder des expliziten Verfahrens in halber Genauigkeit.
+ * --fps N schaltet den Bildratenregler mit der Ziel-Bildrate N ein.
+ * @param argc Anzahl der Kommandozeilenparameter (In).
+ * @param argv Kommandozeilenparameter (In).
+ */
+static void
+parseArguments (int argc, char **argv)
+{
+  int i;
+  int threads = 0;
+  const char *exportFile = NULL;
+  int exportSteps = 0;
+
+  for (i = 1; i < argc; i++)
+    {
+      if ((strcmp (argv[i], "--threads") == 0) && (i + 1 < argc))
+        {
+          threads = atoi (argv[++i]);
+        }
+      else if ((strcmp (argv[i], "--checkpoint") == 0) && (i + 1 < argc))
+        {
+          setCheckpointFile (argv[++i]);
+        }
+      else if ((strcmp (argv[i], "--export") == 0) && (i + 1 < argc))
+        {
+          exportFile = argv[++i];
+        }
+      else if ((strcmp (argv[i], "--export-steps") == 0) && (i + 1 < argc))
+        {
+          exportSteps = atoi (argv[++i]);
+        }
+      else if (strcmp (argv[i], "--half") == 0)
+        {
+          setHalfStorage (GL_TRUE);
+        }
+      else if ((strcmp (argv[i], "--fps") == 0) && (i + 1 < argc))
+        {
+          setGovernorTarget ((GLfloat) atof (argv[++i]));
+        }
+      else
+        {
+          fprintf (stderr, "Unbekannter Parameter: %s\n", argv[i]);
+        }
+    }
+
+  initWorkers (threads);
+  setExportOptions (exportFile, exportSteps);
+}
 
 /**
  * Hauptprogramm.
@@ -24,8 +87,8 @@
 int
 main (int argc, char **argv)
 {
-	(void)argc;
-	(void)argv;
+  parseArguments (argc, argv);
+
   /* Initialisierung des I/O-Sytems
      (inkl. Erzeugung des Fensters und Starten der Ereignisbehandlung). */
   if (!initAndStartIO
@@ -0,0 +1,478 @@
+/**
+ * @file
+ * Ozean-Modul.
+ * Das Modul berechnet ein Hoehenfeld nach dem spektralen Verfahren von
+ * Tessendorf. Zu jeder Wellenzahl k wird einmalig eine zufaellige Amplitude
+ * h0(k) nach dem Phillips-Spektrum erzeugt. Zum Zeitpunkt t ist das Spektrum
+ * H(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t) mit w = sqrt(g |k|),
+ * das Hoehenfeld ergibt sich daraus per inverser 2D-FFT.
+ *
+ * Die FFT ist eine iterative Radix-2-FFT auf getrennten Real- und
+ * Imaginaerteilen. Das Spektrum wird direkt in bitumgekehrter Reihenfolge
+ * abgelegt, so dass kein eigener Umsortierschritt noetig ist. Die Spalten
+ * werden zeilenweise transformiert (ein Twiddle-Faktor pro Zeilenpaar, SIMD
+ * ueber die Spalten), die Zeilen mit SIMD ueber die Twiddle-Faktoren einer
+ * Stufe. Beide Durchlaeufe sind auf die Worker verteilt.
+ *
+ * Das FFT-Gitter hat n x n Punkte (n die kleinste Zweierpotenz >= Seitenlaenge)
+ * mit dem Punktabstand des Mesh, dargestellt wird der linke obere Ausschnitt.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <math.h>
+#include <stdlib.h>
+
+/* ---- Eigene Header einbinden ---- */
+#include "ocean.h"
+#include "simd.h"
+#include "workers.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Erdbeschleunigung in Szeneneinheiten pro Quadratsekunde */
+#define OCEAN_GRAVITY (9.81f)
+
+/** Windgeschwindigkeit, die groessten Wellen haben etwa die Laenge V^2 / g */
+#define OCEAN_WIND_SPEED (1.0f)
+
+/** Windrichtung in der xz-Ebene (wird normiert) */
+#define OCEAN_WIND_X (1.0f)
+#define OCEAN_WIND_Z (0.6f)
+
+/** Anteil der Windwellenlaenge, unterhalb dessen Wellen gedaempft werden */
+#define OCEAN_SMALL_WAVES (0.01f)
+
+/** Standardabweichung der Hoehen, auf die das Spektrum skaliert wird */
+#define OCEAN_AMPLITUDE (0.05f)
+
+/** Startwert des Zufallsgenerators, bei gleicher Aufloesung entsteht dasselbe Meer */
+#define OCEAN_SEED (4711u)
+
+/** Mindestanzahl an FFT-Zeilen pro Worker, damit sich das Verteilen lohnt */
+#define OCEAN_MIN_ROWS_PER_WORKER (16)
+
+#ifndef MIN
+/** Minimum zweier Zahlen */
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+/** Seitenlaenge des Mesh, fuer die das Spektrum erzeugt wurde */
+static GLint g_oceanSide = 0;
+
+/** Anzahl der Punkte pro Seite des FFT-Gitters (Zweierpotenz) */
+static GLint g_fftSize = 0;
+
+/** Amplituden h0(k), Real- und Imaginaerteil, Zeile ky, Spalte kx */
+static GLfloat *g_h0Re = NULL;
+static GLfloat *g_h0Im = NULL;
+
+/** Kreisfrequenz w(k) jeder Welle */
+static GLfloat *g_omega = NULL;
+
+/** Arbeitsspeicher der FFT, Real- und Imaginaerteil */
+static GLfloat *g_re = NULL;
+static GLfloat *g_im = NULL;
+
+/**
+ * Twiddle-Faktoren e^(i pi k / m) der inversen FFT: die Eintraege m bis 2m - 1
+ * gehoeren zur Stufe, in der Haelften der Laenge m zusammengefuehrt werden
+ */
+static GLfloat *g_twiddleRe = NULL;
+static GLfloat *g_twiddleIm = NULL;
+
+/** Bitumgekehrter Index zu jedem Index 0 bis n - 1 */
+static GLint *g_bitReverse = NULL;
+
+/** Auftrag zur Berechnung des Hoehenfeldes auf den Workern */
+typedef struct
+{
+  double time;
+  GLfloat *heights;
+  GLint stride;
+  GLint side;
+} OceanJob;
+
+/**
+ * Liefert eine gleichverteilte Zufallszahl aus (0, 1). Der eigene Generator
+ * laesst die Folge von rand() unberuehrt.
+ * @param state Zustand des Generators (In/Out)
+ * @return Zufallszahl
+ */
+static GLfloat randomUniform(GLuint *state)
+{
+  *state = *state * 1664525u + 1013904223u;
+  return ((*state >> 8) + 0.5f) / 16777216.0f;
+}
+
+/**
+ * Phillips-Spektrum fuer die Wellenzahl (kx, kz)
+ * @param kx Wellenzahl in x-Richtung
+ * @param kz Wellenzahl in z-Richtung
+ * @return Energie der Welle (unskaliert)
+ */
+static GLfloat phillips(GLfloat kx, GLfloat kz)
+{
+  GLfloat windLength = SQUARE(OCEAN_WIND_SPEED) / OCEAN_GRAVITY;
+  GLfloat windNorm = sqrtf(SQUARE(OCEAN_WIND_X) + SQUARE(OCEAN_WIND_Z));
+  GLfloat k2 = SQUARE(kx) + SQUARE(kz);
+  GLfloat kDotWind = 0.0f;
+
+  if (k2 <= 0.0f)
+  {
+    return 0.0f;
+  }
+  kDotWind = (kx * OCEAN_WIND_X + kz * OCEAN_WIND_Z) / windNorm;
+
+  return expf(-1.0f / (k2 * SQUARE(windLength))) / SQUARE(k2) * SQUARE(kDotWind) / k2 *
+         expf(-k2 * SQUARE(windLength * OCEAN_SMALL_WAVES));
+}
+
+/**
+ * Gibt die Felder des Spektrums und der FFT frei
+ */
+static void freeSpectrum(void)
+{
+  free(g_h0Re);
+  free(g_h0Im);
+  free(g_omega);
+  free(g_re);
+  free(g_im);
+  free(g_twiddleRe);
+  free(g_twiddleIm);
+  free(g_bitReverse);
+  g_h0Re = g_h0Im = g_omega = g_re = g_im = g_twiddleRe = g_twiddleIm = NULL;
+  g_bitReverse = NULL;
+  g_oceanSide = 0;
+  g_fftSize = 0;
+}
+
+/**
+ * Erzeugt Spektrum, Twiddle-Faktoren und Bitumkehrtabelle fuer die Seitenlaenge
+ * @param side Anzahl der Punkte pro Seite des Mesh
+ */
+static void initSpectrum(GLint side)
+{
+  GLint n = 2;
+  GLint bits = 1;
+  GLint kx, ky, m, i, b;
+  GLfloat spacing = 2.0f / (side - 1);
+  GLfloat patch = 0.0f;
+  GLfloat waveX, waveZ, amplitude, radius, angle;
+  GLuint seed = OCEAN_SEED;
+  double variance = 0.0;
+  GLfloat scale = 0.0f;
+
+  freeSpectrum();
+
+  while (n < side)
+  {
+    n <<= 1;
+    bits++;
+  }
+  patch = n * spacing;
+
+  g_h0Re = malloc(sizeof(GLfloat) * n * n);
+  g_h0Im = malloc(sizeof(GLfloat) * n * n);
+  g_omega = malloc(sizeof(GLfloat) * n * n);
+  g_re = malloc(sizeof(GLfloat) * n * n);
+  g_im = malloc(sizeof(GLfloat) * n * n);
+  g_twiddleRe = malloc(sizeof(GLfloat) * n);
+  g_twiddleIm = malloc(sizeof(GLfloat) * n);
+  g_bitReverse = malloc(sizeof(GLint) * n);
+  if ((g_h0Re == NULL) || (g_h0Im == NULL) || (g_omega == NULL) || (g_re == NULL) || (g_im == NULL) ||
+      (g_twiddleRe == NULL) || (g_twiddleIm == NULL) || (g_bitReverse == NULL))
+  {
+    exit(1);
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    g_bitReverse[i] = 0;
+    for (b = 0; b < bits; b++)
+    {
+      g_bitReverse[i] |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+  }
+
+  for (m = 1; m < n; m <<= 1)
+  {
+    for (i = 0; i < m; i++)
+    {
+      g_twiddleRe[m + i] = (GLfloat)cos(M_PI * i / m);
+      g_twiddleIm[m + i] = (GLfloat)sin(M_PI * i / m);
+    }
+  }
+
+  for (ky = 0; ky < n; ky++)
+  {
+    waveZ = 2.0f * (GLfloat)M_PI * (ky < n / 2 ? ky : ky - n) / patch;
+    for (kx = 0; kx < n; kx++)
+    {
+      waveX = 2.0f * (GLfloat)M_PI * (kx < n / 2 ? kx : kx - n) / patch;
+      i = ky * n + kx;
+
+      //normalverteilte Zufallszahlen nach Box-Muller
+      radius = sqrtf(-2.0f * logf(randomUniform(&seed)));
+      angle = 2.0f * (GLfloat)M_PI * randomUniform(&seed);
+
+      //die Nyquist-Frequenz hat keinen eigenen Gegenpart und bleibt leer
+      amplitude = ((kx == n / 2) || (ky == n / 2)) ? 0.0f : sqrtf(0.5f * phillips(waveX, waveZ));
+      g_h0Re[i] = radius * cosf(angle) * amplitude;
+      g_h0Im[i] = radius * sinf(angle) * amplitude;
+      g_omega[i] = sqrtf(OCEAN_GRAVITY * sqrtf(SQUARE(waveX) + SQUARE(waveZ)));
+      variance += SQUARE(g_h0Re[i]) + SQUARE(g_h0Im[i]);
+    }
+  }
+
+  //jede Welle traegt mit h0(k) und h0(-k) zur Varianz der Hoehen bei (Parseval)
+  scale = variance > 0.0 ? (GLfloat)(OCEAN_AMPLITUDE / sqrt(2.0 * variance)) : 0.0f;
+  for (i = 0; i < n * n; i++)
+  {
+    g_h0Re[i] *= scale;
+    g_h0Im[i] *= scale;
+  }
+
+  g_oceanSide = side;
+  g_fftSize = n;
+}
+
+/**
+ * Berechnet das Spektrum H(k, t) fuer einige Zeilen ky und legt es
+ * bitumgekehrt im Arbeitsspeicher der FFT ab
+ * @param time Zeitpunkt in Sekunden
+ * @param first erste Zeile
+ * @param last Zeile hinter der letzten Zeile
+ */
+static void buildSpectrum(double time, GLint first, GLint last)
+{
+  GLint n = g_fftSize;
+  GLint kx, ky, i, j, target;
+  double phase = 0.0;
+  GLfloat c, s;
+
+  for (ky = first; ky < last; ky++)
+  {
+    target = g_bitReverse[ky] * n;
+    for (kx = 0; kx < n; kx++)
+    {
+      i = ky * n + kx;
+      //Index der Welle -k
+      j = ((n - ky) & (n - 1)) * n + ((n - kx) & (n - 1));
+
+      //Phase in double, damit sie auch nach langer Laufzeit genau bleibt
+      phase = g_omega[i] * time;
+      phase -= floor(phase / (2.0 * M_PI)) * (2.0 * M_PI);
+      c = cosf((GLfloat)phase);
+      s = sinf((GLfloat)phase);
+
+      //h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t), das Ergebnis ist hermitesch
+      g_re[target + g_bitReverse[kx]] = (g_h0Re[i] + g_h0Re[j]) * c - (g_h0Im[i] + g_h0Im[j]) * s;
+      g_im[target + g_bitReverse[kx]] = (g_h0Re[i] - g_h0Re[j]) * s + (g_h0Im[i] - g_h0Im[j]) * c;
+    }
+  }
+}
+
+/**
+ * Butterfly zweier Zeilen mit gemeinsamem Twiddle-Faktor w:
+ * a' = a + w b, b' = a - w b fuer die Spalten first bis last - 1
+ * @param aRe Realteile der Zeile a (In/Out)
+ * @param aIm Imaginaerteile der Zeile a (In/Out)
+ * @param bRe Realteile der Zeile b (In/Out)
+ * @param bIm Imaginaerteile der Zeile b (In/Out)
+ * @param wRe Realteil des Twiddle-Faktors
+ * @param wIm Imaginaerteil des Twiddle-Faktors
+ * @param first erste Spalte
+ * @param last Spalte hinter der letzten Spalte
+ */
+static void butterflyRows(GLfloat *aRe, GLfloat *aIm, GLfloat *bRe, GLfloat *bIm,
+                          GLfloat wRe, GLfloat wIm, GLint first, GLint last)
+{
+  GLint x = first;
+  GLfloat tRe, tIm;
+#if SIMD_WIDTH > 1
+  SIMD_FLOAT wr = SIMD_SET1(wRe);
+  SIMD_FLOAT wi = SIMD_SET1(wIm);
+  SIMD_FLOAT ar, ai, br, bi, tr, ti;
+
+  for (; x + SIMD_WIDTH <= last; x += SIMD_WIDTH)
+  {
+    ar = SIMD_LOAD(aRe + x);
+    ai = SIMD_LOAD(aIm + x);
+    br = SIMD_LOAD(bRe + x);
+    bi = SIMD_LOAD(bIm + x);
+    tr = SIMD_SUB(SIMD_MUL(br, wr), SIMD_MUL(bi, wi));
+    ti = SIMD_ADD(SIMD_MUL(br, wi), SIMD_MUL(bi, wr));
+    SIMD_STORE(aRe + x, SIMD_ADD(ar, tr));
+    SIMD_STORE(aIm + x, SIMD_ADD(ai, ti));
+    SIMD_STORE(bRe + x, SIMD_SUB(ar, tr));
+    SIMD_STORE(bIm + x, SIMD_SUB(ai, ti));
+  }
+#endif
+  for (; x < last; x++)
+  {
+    tRe = bRe[x] * wRe - bIm[x] * wIm;
+    tIm = bRe[x] * wIm + bIm[x] * wRe;
+    bRe[x] = aRe[x] - tRe;
+    bIm[x] = aIm[x] - tIm;
+    aRe[x] += tRe;
+    aIm[x] += tIm;
+  }
+}
+
+/**
+ * Butterfly zweier Haelften einer Zeile mit je eigenem Twiddle-Faktor:
+ * a[k]' = a[k] + w[k] b[k], b[k]' = a[k] - w[k] b[k] fuer k = 0 bis count - 1
+ * @param aRe Realteile der ersten Haelfte (In/Out)
+ * @param aIm Imaginaerteile der ersten Haelfte (In/Out)
+ * @param bRe Realteile der zweiten Haelfte (In/Out)
+ * @param bIm Imaginaerteile der zweiten Haelfte (In/Out)
+ * @param wRe Realteile der Twiddle-Faktoren
+ * @param wIm Imaginaerteile der Twiddle-Faktoren
+ * @param count Laenge einer Haelfte
+ */
+static void butterflySpan(GLfloat *aRe, GLfloat *aIm, GLfloat *bRe, GLfloat *bIm,
+                          const GLfloat *wRe, const GLfloat *wIm, GLint count)
+{
+  GLint k = 0;
+  GLfloat tRe, tIm;
+#if SIMD_WIDTH > 1
+  SIMD_FLOAT ar, ai, br, bi, wr, wi, tr, ti;
+
+  for (; k + SIMD_WIDTH <= count; k += SIMD_WIDTH)
+  {
+    ar = SIMD_LOAD(aRe + k);
+    ai = SIMD_LOAD(aIm + k);
+    br = SIMD_LOAD(bRe + k);
+    bi = SIMD_LOAD(bIm + k);
+    wr = SIMD_LOAD(wRe + k);
+    wi = SIMD_LOAD(wIm + k);
+    tr = SIMD_SUB(SIMD_MUL(br, wr), SIMD_MUL(bi, wi));
+    ti = SIMD_ADD(SIMD_MUL(br, wi), SIMD_MUL(bi, wr));
+    SIMD_STORE(aRe + k, SIMD_ADD(ar, tr));
+    SIMD_STORE(aIm + k, SIMD_ADD(ai, ti));
+    SIMD_STORE(bRe + k, SIMD_SUB(ar, tr));
+    SIMD_STORE(bIm + k, SIMD_SUB(ai, ti));
+  }
+#endif
+  for (; k < count; k++)
+  {
+    tRe = bRe[k] * wRe[k] - bIm[k] * wIm[k];
+    tIm = bRe[k] * wIm[k] + bIm[k] * wRe[k];
+    bRe[k] = aRe[k] - tRe;
+    bIm[k] = aIm[k] - tIm;
+    aRe[k] += tRe;
+    aIm[k] += tIm;
+  }
+}
+
+/**
+ * Inverse FFT der Spalten first bis last - 1 (Eingabe bitumgekehrt)
+ * @param first erste Spalte
+ * @param last Spalte hinter der letzten Spalte
+ */
+static void transformColumns(GLint first, GLint last)
+{
+  GLint n = g_fftSize;
+  GLint m, j, k, a, b;
+
+  for (m = 1; m < n; m <<= 1)
+  {
+    for (j = 0; j < n; j += 2 * m)
+    {
+      for (k = 0; k < m; k++)
+      {
+        a = (j + k) * n;
+        b = (j + k + m) * n;
+        butterflyRows(g_re + a, g_im + a, g_re + b, g_im + b, g_twiddleRe[m + k], g_twiddleIm[m + k], first, last);
+      }
+    }
+  }
+}
+
+/**
+ * Inverse FFT einer Zeile (Eingabe bitumgekehrt)
+ * @param y Zeile
+ */
+static void transformRow(GLint y)
+{
+  GLint n = g_fftSize;
+  GLfloat *re = g_re + y * n;
+  GLfloat *im = g_im + y * n;
+  GLint m, j;
+
+  for (m = 1; m < n; m <<= 1)
+  {
+    for (j = 0; j < n; j += 2 * m)
+    {
+      butterflySpan(re + j, im + j, re + j + m, im + j + m, g_twiddleRe + m, g_twiddleIm + m, m);
+    }
+  }
+}
+
+/**
+ * Berechnet das Hoehenfeld auf einem Worker: erst das Spektrum, dann die
+ * Spalten und zuletzt die Zeilen des eigenen Bereichs, dazwischen warten alle
+ * Worker aufeinander.
+ * @param worker Nummer des Workers
+ * @param workerCount Anzahl der beteiligten Worker
+ * @param arg Auftrag (OceanJob)
+ */
+static void evaluateOceanJob(GLint worker, GLint workerCount, void *arg)
+{
+  OceanJob *job = (OceanJob *)arg;
+  GLint n = g_fftSize;
+  GLint firstRow = worker * n / workerCount;
+  GLint lastRow = (worker + 1) * n / workerCount;
+  //Spalten in Vielfachen der SIMD-Breite verteilen
+  GLint columns = (n / workerCount + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+  GLint firstColumn = MIN(worker * columns, n);
+  GLint lastColumn = (worker == workerCount - 1) ? n : MIN(firstColumn + columns, n);
+  GLint x, y;
+
+  buildSpectrum(job->time, firstRow, lastRow);
+  waitAtBarrier();
+
+  transformColumns(firstColumn, lastColumn);
+  waitAtBarrier();
+
+  for (y = firstRow; y < lastRow; y++)
+  {
+    transformRow(y);
+    if (y < job->side)
+    {
+      //das Spektrum ist hermitesch, der Imaginaerteil ist (bis auf Rundung) 0
+      for (x = 0; x < job->side; x++)
+      {
+        job->heights[y * job->stride + x] = g_re[y * n + x];
+      }
+    }
+  }
+}
+
+void evaluateOcean(double time, GLfloat *heights, GLint stride, GLint side)
+{
+  OceanJob job;
+  GLint workerCount = 0;
+
+  if (side != g_oceanSide)
+  {
+    initSpectrum(side);
+  }
+
+  job.time = time;
+  job.heights = heights;
+  job.stride = stride;
+  job.side = side;
+
+  workerCount = MIN(getWorkerCount(), g_fftSize / OCEAN_MIN_ROWS_PER_WORKER);
+  runOnWorkers(evaluateOceanJob, &job, workerCount < 1 ? 1 : workerCount);
+}
+
+void freeOcean(void)
+{
+  freeSpectrum();
+}
@@ -0,0 +1,35 @@
+#ifndef __OCEAN_H__
+#define __OCEAN_H__
+/**
+ * @file
+ * Schnittstelle des Ozean-Moduls.
+ * Das Modul berechnet ein Hoehenfeld nach dem spektralen Verfahren von
+ * Tessendorf: ein einmal erzeugtes Phillips-Spektrum wird fuer einen
+ * beliebigen Zeitpunkt t analytisch fortgeschrieben und per inverser FFT in
+ * O(n log n) in Hoehen umgerechnet. Anders als beim expliziten Verfahren gibt
+ * es keine Beschraenkung der Schrittweite, jeder Zeitpunkt kann direkt
+ * berechnet werden.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/**
+ * Berechnet das Hoehenfeld zum Zeitpunkt time. Das Spektrum wird beim ersten
+ * Aufruf und nach jeder Aenderung der Seitenlaenge neu erzeugt, bei gleicher
+ * Seitenlaenge ergibt sich immer dasselbe Meer.
+ * @param time Zeitpunkt in Sekunden
+ * @param heights Zielfeld, Zeile y beginnt bei heights[y * stride] (Out)
+ * @param stride Abstand zweier Zeilen im Zielfeld
+ * @param side Anzahl der Punkte pro Seite (Abstand 2 / (side - 1) wie beim Mesh)
+ */
+void evaluateOcean(double time, GLfloat *heights, GLint stride, GLint side);
+
+/**
+ * Gibt den Speicher des Spektrums und der FFT frei
+ */
+void freeOcean(void);
+
+#endif
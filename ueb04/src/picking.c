@@ -0,0 +1,351 @@
+/**
+ * @file
+ * Picking-Modul.
+ * Das Modul bestimmt Treffer eines Strahls von der Kamera durch den
+ * Mauszeiger mit den pickbaren Objekten der Szene vollstaendig auf der CPU.
+ * Anders als der Selektionsmodus von OpenGL muss dafuer nichts neu gezeichnet
+ * werden und es gibt keinen Puffer fester Groesse, der ueberlaufen kann.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <math.h>
+#include <float.h>
+
+/* ---- Eigene Header einbinden ---- */
+#include "picking.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+/** Rundet einen nicht negativen Wert auf das naechste Vielfache von step auf */
+#define ALIGN_UP(value, step) (((value) + (step) - 1) / (step) * (step))
+
+/** Erster Punkt ab v, der eine Kugel traegt (siehe NEXT_SPHERE_POINT) */
+#define FIRST_SPHERE_POINT(v, stride, side) MIN(ALIGN_UP(MAX((v), 0), (stride)), (side) - 1)
+
+/** Richtungskomponenten mit kleinerem Betrag gelten als parallel zur Achse */
+#define RAY_EPSILON (1e-8f)
+
+/**
+ * Normiert einen Vektor
+ * @param v zu normierender Vektor (In/Out)
+ * @return Laenge des Vektors vor dem Normieren
+ */
+static GLfloat normalize(CGVector3f v)
+{
+  GLfloat len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (len > 0.0f)
+  {
+    v[0] /= len;
+    v[1] /= len;
+    v[2] /= len;
+  }
+  return len;
+}
+
+void calcPickRay(const CGVector3f eye, GLfloat fovy, GLint x, GLint y,
+                 GLint width, GLint height, Ray *ray)
+{
+  GLfloat tanHalf = tanf(fovy * (GLfloat)M_PI / 360.0f);
+  GLfloat aspect = (GLfloat)width / (GLfloat)height;
+  //Mittelpunkt des Pixels in normierten Geraetekoordinaten
+  GLfloat ndcX = 2.0f * (x + 0.5f) / width - 1.0f;
+  GLfloat ndcY = 1.0f - 2.0f * (y + 0.5f) / height;
+  CGVector3f forward = {-eye[0], -eye[1], -eye[2]};
+  CGVector3f side;
+  CGVector3f up;
+  GLint i = 0;
+
+  //Kamerabasis wie bei gluLookAt (Zentrum im Ursprung, Up-Vektor y-Achse)
+  normalize(forward);
+  side[0] = -forward[2];
+  side[1] = 0.0f;
+  side[2] = forward[0];
+  if (normalize(side) == 0.0f)
+  {
+    side[0] = 1.0f;
+  }
+  up[0] = side[1] * forward[2] - side[2] * forward[1];
+  up[1] = side[2] * forward[0] - side[0] * forward[2];
+  up[2] = side[0] * forward[1] - side[1] * forward[0];
+
+  for (i = 0; i < 3; i++)
+  {
+    ray->origin[i] = eye[i];
+    ray->dir[i] = forward[i] + side[i] * ndcX * tanHalf * aspect + up[i] * ndcY * tanHalf;
+  }
+}
+
+/**
+ * Schraenkt das Parameterintervall eines Strahls auf den Bereich zwischen
+ * zwei zu einer Achse senkrechten Ebenen ein.
+ * @param origin Komponente des Ursprungs entlang der Achse
+ * @param dir Komponente der Richtung entlang der Achse
+ * @param lo untere Grenze des Bereichs
+ * @param hi obere Grenze des Bereichs
+ * @param tMin Beginn des Intervalls (In/Out)
+ * @param tMax Ende des Intervalls (In/Out)
+ * @return GL_FALSE, wenn das Intervall leer wird
+ */
+static GLboolean clipSlab(GLfloat origin, GLfloat dir, GLfloat lo, GLfloat hi,
+                          GLfloat *tMin, GLfloat *tMax)
+{
+  GLfloat t0, t1;
+
+  if (fabsf(dir) < RAY_EPSILON)
+  {
+    return (origin >= lo) && (origin <= hi);
+  }
+
+  t0 = (lo - origin) / dir;
+  t1 = (hi - origin) / dir;
+  *tMin = MAX(*tMin, MIN(t0, t1));
+  *tMax = MIN(*tMax, MAX(t0, t1));
+  return *tMin <= *tMax;
+}
+
+GLboolean intersectBox(const Ray *ray, const CGVector3f min, const CGVector3f max, GLfloat *t)
+{
+  GLfloat tMin = 0.0f;
+  GLfloat tMax = FLT_MAX;
+  GLint i = 0;
+
+  for (i = 0; i < 3; i++)
+  {
+    if (!clipSlab(ray->origin[i], ray->dir[i], min[i], max[i], &tMin, &tMax))
+    {
+      return GL_FALSE;
+    }
+  }
+  *t = tMin;
+  return GL_TRUE;
+}
+
+/**
+ * Schneidet den Strahl mit einem Dreieck (Moeller-Trumbore, beidseitig).
+ * @param ray Strahl
+ * @param a erster Eckpunkt
+ * @param b zweiter Eckpunkt
+ * @param c dritter Eckpunkt
+ * @param t Strahlparameter des Treffers (Out)
+ * @param u baryzentrische Koordinate bzgl. b (Out)
+ * @param v baryzentrische Koordinate bzgl. c (Out)
+ * @return GL_TRUE bei einem Treffer vor dem Ursprung
+ */
+static GLboolean intersectTriangle(const Ray *ray, const GLfloat *a, const GLfloat *b, const GLfloat *c,
+                                   GLfloat *t, GLfloat *u, GLfloat *v)
+{
+  CGVector3f e1 = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  CGVector3f e2 = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  CGVector3f p, q, s;
+  GLfloat det, invDet;
+
+  p[0] = ray->dir[1] * e2[2] - ray->dir[2] * e2[1];
+  p[1] = ray->dir[2] * e2[0] - ray->dir[0] * e2[2];
+  p[2] = ray->dir[0] * e2[1] - ray->dir[1] * e2[0];
+  det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+  if (fabsf(det) < RAY_EPSILON)
+  {
+    return GL_FALSE;
+  }
+  invDet = 1.0f / det;
+
+  s[0] = ray->origin[0] - a[0];
+  s[1] = ray->origin[1] - a[1];
+  s[2] = ray->origin[2] - a[2];
+  *u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+  if ((*u < 0.0f) || (*u > 1.0f))
+  {
+    return GL_FALSE;
+  }
+
+  q[0] = s[1] * e1[2] - s[2] * e1[1];
+  q[1] = s[2] * e1[0] - s[0] * e1[2];
+  q[2] = s[0] * e1[1] - s[1] * e1[0];
+  *v = (ray->dir[0] * q[0] + ray->dir[1] * q[1] + ray->dir[2] * q[2]) * invDet;
+  if ((*v < 0.0f) || (*u + *v > 1.0f))
+  {
+    return GL_FALSE;
+  }
+
+  *t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+  return *t >= 0.0f;
+}
+
+/**
+ * Schneidet den Strahl mit einer Kugel.
+ * @param ray Strahl
+ * @param center Mittelpunkt der Kugel
+ * @param radius Radius der Kugel
+ * @param t Strahlparameter des Eintrittspunktes (Out)
+ * @return GL_TRUE bei einem Treffer vor dem Ursprung
+ */
+static GLboolean intersectSphere(const Ray *ray, const GLfloat *center, GLfloat radius, GLfloat *t)
+{
+  CGVector3f oc = {ray->origin[0] - center[0], ray->origin[1] - center[1], ray->origin[2] - center[2]};
+  GLfloat a = ray->dir[0] * ray->dir[0] + ray->dir[1] * ray->dir[1] + ray->dir[2] * ray->dir[2];
+  //Parameter und Vektor des dem Mittelpunkt naechsten Strahlpunktes; so ausgewertet
+  //tritt keine Ausloeschung wie bei der Diskriminante b*b - a*c auf
+  GLfloat tClosest = -(oc[0] * ray->dir[0] + oc[1] * ray->dir[1] + oc[2] * ray->dir[2]) / a;
+  CGVector3f closest = {oc[0] + tClosest * ray->dir[0],
+                        oc[1] + tClosest * ray->dir[1],
+                        oc[2] + tClosest * ray->dir[2]};
+  GLfloat disc = radius * radius - (closest[0] * closest[0] + closest[1] * closest[1] + closest[2] * closest[2]);
+  GLfloat halfChord;
+
+  if (disc < 0.0f)
+  {
+    return GL_FALSE;
+  }
+  halfChord = sqrtf(disc / a);
+  *t = tClosest - halfChord;
+  if (*t < 0.0f)
+  {
+    //Ursprung innerhalb der Kugel
+    *t = tClosest + halfChord;
+  }
+  return *t >= 0.0f;
+}
+
+GLint intersectHeightfield(const Ray *ray, const Vertex *vertices, GLint side,
+                           GLfloat minHeight, GLfloat maxHeight, GLfloat sphereRadius, GLint sphereStride,
+                           GLfloat *t)
+{
+  GLfloat spacing = 2.0f / (side - 1);
+  //so viele Zellen weit reicht eine Kugel ueber ihren Punkt hinaus
+  GLint reach = (GLint)ceilf(sphereRadius / spacing);
+  GLint cellMin = -reach;
+  GLint cellMax = side - 2 + reach;
+
+  //Strahl in Gitterkoordinaten, eine Zelle hat dort die Breite 1
+  GLfloat ou = (ray->origin[0] + 1.0f) / spacing;
+  GLfloat ov = (ray->origin[2] + 1.0f) / spacing;
+  GLfloat du = ray->dir[0] / spacing;
+  GLfloat dv = ray->dir[2] / spacing;
+
+  GLfloat tStart = 0.0f;
+  GLfloat tEnd = FLT_MAX;
+  GLfloat bestT = FLT_MAX;
+  GLint best = -1;
+
+  GLint cu, cv, stepU, stepV;
+  GLfloat tMaxU, tMaxV, tDeltaU, tDeltaV;
+  GLfloat tEntry, tExit, yEntry, yExit, yLo, yHi;
+  GLfloat hitT, baryU, baryV;
+  GLint vx, vy, k, i;
+  GLfloat h0, h1, h2, h3, h;
+
+  //nur der Hoehenbereich des Feldes (inkl. Kugeln) und die Flaeche des Gitters sind relevant
+  if (!clipSlab(ray->origin[1], ray->dir[1], minHeight - sphereRadius, maxHeight + sphereRadius, &tStart, &tEnd) ||
+      !clipSlab(ou, du, (GLfloat)cellMin, (GLfloat)(cellMax + 1), &tStart, &tEnd) ||
+      !clipSlab(ov, dv, (GLfloat)cellMin, (GLfloat)(cellMax + 1), &tStart, &tEnd))
+  {
+    return -1;
+  }
+
+  //Startzelle und Parameter der DDA (Amanatides & Woo)
+  cu = MIN(MAX((GLint)floorf(ou + tStart * du), cellMin), cellMax);
+  cv = MIN(MAX((GLint)floorf(ov + tStart * dv), cellMin), cellMax);
+  stepU = (du > 0.0f) ? 1 : -1;
+  stepV = (dv > 0.0f) ? 1 : -1;
+  tDeltaU = (fabsf(du) < RAY_EPSILON) ? FLT_MAX : fabsf(1.0f / du);
+  tDeltaV = (fabsf(dv) < RAY_EPSILON) ? FLT_MAX : fabsf(1.0f / dv);
+  tMaxU = (fabsf(du) < RAY_EPSILON) ? FLT_MAX : ((cu + (du > 0.0f ? 1 : 0)) - ou) / du;
+  tMaxV = (fabsf(dv) < RAY_EPSILON) ? FLT_MAX : ((cv + (dv > 0.0f ? 1 : 0)) - ov) / dv;
+
+  //Zellen in Reihenfolge entlang des Strahls, bis ein Treffer vor der naechsten Zelle liegt
+  tEntry = tStart;
+  while ((tEntry <= tEnd) && (tEntry <= bestT))
+  {
+    tExit = MIN(MIN(tMaxU, tMaxV), tEnd);
+    yEntry = ray->origin[1] + tEntry * ray->dir[1];
+    yExit = ray->origin[1] + tExit * ray->dir[1];
+    yLo = MIN(yEntry, yExit);
+    yHi = MAX(yEntry, yExit);
+
+    //die beiden Dreiecke der Zelle wie in der Index-Reihenfolge des Mesh
+    if ((cu >= 0) && (cu <= side - 2) && (cv >= 0) && (cv <= side - 2))
+    {
+      i = cv * side + cu;
+      h0 = vertices[i].position[CY];
+      h1 = vertices[i + 1].position[CY];
+      h2 = vertices[i + side].position[CY];
+      h3 = vertices[i + side + 1].position[CY];
+      if ((MAX(MAX(h0, h1), MAX(h2, h3)) >= yLo) && (MIN(MIN(h0, h1), MIN(h2, h3)) <= yHi))
+      {
+        if (intersectTriangle(ray, vertices[i].position, vertices[i + side].position, vertices[i + 1].position,
+                              &hitT, &baryU, &baryV) &&
+            (hitT < bestT))
+        {
+          bestT = hitT;
+          //naechster Eckpunkt ist der mit dem groessten Gewicht
+          best = (baryU > baryV) ? ((baryU > 1.0f - baryU - baryV) ? i + side : i)
+                                 : ((baryV > 1.0f - baryU - baryV) ? i + 1 : i);
+        }
+        if (intersectTriangle(ray, vertices[i + 1].position, vertices[i + side].position, vertices[i + side + 1].position,
+                              &hitT, &baryU, &baryV) &&
+            (hitT < bestT))
+        {
+          bestT = hitT;
+          best = (baryU > baryV) ? ((baryU > 1.0f - baryU - baryV) ? i + side : i + 1)
+                                 : ((baryV > 1.0f - baryU - baryV) ? i + side + 1 : i + 1);
+        }
+      }
+    }
+
+    //Kugeln aller Punkte mit Kugel, die in diese Zelle hineinreichen
+    if (sphereRadius > 0.0f)
+    {
+      for (vy = FIRST_SPHERE_POINT(cv - reach, sphereStride, side); vy <= MIN(cv + 1 + reach, side - 1);
+           vy = NEXT_SPHERE_POINT(vy, sphereStride, side))
+      {
+        for (vx = FIRST_SPHERE_POINT(cu - reach, sphereStride, side); vx <= MIN(cu + 1 + reach, side - 1);
+             vx = NEXT_SPHERE_POINT(vx, sphereStride, side))
+        {
+          k = vy * side + vx;
+          h = vertices[k].position[CY];
+          if ((h + sphereRadius >= yLo) && (h - sphereRadius <= yHi) &&
+              intersectSphere(ray, vertices[k].position, sphereRadius, &hitT) && (hitT < bestT))
+          {
+            bestT = hitT;
+            best = k;
+          }
+        }
+      }
+    }
+
+    //in die naechste Zelle wechseln
+    if (tMaxU < tMaxV)
+    {
+      cu += stepU;
+      tEntry = tMaxU;
+      tMaxU += tDeltaU;
+    }
+    else
+    {
+      cv += stepV;
+      tEntry = tMaxV;
+      tMaxV += tDeltaV;
+    }
+    if ((cu < cellMin) || (cu > cellMax) || (cv < cellMin) || (cv > cellMax))
+    {
+      break;
+    }
+  }
+
+  if (best >= 0)
+  {
+    *t = bestT;
+  }
+  return best;
+}
@@ -0,0 +1,67 @@
+#ifndef __PICKING_H__
+#define __PICKING_H__
+/**
+ * @file
+ * Schnittstelle des Picking-Moduls.
+ * Das Modul bestimmt Treffer eines Strahls von der Kamera durch den
+ * Mauszeiger mit den pickbaren Objekten der Szene vollstaendig auf der CPU:
+ * dem Hoehenfeld des Wassers (Gitter-DDA), den Kugeln an dessen Punkten und
+ * achsenparallelen Quadern (z.B. der Boote).
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/** Strahl mit Ursprung und (nicht normierter) Richtung */
+typedef struct
+{
+  CGVector3f origin;
+  CGVector3f dir;
+} Ray;
+
+/**
+ * Bestimmt den Strahl vom Augpunkt durch ein Pixel des Fensters. Die Kamera
+ * blickt wie bei gluLookAt auf den Ursprung, der Up-Vektor ist die y-Achse.
+ * @param eye Augpunkt der Kamera
+ * @param fovy Oeffnungswinkel der Projektion in Grad
+ * @param x x-Koordinate des Pixels (von links)
+ * @param y y-Koordinate des Pixels (von oben)
+ * @param width Breite des Fensters
+ * @param height Hoehe des Fensters
+ * @param ray Ergebnis (Out)
+ */
+void calcPickRay(const CGVector3f eye, GLfloat fovy, GLint x, GLint y,
+                 GLint width, GLint height, Ray *ray);
+
+/**
+ * Schneidet den Strahl mit einem achsenparallelen Quader (Slab-Test).
+ * @param ray Strahl
+ * @param min minimale Ecke des Quaders
+ * @param max maximale Ecke des Quaders
+ * @param t Strahlparameter des Eintrittspunktes (Out), nur bei Treffer gesetzt
+ * @return GL_TRUE, wenn der Quader vor dem Ursprung getroffen wird
+ */
+GLboolean intersectBox(const Ray *ray, const CGVector3f min, const CGVector3f max, GLfloat *t);
+
+/**
+ * Schneidet den Strahl mit dem Hoehenfeld des Wassers und den Kugeln an
+ * dessen Punkten. Traversiert werden per DDA nur die Zellen, die der Strahl
+ * innerhalb des Hoehenbereichs des Feldes durchlaeuft, und nur bis zum ersten
+ * Treffer, der Aufwand haengt daher nicht von der Groesse des Gitters ab.
+ * @param ray Strahl
+ * @param vertices Vertizes des Gitters ueber [-1, 1] x [-1, 1], zeilenweise
+ * @param side Anzahl der Punkte pro Seite
+ * @param minHeight minimale Hoehe im Feld
+ * @param maxHeight maximale Hoehe im Feld
+ * @param sphereRadius Radius der Kugeln, bei 0 wird nur das Hoehenfeld getroffen
+ * @param sphereStride nur jeder sphereStride-te Punkt pro Zeile und Spalte (und der letzte) traegt eine Kugel
+ * @param t Strahlparameter des Treffers (Out), nur bei Treffer gesetzt
+ * @return Index des getroffenen bzw. dem Treffer naechsten Punktes, -1 wenn kein Treffer
+ */
+GLint intersectHeightfield(const Ray *ray, const Vertex *vertices, GLint side,
+                           GLfloat minHeight, GLfloat maxHeight, GLfloat sphereRadius, GLint sphereStride,
+                           GLfloat *t);
+
+#endif
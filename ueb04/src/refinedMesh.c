@@ -0,0 +1,381 @@
+/**
+ * @file
+ * Modul fuer das Netz der verfeinerten Kacheln.
+ * Jede verfeinerte Kachel wird mit einem Netz mit halbem Punktabstand
+ * gezeichnet. Ein Punkt des feinen Netzes liegt zwischen vier feinen Zellen
+ * der Patches und erhaelt deren Mittelwert. Beruehrt er ein Viereck, das
+ * grob gezeichnet wird, oder liegt eine der vier Zellen in einer
+ * unverfeinerten Kachel, wird er stattdessen bilinear aus dem groben Gitter
+ * bestimmt: auf einer Kante zur groben Stufe liegt er dann genau auf deren
+ * Geraden, zwischen den Stufen entstehen keine Risse. Die Normalen werden aus
+ * den benachbarten Punkten des feinen Netzes bestimmt, am Rand wie beim
+ * groben Netz mit dem Punkt selbst als Nachbarn.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <stdlib.h>
+#include <math.h>
+
+/* ---- Eigene Header einbinden ---- */
+#include "refinedMesh.h"
+
+#ifndef MIN
+/** Minimum zweier Zahlen */
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+/** Maximum zweier Zahlen */
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+/** Offset in Byte innerhalb eines gebundenen Pufferobjekts */
+#define BUFFER_OFFSET(bytes) ((const GLvoid *)(bytes))
+
+/** Anzahl der Punkte pro Seite und Kantenlaenge einer Kachel in Punkten */
+static GLint g_side = 0;
+static GLint g_tileSize = 0;
+
+/** Anzahl der Kacheln pro Seite (wie in der Logik nach Punkten gezaehlt) */
+static GLint g_tilesSide = 0;
+
+/** je Kachel: Index des Patches in der Liste der letzten Aufteilung oder -1 */
+static GLint *g_tilePatch = NULL;
+
+/** je Patch: Index seines ersten Punktes in g_mesh.vertices */
+static GLint *g_patchFirstVertex = NULL;
+
+/** Hoehen der Punkte einer Kachel des feinen Netzes samt einem Punkt Rand */
+static GLfloat *g_nodeHeights = NULL;
+
+/** zuletzt aufgebautes Netz */
+static RefinedMesh g_mesh;
+
+/**
+ * Liefert die Anzahl der Vierecke einer Kachel in einer Richtung. Die
+ * letzte Kachel kann schmaler sein oder (nur eine Spalte Punkte) keine haben.
+ * @param tile Spalte bzw. Zeile der Kachel
+ * @return Anzahl der Vierecke
+ */
+static GLint getTileQuads(GLint tile)
+{
+  return MAX(MIN(g_tileSize, g_side - 1 - tile * g_tileSize), 0);
+}
+
+/**
+ * Liefert den Index des ersten Dreiecks einer Kachel im kachelweise
+ * gefuellten groben Index-Puffer: davor liegen alle Zeilen von Kacheln
+ * darueber und in der eigenen Zeile die Kacheln links davon
+ * @param tx Spalte der Kachel
+ * @param ty Zeile der Kachel
+ * @return Index des ersten Eintrags der Kachel
+ */
+static GLint getTileFirstIndex(GLint tx, GLint ty)
+{
+  return 6 * (ty * g_tileSize * (g_side - 1) + getTileQuads(ty) * tx * g_tileSize);
+}
+
+/**
+ * Schreibt die beiden Dreiecke eines Vierecks
+ * @param indices Ziel der sechs Indizes
+ * @param i Index des Punktes oben links
+ * @param rowLength Anzahl der Punkte pro Zeile
+ */
+static void fillQuad(GLuint *indices, GLuint i, GLuint rowLength)
+{
+  indices[0] = i;
+  indices[1] = i + rowLength;
+  indices[2] = i + 1;
+  indices[3] = i + 1;
+  indices[4] = i + rowLength;
+  indices[5] = i + rowLength + 1;
+}
+
+void fillTiledIndexArray(GLuint *indices, GLint side)
+{
+  GLint quadTiles = 0;
+  GLint tx, ty, x, y;
+
+  g_side = side;
+  g_tileSize = getRefinedTileSize();
+  quadTiles = (side - 1 + g_tileSize - 1) / g_tileSize;
+  for (ty = 0; ty < quadTiles; ty++)
+  {
+    for (tx = 0; tx < quadTiles; tx++)
+    {
+      for (y = ty * g_tileSize; y < ty * g_tileSize + getTileQuads(ty); y++)
+      {
+        for (x = tx * g_tileSize; x < tx * g_tileSize + getTileQuads(tx); x++, indices += 6)
+        {
+          fillQuad(indices, y * side + x, side);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Wird das Viereck (qx, qy) grob gezeichnet? Vierecke ausserhalb des Netzes
+ * zaehlen nicht.
+ * @param qx Spalte des Vierecks
+ * @param qy Zeile des Vierecks
+ * @return GL_TRUE, wenn das Viereck existiert und in einer unverfeinerten Kachel liegt
+ */
+static GLboolean isCoarseQuad(GLint qx, GLint qy)
+{
+  return (qx >= 0) && (qx < g_side - 1) && (qy >= 0) && (qy < g_side - 1) &&
+         (g_tilePatch[(qy / g_tileSize) * g_tilesSide + qx / g_tileSize] < 0);
+}
+
+/**
+ * Liefert die Hoehe eines Punktes des feinen Netzes
+ * @param heights Hoehenfeld der Logik
+ * @param stride Abstand zweier Zeilen im Hoehenfeld
+ * @param patches verfeinerte Kacheln
+ * @param u Spalte des Punktes in halben Punktabstaenden (0 bis 2 * (side - 1))
+ * @param w Zeile des Punktes in halben Punktabstaenden
+ * @return Hoehe des Punktes
+ */
+static GLfloat getNodeHeight(const GLfloat *heights, GLint stride, const RefinedPatch *patches, GLint u, GLint w)
+{
+  //Saeulen, deren feine Zellen (u, u + 1) bzw. (w, w + 1) um den Punkt liegen
+  GLint x0 = u / 2;
+  GLint x1 = (u + 1) / 2;
+  GLint y0 = w / 2;
+  GLint y1 = (w + 1) / 2;
+  GLboolean coarse = GL_FALSE;
+  const RefinedPatch *patch = NULL;
+  GLfloat sum = 0.0f;
+  GLint i, j, gx, gy;
+
+  //grob gezeichnete Vierecke am Punkt (auf einer Kante zwei, sonst eines je Richtung)
+  for (j = (w % 2 == 0) ? y0 - 1 : y0; j <= y0; j++)
+  {
+    for (i = (u % 2 == 0) ? x0 - 1 : x0; i <= x0; i++)
+    {
+      coarse = coarse || isCoarseQuad(i, j);
+    }
+  }
+  coarse = coarse || (g_tilePatch[(y0 / g_tileSize) * g_tilesSide + x0 / g_tileSize] < 0) ||
+           (g_tilePatch[(y0 / g_tileSize) * g_tilesSide + x1 / g_tileSize] < 0) ||
+           (g_tilePatch[(y1 / g_tileSize) * g_tilesSide + x0 / g_tileSize] < 0) ||
+           (g_tilePatch[(y1 / g_tileSize) * g_tilesSide + x1 / g_tileSize] < 0);
+
+  if (coarse)
+  {
+    return 0.25f * ((heights[y0 * stride + x0] + heights[y0 * stride + x1]) +
+                    (heights[y1 * stride + x0] + heights[y1 * stride + x1]));
+  }
+
+  for (gy = w; gy <= w + 1; gy++)
+  {
+    for (gx = u; gx <= u + 1; gx++)
+    {
+      patch = &patches[g_tilePatch[(gy / 2 / g_tileSize) * g_tilesSide + gx / 2 / g_tileSize]];
+      sum += patch->heights[(gy - 2 * patch->tileY * g_tileSize) * patch->stride +
+                            gx - 2 * patch->tileX * g_tileSize];
+    }
+  }
+  return 0.25f * sum;
+}
+
+void layoutRefinedMesh(GLint side, const RefinedPatch *patches, GLint count)
+{
+  GLint quadTiles = 0;
+  GLint vertexCount = 0;
+  GLint indexCount = 0;
+  GLint runCount = 0;
+  GLint runEnd = -1;
+  GLint p, tx, ty, qw, qh, x, y, first;
+  GLuint *indices = NULL;
+  GLfloat *texCoords = NULL;
+
+  g_side = side;
+  g_tileSize = getRefinedTileSize();
+  g_tilesSide = (side + g_tileSize - 1) / g_tileSize;
+  quadTiles = (side - 1 + g_tileSize - 1) / g_tileSize;
+
+  g_tilePatch = realloc(g_tilePatch, sizeof(GLint) * SQUARE(g_tilesSide));
+  g_patchFirstVertex = realloc(g_patchFirstVertex, sizeof(GLint) * MAX(count, 1));
+  g_nodeHeights = realloc(g_nodeHeights, sizeof(GLfloat) * SQUARE(2 * g_tileSize + 3));
+  g_mesh.runCounts = realloc(g_mesh.runCounts, sizeof(GLsizei) * MAX(SQUARE(quadTiles), 1));
+  g_mesh.runOffsets = realloc(g_mesh.runOffsets, sizeof(GLvoid *) * MAX(SQUARE(quadTiles), 1));
+  if ((g_tilePatch == NULL) || (g_patchFirstVertex == NULL) || (g_nodeHeights == NULL) ||
+      (g_mesh.runCounts == NULL) || (g_mesh.runOffsets == NULL))
+  {
+    exit(1);
+  }
+  for (p = 0; p < SQUARE(g_tilesSide); p++)
+  {
+    g_tilePatch[p] = -1;
+  }
+
+  //Groesse der feinen Netze
+  for (p = 0; p < count; p++)
+  {
+    g_tilePatch[patches[p].tileY * g_tilesSide + patches[p].tileX] = p;
+    g_patchFirstVertex[p] = vertexCount;
+    qw = getTileQuads(patches[p].tileX);
+    qh = getTileQuads(patches[p].tileY);
+    if ((qw > 0) && (qh > 0))
+    {
+      vertexCount += (2 * qw + 1) * (2 * qh + 1);
+      indexCount += 6 * 4 * qw * qh;
+    }
+  }
+
+  g_mesh.vertices = realloc(g_mesh.vertices, sizeof(Vertex) * MAX(vertexCount, 1));
+  g_mesh.texCoords = realloc(g_mesh.texCoords, sizeof(GLfloat) * 2 * MAX(vertexCount, 1));
+  g_mesh.indices = realloc(g_mesh.indices, sizeof(GLuint) * MAX(indexCount, 1));
+  if ((g_mesh.vertices == NULL) || (g_mesh.texCoords == NULL) || (g_mesh.indices == NULL))
+  {
+    exit(1);
+  }
+  g_mesh.vertexCount = vertexCount;
+  g_mesh.indexCount = indexCount;
+
+  //Punkte und Dreiecke der feinen Netze, Kachel fuer Kachel
+  indices = g_mesh.indices;
+  for (p = 0; p < count; p++)
+  {
+    qw = getTileQuads(patches[p].tileX);
+    qh = getTileQuads(patches[p].tileY);
+    if ((qw == 0) || (qh == 0))
+    {
+      continue;
+    }
+    first = g_patchFirstVertex[p];
+    texCoords = g_mesh.texCoords + 2 * first;
+    for (y = 0; y <= 2 * qh; y++)
+    {
+      for (x = 0; x <= 2 * qw; x++, texCoords += 2)
+      {
+        g_mesh.vertices[first + y * (2 * qw + 1) + x].position[CX] =
+            -1.0f + (GLfloat)(2 * patches[p].tileX * g_tileSize + x) / (side - 1);
+        g_mesh.vertices[first + y * (2 * qw + 1) + x].position[CZ] =
+            -1.0f + (GLfloat)(2 * patches[p].tileY * g_tileSize + y) / (side - 1);
+        g_mesh.vertices[first + y * (2 * qw + 1) + x].normal[3] = 0;
+        texCoords[0] = 0.5f * (2 * patches[p].tileX * g_tileSize + x) / (side - 1);
+        texCoords[1] = 0.5f * (2 * patches[p].tileY * g_tileSize + y) / (side - 1);
+        if ((x < 2 * qw) && (y < 2 * qh))
+        {
+          fillQuad(indices, first + y * (2 * qw + 1) + x, 2 * qw + 1);
+          indices += 6;
+        }
+      }
+    }
+  }
+
+  //zusammenhaengende Abschnitte unverfeinerter Kacheln im groben Index-Puffer
+  for (ty = 0; ty < quadTiles; ty++)
+  {
+    for (tx = 0; tx < quadTiles; tx++)
+    {
+      if (g_tilePatch[ty * g_tilesSide + tx] < 0)
+      {
+        first = getTileFirstIndex(tx, ty);
+        if (first == runEnd)
+        {
+          g_mesh.runCounts[runCount - 1] += 6 * getTileQuads(tx) * getTileQuads(ty);
+        }
+        else
+        {
+          g_mesh.runOffsets[runCount] = BUFFER_OFFSET(sizeof(GLuint) * first);
+          g_mesh.runCounts[runCount++] = 6 * getTileQuads(tx) * getTileQuads(ty);
+        }
+        runEnd = first + 6 * getTileQuads(tx) * getTileQuads(ty);
+      }
+    }
+  }
+  g_mesh.runCount = runCount;
+}
+
+void updateRefinedMesh(const GLfloat *heights, GLint stride, const RefinedPatch *patches)
+{
+  GLint rowLength = 2 * g_tileSize + 3;
+  GLint lastNode = 2 * (g_side - 1);
+  GLfloat spacing = 1.0f / (g_side - 1);
+  GLint p, qw, qh, x, y, u, w;
+  GLfloat spanX, spanZ, slopeX, slopeZ, invLen;
+  GLfloat normal[3];
+  const GLfloat *h = NULL;
+  Vertex *vertex = NULL;
+
+  for (p = 0; p < SQUARE(g_tilesSide); p++)
+  {
+    if (g_tilePatch[p] < 0)
+    {
+      continue;
+    }
+    qw = getTileQuads(p % g_tilesSide);
+    qh = getTileQuads(p / g_tilesSide);
+    if ((qw == 0) || (qh == 0))
+    {
+      continue;
+    }
+
+    //Hoehen der Punkte samt einem Punkt Rand, am Rand des Netzes wiederholt
+    for (y = -1; y <= 2 * qh + 1; y++)
+    {
+      w = MIN(MAX(2 * (p / g_tilesSide) * g_tileSize + y, 0), lastNode);
+      for (x = -1; x <= 2 * qw + 1; x++)
+      {
+        u = MIN(MAX(2 * (p % g_tilesSide) * g_tileSize + x, 0), lastNode);
+        g_nodeHeights[(y + 1) * rowLength + x + 1] = getNodeHeight(heights, stride, patches, u, w);
+      }
+    }
+
+    vertex = g_mesh.vertices + g_patchFirstVertex[g_tilePatch[p]];
+    for (y = 0; y <= 2 * qh; y++)
+    {
+      w = 2 * (p / g_tilesSide) * g_tileSize + y;
+      //am Rand liegt ein Nachbar auf dem Punkt selbst, der Abstand halbiert sich
+      spanZ = ((w == 0) || (w == lastNode)) ? spacing : 2.0f * spacing;
+      h = g_nodeHeights + (y + 1) * rowLength + 1;
+      for (x = 0; x <= 2 * qw; x++, vertex++)
+      {
+        u = 2 * (p % g_tilesSide) * g_tileSize + x;
+        spanX = ((u == 0) || (u == lastNode)) ? spacing : 2.0f * spacing;
+        slopeX = h[x + 1] - h[x - 1];
+        slopeZ = h[x - rowLength] - h[x + rowLength];
+
+        //Kreuzprodukt von (spanX, slopeX, 0) und (0, slopeZ, -spanZ) wie beim groben Netz
+        normal[0] = -slopeX * spanZ;
+        normal[1] = spanX * spanZ;
+        normal[2] = spanX * slopeZ;
+        invLen = NORMAL_SCALE / sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        vertex->position[CY] = h[x];
+        vertex->normal[0] = (GLbyte)lrintf(normal[0] * invLen);
+        vertex->normal[1] = (GLbyte)lrintf(normal[1] * invLen);
+        vertex->normal[2] = (GLbyte)lrintf(normal[2] * invLen);
+      }
+    }
+  }
+}
+
+const RefinedMesh *getRefinedMesh(void)
+{
+  return &g_mesh;
+}
+
+void freeRefinedMesh(void)
+{
+  free(g_tilePatch);
+  free(g_patchFirstVertex);
+  free(g_nodeHeights);
+  free(g_mesh.vertices);
+  free(g_mesh.texCoords);
+  free(g_mesh.indices);
+  free(g_mesh.runCounts);
+  free(g_mesh.runOffsets);
+  g_tilePatch = NULL;
+  g_patchFirstVertex = NULL;
+  g_nodeHeights = NULL;
+  g_mesh.vertices = NULL;
+  g_mesh.texCoords = NULL;
+  g_mesh.indices = NULL;
+  g_mesh.runCounts = NULL;
+  g_mesh.runOffsets = NULL;
+}
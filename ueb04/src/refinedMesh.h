@@ -0,0 +1,79 @@
+#ifndef __REFINED_MESH_H__
+#define __REFINED_MESH_H__
+/**
+ * @file
+ * Schnittstelle des Moduls fuer das Netz der verfeinerten Kacheln.
+ * Das Modul zerlegt das Netz der Wasseroberflaeche in die Kacheln, die die
+ * Simulation verfeinern kann: unverfeinerte Kacheln werden mit dem groben
+ * Index-Puffer gezeichnet, verfeinerte mit einem eigenen Netz mit halbem
+ * Punktabstand aus den Hoehen der Patches (siehe getRefinedPatches). An den
+ * Grenzen zwischen den Stufen liegen alle Punkte des feinen Netzes auf den
+ * Kanten des groben, es entstehen keine Risse.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+#include "logic.h"
+
+/**
+ * Netz der verfeinerten Kacheln und die Abschnitte des groben Netzes, die
+ * noch gezeichnet werden. Alle Zeiger bleiben bis zum naechsten Aufruf von
+ * layoutRefinedMesh gueltig.
+ */
+typedef struct
+{
+  /** Punkte der feinen Netze, Position und Normale setzt updateRefinedMesh, die Farbe der Aufrufer */
+  Vertex *vertices;
+  GLint vertexCount;
+  /** Texturkoordinaten der Punkte (je zwei) */
+  GLfloat *texCoords;
+  /** Dreiecke der feinen Netze, von oben gesehen gegen den Uhrzeigersinn */
+  GLuint *indices;
+  GLint indexCount;
+  /** Anzahl der Indizes und Offset in Byte je Abschnitt des groben Index-Puffers (fuer glMultiDrawElements) */
+  GLsizei *runCounts;
+  const GLvoid **runOffsets;
+  GLint runCount;
+} RefinedMesh;
+
+/**
+ * Fuellt den Index-Puffer des groben Netzes kachelweise: die Dreiecke jeder
+ * Kachel liegen zusammenhaengend, die Kacheln zeilenweise hintereinander.
+ * Gezeichnet ergibt der ganze Puffer dasselbe Netz wie zeilenweise.
+ * @param indices zu fuellendes Index-Array mit 6 * (side - 1)^2 Eintraegen
+ * @param side Anzahl der Punkte pro Seite
+ */
+void fillTiledIndexArray(GLuint *indices, GLint side);
+
+/**
+ * Baut Indizes, Texturkoordinaten und die Abschnitte des groben Netzes fuer
+ * eine neue Aufteilung in verfeinerte Kacheln auf
+ * @param side Anzahl der Punkte pro Seite
+ * @param patches verfeinerte Kacheln
+ * @param count Anzahl der verfeinerten Kacheln
+ */
+void layoutRefinedMesh(GLint side, const RefinedPatch *patches, GLint count);
+
+/**
+ * Setzt Positionen und Normalen der feinen Netze. Die Patches muessen in
+ * derselben Reihenfolge vorliegen wie beim letzten layoutRefinedMesh.
+ * @param heights Hoehe des ersten Punktes im Hoehenfeld der Logik (mit Geisterrand)
+ * @param stride Abstand zweier Zeilen im Hoehenfeld
+ * @param patches verfeinerte Kacheln
+ */
+void updateRefinedMesh(const GLfloat *heights, GLint stride, const RefinedPatch *patches);
+
+/**
+ * Liefert das zuletzt aufgebaute Netz
+ * @return Netz der verfeinerten Kacheln
+ */
+const RefinedMesh *getRefinedMesh(void);
+
+/**
+ * Gibt die Puffer des Moduls frei
+ */
+void freeRefinedMesh(void);
+
+#endif
@@ -14,6 +14,9 @@
 #include <windows.h>
 #endif
 
+/* GLEW muss vor allen anderen OpenGL-Headern eingebunden werden */
+#include <GL/glew.h>
+
 #ifdef __APPLE__
 #include <OpenGL/gl.h>
 #include <GLUT/glut.h>
@@ -29,8 +32,12 @@
 #include "logic.h"
 #include "texture.h"
 #include "sceneObjects.h"
+#include "picking.h"
+#include "refinedMesh.h"
 #include <math.h>
 #include <float.h>
+#include <stddef.h>
+#include <string.h>
 
 /**Kameraposition im KugelKoordinatensystem */
 static GLfloat cameraRadiussph = 0.0f;
@@ -40,7 +47,40 @@ static GLfloat cameraPhiSph = 0.0f;
 static GLint g_amountVerticesSide;
 static Vertex *g_vertices;
 
-static GLuint *g_indices;
+/** minimale und maximale Hoehe im Vertex-Array, begrenzen den Suchbereich beim Picking */
+static GLfloat g_minHeight = 0.0f;
+static GLfloat g_maxHeight = 0.0f;
+
+/** Pufferobjekt der Indizes, wird nur bei Aenderung der Aufloesung befuellt */
+static GLuint g_indexBuffer = 0;
+
+/** Pufferobjekt der Texturkoordinaten, wird nur bei Aenderung der Aufloesung befuellt */
+static GLuint g_texCoordBuffer = 0;
+
+/** Pufferobjekt der Vertizes, wird nach jeder Aenderung der Simulation neu hochgeladen */
+static GLuint g_vertexBuffer = 0;
+
+/**
+ * Pufferobjekte des Netzes der verfeinerten Kacheln: die Vertizes werden nach
+ * jeder Aenderung der Simulation hochgeladen, Indizes und Texturkoordinaten
+ * nur bei einer neuen Aufteilung in Kacheln
+ */
+static GLuint g_refinedVertexBuffer = 0;
+static GLuint g_refinedTexCoordBuffer = 0;
+static GLuint g_refinedIndexBuffer = 0;
+
+/** Anzahl der verfeinerten Kacheln und Stand der Aufteilung, fuer die das Netz aufgebaut ist */
+static GLint g_refinedCount = 0;
+static GLuint g_refinedLayout = 0;
+static GLboolean g_refinedLayoutValid = GL_FALSE;
+
+/** Linien der angezeigten Normalen (je zwei Punkte mit x, y, z), deren Anzahl (0 solange nicht aufgebaut) und ihr Pufferobjekt */
+static GLfloat *g_normalLines = NULL;
+static GLint g_normalLineCount = 0;
+static GLuint g_normalLineBuffer = 0;
+
+/** Sind die Kugeln fuer den aktuellen Stand der Simulation abgelegt? */
+static GLboolean g_spheresBuilt = GL_FALSE;
 
 #define M_PI 3.141592654
 
@@ -53,6 +93,24 @@ static GLuint *g_indices;
 #define CAMERA_DEFAULT_THETA M_PI_4
 #define CAMERA_DEFAULT_PHI M_PI_2
 
+/** Hoechstens so viele Normalen pro Seite werden angezeigt, bei feinerem Mesh nur die jedes n-ten Punktes */
+#define NORMAL_LINES_PER_SIDE (128)
+
+/** Laenge der angezeigten Normalen */
+#define NORMAL_LINE_LENGTH (0.1f)
+
+/** Bis zu so vielen Punkten pro Seite traegt jeder Punkt eine Kugel, bei feinerem Mesh nur jeder n-te und der letzte */
+#define SPHERES_PER_SIDE (128)
+
+/** Skalierung der Kugeln an den Punkten des Mesh (Radius 0.5) */
+#define SPHERE_SCALE (1.0f / 20)
+
+/** achsenparalleler Quader um ein Boot relativ zu dessen Position */
+#define BOAT_BOUNDS_BACK (0.3f)
+#define BOAT_BOUNDS_FRONT (0.175f)
+#define BOAT_BOUNDS_HALF_WIDTH (0.125f)
+#define BOAT_BOUNDS_HEIGHT (0.225f)
+
 #define LOWER_BORDER (0.3f)
 #define UPPER_BORDER (0.65f)
 
@@ -63,21 +121,16 @@ static GLuint *g_indices;
 #define RAD2DEG(x) ((x) / M_PI * 180.0f)
 #endif
 
-#define LIGHTHOUSE_HEIGHT (0.75f)
-#define LIGHTHOUSE_RADIUS (0.15f)
-
-CGVector3f g_boats[2] = {{BOAT_1_X, 0.0f, BOAT_1_Z}, {BOAT_2_X, 0.0f, BOAT_2_Z}};
+CGVector3f g_boats[AMOUNT_BOATS] = {{BOAT_1_X, 0.0f, BOAT_1_Z}, {BOAT_2_X, 0.0f, BOAT_2_Z}};
 
 /* Umschalten einiger Funktionen */
 GLboolean showHelp = GL_FALSE;
 GLboolean showSpheres = GL_TRUE;
 
-/* Konstanten fuer Farben */
-static const CGColor3f LOW_DARK_BLUE = {0.07f, 0.07f, 0.44f};
-static const CGColor3f MEDIUM_GREEN = {0.0f, 1.0f, 0.0f};
-static const CGColor3f HIGH_RED = {1.0f, 0.0f, 0.0f};
-static const CGColor3f COLOR_RED = {1.0f, 0.0f, 0.0f};
-static const CGColor3f COLOR_WHITE = {1.0f, 1.0f, 1.0f};
+/* Konstanten fuer Farben, die Farben des Wassers gepackt als RGBA8 */
+static const GLubyte LOW_DARK_BLUE[4] = {18, 18, 112, 255};
+static const GLubyte MEDIUM_GREEN[4] = {0, 255, 0, 255};
+static const GLubyte HIGH_RED[4] = {255, 0, 0, 255};
 
 /**
 * Gibt den Hilfetext aus.
@@ -90,20 +143,20 @@ static void drawHelp()
   GLfloat color[3] = {1.0f, 0.2f, 0.8f};
 
   char *help[] = {"Hilfe",
-                  "F1 - Wireframe an/aus",
+                  "F1 - Wireframe an/aus, a/A - adaptives Gitter an/aus",
                   "F2 - Normalen an/aus",
                   "F3 - Beleuchtungsberechnung an/aus",
                   "F4 - Punktlichtquelle an/aus",
                   "F5 - Spotlight an/aus",
                   "F6 - Picken Kugeln/Boote umschalten",
-                  "F12 - Vollbildmodus an/aus",
+                  "F7/F8 - Zustand sichern/laden, F12 - Vollbild an/aus",
                   "u,U/o,O - rein-/rauszoomen der Kamera",
                   "i,I/j,J/k,K/l,L - Bewegen der Kamera ",
                   "h/H - Hilfe an/aus",
-                  "+/- - Anzahl der Punkt im Mesh vergößern/verringern",
-                  "t/T - Texturierung an/aus",
-                  "s/S - Anzeige der Kugeln an/aus",
-                  "p/P - Simulation pausieren",
+                  "+/-, *// - Anzahl der Punkt im Mesh vergößern/verringern",
+                  "t/T - Texturierung an/aus, e/E - Export der Hoehen an/aus",
+                  "s/S - Anzeige der Kugeln an/aus, g/G - Bildratenregler an/aus",
+                  "p/P - Simulation pausieren, m/M - Verfahren wechseln",
                   "ESC/q/Q - Ende",
                   "linke/rechte Maustaste - Picken von Kugeln und Booten"};
 
@@ -115,487 +168,431 @@ static void drawHelp()
   }
 }
 
-/** Fuellt das Index-Array, welches die Zeichnreihenfolge der Vertices bestimmt
- * @param amountIndices Anzahl der Indizees, die zum zeichnen des Mesh noetig sind
+/**
+ * Laesst die Boote auf der Wasseroberflaeche schwimmen
  */
-void fillIndexArray(GLint amountIndices)
+void updateBoatHeights(void)
 {
-  GLint i = 0;
-  GLint countUpperTri = 0;
-  GLint countLowerTri = 0;
-  GLint rowCount = -1;
-  GLboolean upperTri = GL_FALSE;
-  for (i = 0; i < amountIndices; i += 3)
-  {
-    //Jede Reihe besteht aus einer Reihe normaer Dreiecke und einer Reihe die auf dem Kopf steht
-    if (upperTri && (countUpperTri % (g_amountVerticesSide - 1) == 0))
-    {
-      upperTri = GL_FALSE;
-    }
-    else if (!upperTri && (countLowerTri % (g_amountVerticesSide - 1) == 0))
-    {
-      upperTri = GL_TRUE;
-      rowCount++;
-    }
-
-    if (upperTri)
-    {
-      g_indices[i] = countUpperTri + rowCount;
-      g_indices[i + 1] = countUpperTri + g_amountVerticesSide + rowCount;
-      g_indices[i + 2] = countUpperTri + 1 + rowCount;
-      countUpperTri++;
-    }
-    else
-    {
-      g_indices[i] = countLowerTri + 1 + rowCount;
-      g_indices[i + 1] = countLowerTri + g_amountVerticesSide + rowCount;
-      g_indices[i + 2] = countLowerTri + g_amountVerticesSide + 1 + rowCount;
-      countLowerTri++;
-    }
-  }
+  sampleWaterHeights(g_boats, AMOUNT_BOATS);
 }
 
-GLint getClosestVertex(GLint index)
+/**
+ * Liefert den Abstand der Punkte, an denen hoechstens perSide Objekte pro
+ * Seite angezeigt werden
+ * @param perSide Hoechstzahl der Objekte pro Seite
+ * @return jeder wievielte Punkt pro Zeile und Spalte
+ */
+static GLint getDisplayStride(GLint perSide)
 {
-  GLint i = 0;
-  GLint amountVerticesSide = getAmountVertices();
-  CGVector2f vector = {0.0f, 0.0f};
-  GLfloat shortestDistance = FLT_MAX;
-  GLint closestVertex = -1;
-  CGVector2f boatCoords;
-  boatCoords[0] = g_boats[index][0];
-  boatCoords[1] = g_boats[index][2];
-
-  for (i = 0; i < SQUARE(amountVerticesSide); i++)
-  {
-    vector[0] = fabs(g_vertices[i][CX] - boatCoords[0]);
-    vector[1] = fabs(g_vertices[i][CZ] - boatCoords[1]);
-    GLfloat temp = sqrt(SQUARE(vector[0]) + SQUARE(vector[1]));
-    if (temp < shortestDistance)
-    {
-      shortestDistance = temp;
-      closestVertex = i;
-    }
-  }
-  return closestVertex;
+  return (g_amountVerticesSide + perSide - 1) / perSide;
 }
 
-void updateBoatHeights(void)
+/**
+ * Liefert den Abstand der Punkte, deren Normalen angezeigt werden
+ * @return jeder wievielte Punkt pro Zeile und Spalte
+ */
+static GLint getNormalLineStride(void)
 {
-  g_boats[0][1] = g_vertices[getClosestVertex(0)][CY];
-  g_boats[1][1] = g_vertices[getClosestVertex(1)][CY];
+  return getDisplayStride(NORMAL_LINES_PER_SIDE);
 }
 
 /**
- * berechnet die Normale eines Punktes auf Basis der Nachbarpunkte, 
- * wenn ein Nachbar außerhalb des Feldes liegen wuerde, 
- * wird stattdessen der Punkt selbst fuer die Berechnung verwendet
- * @param i Index des Punktes, zu dem die Normale berechnet wird
- * @return Zeiger auf die Normale
+ * Liefert den Abstand der Punkte, an denen Kugeln gezeichnet und gepickt werden
+ * @return jeder wievielte Punkt pro Zeile und Spalte
  */
-CGVector3f *calcNormal(GLint i)
+static GLint getSphereStride(void)
 {
-  static CGVector3f toReturn = {0.0f, 0.0f, 0.0f};
-
-  //Variablen fuer die Nachbarpunkte
-  CGVector3f x1 = {0.0f, 0.0f, 0.0f};
-  CGVector3f x2 = {0.0f, 0.0f, 0.0f};
-  CGVector3f z1 = {0.0f, 0.0f, 0.0f};
-  CGVector3f z2 = {0.0f, 0.0f, 0.0f};
-  //Verbindungsvektor zwischen den Nachbarn in x- und in z-Richtung
-  CGVector3f x1x2 = {0.0f, 0.0f, 0.0f};
-  CGVector3f z1z2 = {0.0f, 0.0f, 0.0f};
-
-  // Rechter Nachbar
-  if ((i + 1) % g_amountVerticesSide == 0)
-  {
-    x2[0] = g_vertices[i][CX];
-    x2[1] = g_vertices[i][CY];
-    x2[2] = g_vertices[i][CZ];
-  }
-  else
-  {
-    x2[0] = g_vertices[i + 1][CX];
-    x2[1] = g_vertices[i + 1][CY];
-    x2[2] = g_vertices[i + 1][CZ];
-  }
-
-  //Linker Nachbar
-  if ((i % g_amountVerticesSide) == 0)
-  {
-    x1[0] = g_vertices[i][CX];
-    x1[1] = g_vertices[i][CY];
-    x1[2] = g_vertices[i][CZ];
-  }
-  else
-  {
-    x1[0] = g_vertices[i - 1][CX];
-    x1[1] = g_vertices[i - 1][CY];
-    x1[2] = g_vertices[i - 1][CZ];
-  }
-
-  //Unterer Nachbar
-  if ((i + g_amountVerticesSide) >= SQUARE(g_amountVerticesSide))
-  {
-    z2[0] = g_vertices[i][CX];
-    z2[1] = g_vertices[i][CY];
-    z2[2] = g_vertices[i][CZ];
-  }
-  else
-  {
-    z2[0] = g_vertices[i + g_amountVerticesSide][CX];
-    z2[1] = g_vertices[i + g_amountVerticesSide][CY];
-    z2[2] = g_vertices[i + g_amountVerticesSide][CZ];
-  }
+  return getDisplayStride(SPHERES_PER_SIDE);
+}
 
-  //Oberer Nachbar
-  if (i < g_amountVerticesSide)
+/**
+ * Liefert die Farbe des Wassers abhaengig von der Hoehe
+ * @param height Hoehe eines Punktes
+ * @return Farbe als RGBA8
+ */
+static const GLubyte *getWaterColor(GLfloat height)
+{
+  if (height < LOWER_BORDER)
   {
-    z1[0] = g_vertices[i][CX];
-    z1[1] = g_vertices[i][CY];
-    z1[2] = g_vertices[i][CZ];
+    return LOW_DARK_BLUE;
   }
-  else
+  else if (height < UPPER_BORDER)
   {
-    z1[0] = g_vertices[i - g_amountVerticesSide][CX];
-    z1[1] = g_vertices[i - g_amountVerticesSide][CY];
-    z1[2] = g_vertices[i - g_amountVerticesSide][CZ];
+    return MEDIUM_GREEN;
   }
+  return HIGH_RED;
+}
 
-  //Verbindungsvektor in X
-  x1x2[0] = x2[0] - x1[0];
-  x1x2[1] = x2[1] - x1[1];
-  x1x2[2] = x2[2] - x1[2];
-
-  //Verbindungsvektor in Z
-  z1z2[0] = z1[0] - z2[0];
-  z1z2[1] = z1[1] - z2[1];
-  z1z2[2] = z1[2] - z2[2];
-
-  //Kreuzprodukt der Vektoren berechnen
-  toReturn[0] = x1x2[1] * z1z2[2] - x1x2[2] * z1z2[1];
-  toReturn[1] = x1x2[2] * z1z2[0] - x1x2[0] * z1z2[2];
-  toReturn[2] = x1x2[0] * z1z2[1] - x1x2[1] * z1z2[0];
+/**
+ * Baut das Netz der verfeinerten Kacheln fuer eine neue Aufteilung auf und
+ * laedt dessen Indizes und Texturkoordinaten hoch
+ * @param patches verfeinerte Kacheln des aktuellen Standes
+ * @param count Anzahl der verfeinerten Kacheln
+ */
+static void layoutRefinedSurface(const RefinedPatch *patches, GLint count)
+{
+  const RefinedMesh *mesh = NULL;
 
-  //Normieren
-  GLfloat len = sqrt(toReturn[0] * toReturn[0] + toReturn[1] * toReturn[1] + toReturn[2] * toReturn[2]);
-  toReturn[0] *= (1.0f / len);
-  toReturn[1] *= (1.0f / len);
-  toReturn[2] *= (1.0f / len);
+  layoutRefinedMesh(g_amountVerticesSide, patches, count);
+  mesh = getRefinedMesh();
 
-  return &toReturn;
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_refinedIndexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh->indexCount, mesh->indices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, g_refinedTexCoordBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 2 * mesh->vertexCount, mesh->texCoords, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void updateNormals(void)
+/**
+ * Aktualisiert Hoehen, Normalen und Farben des Netzes der verfeinerten
+ * Kacheln und laedt die Vertizes hoch
+ * @param heights Hoehenfeld des aktuellen Standes
+ * @param patches verfeinerte Kacheln des aktuellen Standes
+ */
+static void updateRefinedSurface(const GLfloat *heights, const RefinedPatch *patches)
 {
+  const RefinedMesh *mesh = getRefinedMesh();
   GLint i = 0;
-  CGVector3f *normal;
-  for (i = 0; i < SQUARE(g_amountVerticesSide); i++)
+
+  updateRefinedMesh(heights, getGridStride(), patches);
+  for (i = 0; i < mesh->vertexCount; i++)
   {
-    normal = calcNormal(i);
-    g_vertices[i][CNX] = (*normal)[0];
-    g_vertices[i][CNY] = (*normal)[1];
-    g_vertices[i][CNZ] = (*normal)[2];
+    memcpy(mesh->vertices[i].color, getWaterColor(mesh->vertices[i].position[CY]), sizeof(mesh->vertices[i].color));
   }
+
+  glBindBuffer(GL_ARRAY_BUFFER, g_refinedVertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * mesh->vertexCount, NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * mesh->vertexCount, mesh->vertices);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 /**
- * Aktualisiert die Farben aller Kugeln. 
- * Die Farben sind vom Hoehenwert der jeweiligen Kugel abghaengig
+ * Erzeugt die Linien der angezeigten Normalen aus den gerade aktualisierten
+ * Punkten in einer einzigen Liste und laedt sie hoch. Bei feinem Mesh wird
+ * nur jeder getNormalLineStride()-te Punkt pro Zeile und Spalte verwendet.
  */
-void updateColors()
+static void updateNormalLines(void)
 {
+  GLint stride = getNormalLineStride();
+  GLint x = 0;
+  GLint y = 0;
+  GLint k = 0;
+  const Vertex *vertex = NULL;
+  GLfloat *line = g_normalLines;
 
-  CGColor3f color = {1.0f, 1.0f, 1.0f};
-  GLint i = 0;
-  for (i = 0; i < SQUARE(g_amountVerticesSide); i++)
+  for (y = 0; y < g_amountVerticesSide; y += stride)
   {
-    //Farbe fuer niedrige Hoehen
-    if (g_vertices[i][CY] < LOWER_BORDER)
-    {
-      color[0] = LOW_DARK_BLUE[0];
-      color[1] = LOW_DARK_BLUE[1];
-      color[2] = LOW_DARK_BLUE[2];
-    }
-    //Farbe fuer mittlere Hoehen
-    else if (g_vertices[i][CY] < UPPER_BORDER)
+    for (x = 0; x < g_amountVerticesSide; x += stride, line += 6)
     {
-      color[0] = MEDIUM_GREEN[0];
-      color[1] = MEDIUM_GREEN[1];
-      color[2] = MEDIUM_GREEN[2];
-    }
-    else
-    //Farbe fuer grosse Hoehen
-    {
-      color[0] = HIGH_RED[0];
-      color[1] = HIGH_RED[1];
-      color[2] = HIGH_RED[2];
+      vertex = &g_vertices[y * g_amountVerticesSide + x];
+      for (k = 0; k < 3; k++)
+      {
+        line[k] = vertex->position[k];
+        line[3 + k] = vertex->position[k] + vertex->normal[k] * (NORMAL_LINE_LENGTH / NORMAL_SCALE);
+      }
     }
-    g_vertices[i][CR] = color[0];
-    g_vertices[i][CG] = color[1];
-    g_vertices[i][CB] = color[2];
   }
+  g_normalLineCount = (GLint)(line - g_normalLines) / 6;
+
+  glBindBuffer(GL_ARRAY_BUFFER, g_normalLineBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * g_normalLineCount, g_normalLines, GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 /**
- * Fuellt einen Eintrag im Vertex Array am uebergeben Index
- * @param i Index, an dem gearbeitet wird
- * @param currX X-Koordinate diese Punktes
- * @param geiht Y-Koordinate bzw. Hoehe diese Punktes
- * @param currZ Z-Koordinate dieses Punktes
- * @param currTexX X-Texturkoordinate
- * @param currTexY Y-Texturkoordinate
+ * Aktualisiert Hoehen, Normalen und Farben aller Punkte der Wasseroberflaeche
+ * in einem einzigen Durchlauf direkt aus dem Hoehenarray der Logik sowie die
+ * Hoehen der Boote. Die Normale ergibt sich aus dem Kreuzprodukt der
+ * Verbindungsvektoren der Nachbarn in x- und z-Richtung; am Rand wird wie
+ * bisher der Punkt selbst als Nachbar verwendet, der Geisterrand der Logik
+ * liefert dafuer die passende Hoehe. Bei angezeigten Normalen werden
+ * anschliessend deren Linien bestimmt und bei angezeigten Kugeln diese.
+ * Verfeinert die Simulation Kacheln, wird deren Netz ebenso aktualisiert,
+ * nach einer neuen Aufteilung vorher neu aufgebaut.
+ * Hat sich die Simulation seit dem letzten Aufruf nicht veraendert (und fehlen
+ * weder Linien der Normalen noch Kugeln), passiert sonst nichts.
  */
-void fillVertexArray(GLint i, GLfloat currX, GLfloat height, GLfloat currZ, GLfloat currTexX, GLfloat currTexY)
+static void updateWaterSurface(void)
 {
-  //Koordinaten
-  g_vertices[i][CX] = currX;
-  g_vertices[i][CY] = height;
-  g_vertices[i][CZ] = currZ;
+  static GLuint surfaceVersion = 0;
+  static GLboolean initialized = GL_FALSE;
+
+  const GLfloat *heights = NULL;
+  GLint stride = getGridStride();
+  GLint side = g_amountVerticesSide;
+  GLfloat spacing = 2.0f / (side - 1);
+  GLint x = 0;
+  GLint y = 0;
+  GLint i = 0;
+  const GLfloat *h = NULL;
+  const GLubyte *color = NULL;
+  const RefinedPatch *patches = NULL;
+  GLuint layout = 0;
+  GLfloat spanX, spanZ;
+  GLfloat slopeX, slopeZ;
+  GLfloat normal[3];
+  GLfloat invLen;
+
+  //den zuletzt von der Simulation veroeffentlichten Stand uebernehmen
+  acquireSimulation();
+  if (initialized && g_refinedLayoutValid && (surfaceVersion == getSimulationVersion()) &&
+      (!getShowNormal() || (g_normalLineCount > 0)) && (!showSpheres || g_spheresBuilt))
+  {
+    return;
+  }
+  initialized = GL_TRUE;
+  surfaceVersion = getSimulationVersion();
+  heights = getHeights();
+  g_minHeight = FLT_MAX;
+  g_maxHeight = -FLT_MAX;
+
+  for (y = 0; y < side; y++)
+  {
+    //am Rand liegt ein Nachbar auf dem Punkt selbst, der Abstand halbiert sich
+    spanZ = ((y == 0) || (y == side - 1)) ? spacing : 2.0f * spacing;
+    h = heights + y * stride;
+    for (x = 0; x < side; x++, i++)
+    {
+      spanX = ((x == 0) || (x == side - 1)) ? spacing : 2.0f * spacing;
+      slopeX = h[x + 1] - h[x - 1];
+      slopeZ = h[x - stride] - h[x + stride];
+
+      //Kreuzprodukt von (spanX, slopeX, 0) und (0, slopeZ, -spanZ)
+      normal[0] = -slopeX * spanZ;
+      normal[1] = spanX * spanZ;
+      normal[2] = spanX * slopeZ;
+      invLen = NORMAL_SCALE / sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+      //Farbe abhaengig von der Hoehe
+      color = getWaterColor(h[x]);
+
+      g_vertices[i].position[CY] = h[x];
+      g_minHeight = fminf(g_minHeight, h[x]);
+      g_maxHeight = fmaxf(g_maxHeight, h[x]);
+      g_vertices[i].normal[0] = (GLbyte)lrintf(normal[0] * invLen);
+      g_vertices[i].normal[1] = (GLbyte)lrintf(normal[1] * invLen);
+      g_vertices[i].normal[2] = (GLbyte)lrintf(normal[2] * invLen);
+      memcpy(g_vertices[i].color, color, sizeof(g_vertices[i].color));
+    }
+  }
 
-  //Textur
-  g_vertices[i][CTX] = currTexX;
-  g_vertices[i][CTY] = currTexY;
+  /* Pufferobjekt verwaisen lassen (orphaning): der Treiber stellt neuen Speicher
+   * bereit, statt auf das Ende noch laufender Zeichenbefehle mit dem alten
+   * Inhalt zu warten. Hochgeladen wird nur, wenn sich die Simulation veraendert hat. */
+  glBindBuffer(GL_ARRAY_BUFFER, g_vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * SQUARE(side), NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * SQUARE(side), g_vertices);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  g_refinedCount = getRefinedPatches(&patches, &layout);
+  if (!g_refinedLayoutValid || (layout != g_refinedLayout))
+  {
+    layoutRefinedSurface(patches, g_refinedCount);
+    g_refinedLayout = layout;
+    g_refinedLayoutValid = GL_TRUE;
+  }
+  if (g_refinedCount > 0)
+  {
+    updateRefinedSurface(heights, patches);
+  }
+
+  if (getShowNormal())
+  {
+    updateNormalLines();
+  }
+
+  g_spheresBuilt = showSpheres;
+  if (showSpheres)
+  {
+    updateSpheres(g_vertices, side, getSphereStride(), SPHERE_SCALE);
+  }
+
+  updateBoatHeights();
 }
 
 /**
- * Initialisiert das Vertex-Array beim Programmstart
+ * Baut Index- und Vertex-Array fuer die aktuelle Aufloesung in einem linearen
+ * Durchlauf auf. Das Vertex-Array wird mit genau einer (Re-)Allokation an die
+ * neue Groesse angepasst; Indizes und Texturkoordinaten aendern sich bis zur
+ * naechsten Aenderung der Aufloesung nicht und werden direkt in ihre statischen
+ * Pufferobjekte geschrieben. Hoehen, Normalen und Farben uebernimmt anschliessend
+ * updateWaterSurface in einem weiteren Durchlauf, ebenso das Netz der
+ * verfeinerten Kacheln. Die Indizes liegen kachelweise (fillTiledIndexArray),
+ * damit die unverfeinerten Kacheln in wenigen Abschnitten gezeichnet werden.
  */
-void initVertexArray(void)
+static void buildVertexArray(void)
 {
+  GLint x = 0;
+  GLint y = 0;
   GLint i = 0;
   // g_amountVerticesSide * g_amountVerticesSide Quadrate im Mesh
   // 2 Dreiecke pro Quadrat
   // 3 Vertices pro Dreieck
   GLint amountIndices = SQUARE(g_amountVerticesSide - 1) * 2 * 3;
-  GLfloat currX = -1.0f;
-  GLfloat currZ = -1.0f - (2.0f / (g_amountVerticesSide - 1));
-  GLfloat currTexX = 0.0f;
-  GLfloat currTexY = -1.0f / (g_amountVerticesSide - 1);
-  GLfloat *heights = getHeights();
-  g_vertices = malloc(sizeof(Vertex) * SQUARE(g_amountVerticesSide));
-  if (g_vertices == NULL)
+  GLfloat step = 1.0f / (g_amountVerticesSide - 1);
+  GLuint *indices = NULL;
+  GLfloat *texCoords = NULL;
+  GLint normalLinesSide = 0;
+
+  g_vertices = realloc(g_vertices, sizeof(Vertex) * SQUARE(g_amountVerticesSide));
+  normalLinesSide = (g_amountVerticesSide + getNormalLineStride() - 1) / getNormalLineStride();
+  g_normalLines = realloc(g_normalLines, sizeof(GLfloat) * 6 * SQUARE(normalLinesSide));
+  if ((g_vertices == NULL) || (g_normalLines == NULL))
   {
     exit(1);
   }
-  else
+  g_refinedLayoutValid = GL_FALSE;
+  g_normalLineCount = 0;
+  g_spheresBuilt = GL_FALSE;
+
+  if (g_vertexBuffer == 0)
   {
-    g_indices = malloc(sizeof(GLuint) * amountIndices);
-    if (g_indices == NULL)
-    {
-      free(g_vertices);
-      exit(1);
-    }
+    glGenBuffers(1, &g_indexBuffer);
+    glGenBuffers(1, &g_texCoordBuffer);
+    glGenBuffers(1, &g_vertexBuffer);
+    glGenBuffers(1, &g_refinedVertexBuffer);
+    glGenBuffers(1, &g_refinedTexCoordBuffer);
+    glGenBuffers(1, &g_refinedIndexBuffer);
+    glGenBuffers(1, &g_normalLineBuffer);
   }
 
-  fillIndexArray(amountIndices);
+  //neue Reihenfolge der Indizees zum Zeichnen bestimmen
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * amountIndices, NULL, GL_STATIC_DRAW);
+  indices = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
 
-  for (i = 0; i < SQUARE(g_amountVerticesSide); i++)
+  glBindBuffer(GL_ARRAY_BUFFER, g_texCoordBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 2 * SQUARE(g_amountVerticesSide), NULL, GL_STATIC_DRAW);
+  texCoords = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+  if ((indices == NULL) || (texCoords == NULL))
   {
-    if (i % g_amountVerticesSide == 0)
-    {
-      currX = -1.0f;
-      currZ += 2.0f / (g_amountVerticesSide - 1);
-      currTexX = 0.0f;
-      currTexY += 1.0f / (g_amountVerticesSide - 1);
-    }
-    else
+    exit(1);
+  }
+
+  fillTiledIndexArray(indices, g_amountVerticesSide);
+
+  //Koordinaten und Texturkoordinaten des regelmaessigen Gitters ueber [-1, 1]
+  for (y = 0; y < g_amountVerticesSide; y++)
+  {
+    for (x = 0; x < g_amountVerticesSide; x++, i++)
     {
-      currX += 2.0f / (g_amountVerticesSide - 1);
-      currTexX += 1.0f / (g_amountVerticesSide - 1);
+      g_vertices[i].position[CX] = -1.0f + 2.0f * x * step;
+      g_vertices[i].position[CZ] = -1.0f + 2.0f * y * step;
+      g_vertices[i].normal[3] = 0;
+      texCoords[2 * i] = x * step;
+      texCoords[2 * i + 1] = y * step;
     }
-    fillVertexArray(i, currX, heights[i], currZ, currTexX, currTexY);
   }
-  updateColors();
-  updateNormals();
+
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  updateWaterSurface();
 }
 
+/** Offset in Byte innerhalb eines gebundenen Pufferobjekts */
+#define BUFFER_OFFSET(bytes) ((const GLvoid *)(bytes))
+
 /**
- * Aktualisiert das Vertex-Array beim Verandern der Aufloesung des Mesh
+ * Aktualisiert das Vertex-Array beim Verandern der Aufloesung des Mesh.
+ * Die Zeiger beziehen sich auf das beim Aufruf gebundene Pufferobjekt und
+ * bleiben auch nach dem Loesen der Bindung gueltig.
  */
 void updateScene(void)
 {
   //Vertex und Color Array definieren und bei Änderungen aktualisieren
-  glVertexPointer(3,                     //Komponenten pro Vertex (x,y,z)
-                  GL_FLOAT,              //Typ der Komponenten
-                  sizeof(Vertex),        //Offset zwischen 2 Vertizes im Array
-                  &(g_vertices[0][CX])); //Zeiger auf die 1. Komponente
-  glColorPointer(3, GL_FLOAT, sizeof(Vertex), &(g_vertices[0][CR]));
-  glNormalPointer(GL_FLOAT, sizeof(Vertex), &(g_vertices[0][CNX]));
-  glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &(g_vertices[0][CTX]));
-}
+  glBindBuffer(GL_ARRAY_BUFFER, g_vertexBuffer);
+  glVertexPointer(3,                                          //Komponenten pro Vertex (x,y,z)
+                  GL_FLOAT,                                   //Typ der Komponenten
+                  sizeof(Vertex),                             //Offset zwischen 2 Vertizes im Array
+                  BUFFER_OFFSET(offsetof(Vertex, position))); //Offset der 1. Komponente im Puffer
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, color)));
+  glNormalPointer(GL_BYTE, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, normal)));
 
-void updateVertexArray(expandShrinkVertices state)
-{
-  GLint i = 0;
-  // 2 Dreiecke pro Quadrat
-  // 3 Vertices pro Dreieck
-  GLint amountIndices;
-  GLfloat currX = -1.0f;
-  GLfloat currZ;
-  GLfloat currTexX = 0.0f;
-  GLfloat currTexY;
-  GLfloat *newHeights;
-
-  g_amountVerticesSide += state;
-  //neue Hoehen aus der Logik holen
-  newHeights = calloc(SQUARE(g_amountVerticesSide), sizeof(GLfloat));
-  if (newHeights != NULL)
-  {
-    for (i = 0; i < SQUARE(g_amountVerticesSide); i++)
-    {
-      newHeights[i] = getHeights()[i];
-    }
-
-    amountIndices = SQUARE(g_amountVerticesSide - 1) * 2 * 3;
-    currZ = -1.0f - (2.0f / (g_amountVerticesSide - 1));
-    currTexY = -1.0f / (g_amountVerticesSide - 1);
-    //neue Reihenfolge der Indizees zum Zeichnen bestimmen
-    g_indices = realloc(g_indices, sizeof(GLuint) * amountIndices);
-    if (g_indices != NULL)
-    {
-      fillIndexArray(amountIndices);
-      g_vertices = realloc(g_vertices, sizeof(Vertex) * SQUARE(g_amountVerticesSide));
-      if (g_vertices == NULL)
-      {
-        exit(1);
-      }
-      else
-      {
-        //neue Texturkoordinaten berechnen
-        for (i = 0; i < SQUARE(g_amountVerticesSide); i++)
-        {
-          if (i % g_amountVerticesSide == 0)
-          {
-            currX = -1.0f;
-            currZ += 2.0f / (g_amountVerticesSide - 1);
-            currTexX = 0.0f;
-            currTexY += 1.0f / (g_amountVerticesSide - 1);
-          }
-          else
-          {
-            currX += 2.0f / (g_amountVerticesSide - 1);
-            currTexX += 1.0f / (g_amountVerticesSide - 1);
-          }
-          fillVertexArray(i, currX, newHeights[i], currZ, currTexX, currTexY);
-          updateNormals();
-        }
-        updateColors();
-      }
-    }
-    else
-    {
-      exit(1);
-    }
-    updateScene();
-  }
-  else
-  {
-    exit(1);
-  }
+  glBindBuffer(GL_ARRAY_BUFFER, g_texCoordBuffer);
+  glTexCoordPointer(2, GL_FLOAT, 0, BUFFER_OFFSET(0));
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-/**
- * Aktualisiert die Hoehen, indem die Werte aus der Logik uebernommen werden
- */
-void updateHeights(void)
+void updateVertexArray(GLint amountVerticesSide)
 {
-  GLint i = 0;
-  for (i = 0; i < SQUARE(g_amountVerticesSide); i++)
-  {
-    g_vertices[i][CY] = getHeights()[i];
-  }
+  g_amountVerticesSide = amountVerticesSide;
+  buildVertexArray();
+  updateScene();
 }
 
 void freeAllocatedMem(void)
 {
-  free(g_indices);
+  glDeleteBuffers(1, &g_indexBuffer);
+  glDeleteBuffers(1, &g_texCoordBuffer);
+  glDeleteBuffers(1, &g_vertexBuffer);
+  glDeleteBuffers(1, &g_refinedVertexBuffer);
+  glDeleteBuffers(1, &g_refinedTexCoordBuffer);
+  glDeleteBuffers(1, &g_refinedIndexBuffer);
+  glDeleteBuffers(1, &g_normalLineBuffer);
+  freeSphereMesh();
+  freePropMeshes();
+  freeRefinedMesh();
   free(g_vertices);
+  free(g_normalLines);
 }
 
 /**
- * Zeichnet eine Linie mit der uebergebenen Farbe,
- * mit der Laenge 1 entlang der z-Achse
- * 
- * @param[in] color, Farbe des Quadrats
+ * Zeichnet die Linien der Normalen der Wasseroberflaeche mit einem Aufruf
  */
-static void drawLine(GLint i, const CGColor3f color)
+static void drawNormalLines(void)
 {
-  glBegin(GL_LINES);
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
   {
-    glColor3f(1, 1, 1);
-    glVertex3f(g_vertices[i][CNX], g_vertices[i][CNY], g_vertices[i][CNZ]);
-    glVertex3f(0.0f, 0.0f, 0.0f);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glBindBuffer(GL_ARRAY_BUFFER, g_normalLineBuffer);
+    glVertexPointer(3, GL_FLOAT, 0, BUFFER_OFFSET(0));
+    glDrawArrays(GL_LINES, 0, 2 * g_normalLineCount);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
   }
-  glEnd();
+  glPopClientAttrib();
 }
 
 /**
- * Zeichnet eine Insel in Form eines Zylinders
+ * Zeichnet das Netz der verfeinerten Kacheln mit einem Aufruf, die Zeiger des
+ * groben Netzes bleiben erhalten
  */
-
-/**
- * Zeichnet eine Normale von einem Punkt im Vertex-Array
- * @param i Index des Punktes von dem die Normale gezeichnet wird
- * @param color Farbe, in der die Normale gezeichnet wird
- */
-static void drawNormal(GLint i, const CGColor3f color)
+static void drawRefinedSurface(void)
 {
-  glPushMatrix();
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
   {
-    glTranslatef(g_vertices[i][CX], g_vertices[i][CY], g_vertices[i][CZ]);
-    glScalef(1.0f / 10, 1.0f / 10, 1.0f / 10);
-    drawLine(i, color);
+    glBindBuffer(GL_ARRAY_BUFFER, g_refinedVertexBuffer);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, position)));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, color)));
+    glNormalPointer(GL_BYTE, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, normal)));
+    glBindBuffer(GL_ARRAY_BUFFER, g_refinedTexCoordBuffer);
+    glTexCoordPointer(2, GL_FLOAT, 0, BUFFER_OFFSET(0));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_refinedIndexBuffer);
+    glDrawElements(GL_TRIANGLES, getRefinedMesh()->indexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   }
-  glPopMatrix();
+  glPopClientAttrib();
 }
 
 /**
- * Zeichnet alle Kugeln an den entsprechenden Punkten basierend auf dem Vertex-Array
+ * Zeichnet die Kugeln an den Punkten des Vertex-Arrays (bei feinem Mesh nur
+ * an jedem getSphereStride()-ten und dem letzten Punkt pro Zeile und Spalte)
  */
 static void drawAllSpheres(void)
 {
   glPushMatrix();
   {
     glDisable(GL_TEXTURE_2D);
-    for (int i = 0; i < SQUARE(g_amountVerticesSide); i++)
-    {
-      glPushMatrix();
-      {
-
-        glTranslatef(g_vertices[i][CX], g_vertices[i][CY], g_vertices[i][CZ]);
-        glScalef(1.0f / 20, 1.0f / 20, 1.0f / 20);
-        const CGColor3f color = {g_vertices[i][CR], g_vertices[i][CG], g_vertices[i][CB]};
-        glPushName((GLuint)i);
-        {
-          drawSphere(color);
-        }
-        glPopName();
-      }
-      glPopMatrix();
-    }
-  }
-  glPopMatrix();
-}
-
-/**
- * Zeichnet einen texturierten Leuchtturm
- */
-static void drawLighthouse(void)
-{
-  glPushMatrix();
-  {
-    glTranslatef(0.0f, LIGHTHOUSE_HEIGHT, 0.0f);
-    glRotatef(180, 1.0f, 0.0f, 0.0f);
-    bindTexture(texLighthouse);
-    drawCylinder(COLOR_WHITE, LIGHTHOUSE_RADIUS, LIGHTHOUSE_RADIUS, LIGHTHOUSE_HEIGHT, GL_TRUE);
-  }
-  glPopMatrix();
-
-  glPushMatrix();
-  {
-    glTranslatef(0.0f, LIGHTHOUSE_HEIGHT, 0.0f);
-    drawCylinder(COLOR_RED, LIGHTHOUSE_RADIUS, 0.0f, LIGHTHOUSE_HEIGHT / 4.0f, GL_FALSE);
+    drawSpheres();
   }
   glPopMatrix();
 }
@@ -611,10 +608,8 @@ void drawScene(void)
   }
   else
   {
-    //Punkte aktualisieren
-    updateHeights();
-    updateBoatHeights();
-    updateColors();
+    //Punkte aktualisieren, sofern die Simulation seit dem letzten Bild fortgeschritten ist
+    updateWaterSurface();
     /* Punktlichtquelle, die die Szene von oben beleuchtet */
     CGPoint4f lightPos0 = {0.0f, 25.0f, 0.0f, 0.0f};
 
@@ -697,10 +692,22 @@ void drawScene(void)
     {
       glColor3f(1, 1, 1);
       //Zeichnen (in der drawScene für jeden Frame)
-      glDrawElements(GL_TRIANGLES,                             //Primitivtyp
-                     SQUARE(g_amountVerticesSide - 1) * 3 * 2, //Anzahl Indizes zum Zeichnen
-                     GL_UNSIGNED_INT,                          //Typ der Indizes
-                     g_indices);                               //Index Array
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_indexBuffer);
+      if (g_refinedCount > 0)
+      {
+        //unverfeinerte Kacheln in zusammenhaengenden Abschnitten, dann die feinen Netze
+        glMultiDrawElements(GL_TRIANGLES, getRefinedMesh()->runCounts, GL_UNSIGNED_INT,
+                            getRefinedMesh()->runOffsets, getRefinedMesh()->runCount);
+        drawRefinedSurface();
+      }
+      else
+      {
+        glDrawElements(GL_TRIANGLES,                             //Primitivtyp
+                       SQUARE(g_amountVerticesSide - 1) * 3 * 2, //Anzahl Indizes zum Zeichnen
+                       GL_UNSIGNED_INT,                          //Typ der Indizes
+                       BUFFER_OFFSET(0));                        //Offset im Index-Puffer
+      }
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
     glPopMatrix();
 
@@ -714,6 +721,7 @@ void drawScene(void)
     glPushMatrix();
     {
       glTranslatef(0.0f, getIslandHeight() / 2.0f, 0.0f);
+      bindTexture(texLighthouse);
       drawLighthouse();
     }
     glPopMatrix();
@@ -725,21 +733,10 @@ void drawScene(void)
 
     drawBoats();
 
-    glPushMatrix();
+    if (getShowNormal())
     {
-      if (getShowNormal())
-      {
-        for (int i = 0; i < SQUARE(g_amountVerticesSide); i++)
-        {
-          glPushMatrix();
-          {
-            drawNormal(i, COLOR_WHITE);
-          }
-          glPopMatrix();
-        }
-      }
+      drawNormalLines();
     }
-    glPopMatrix();
     /* Erste Lichtquelle deaktivieren */
     glDisable(GL_LIGHT0);
     /* Zweite Lichtquelle deaktivieren */
@@ -756,16 +753,38 @@ void drawScene(void)
   }
 }
 
-void drawScenePickable(GLboolean spheres)
+GLint pickScene(const Ray *ray, GLboolean spheres)
 {
+  GLint picked = -1;
+  GLfloat t = 0.0f;
+  GLfloat closestT = FLT_MAX;
+  GLint i = 0;
+  CGVector3f min, max;
+
   if (spheres)
   {
-    drawAllSpheres();
+    picked = intersectHeightfield(ray, g_vertices, g_amountVerticesSide, g_minHeight, g_maxHeight,
+                                  SPHERE_SCALE * 0.5f, getSphereStride(), &t);
   }
   else
   {
-    drawBoats();
+    //Quader um Rumpf, Spitze und Fracht der Boote (siehe drawBoats)
+    for (i = 0; i < AMOUNT_BOATS; i++)
+    {
+      min[0] = g_boats[i][0] - BOAT_BOUNDS_BACK;
+      min[1] = g_boats[i][1];
+      min[2] = g_boats[i][2] - BOAT_BOUNDS_HALF_WIDTH;
+      max[0] = g_boats[i][0] + BOAT_BOUNDS_FRONT;
+      max[1] = g_boats[i][1] + BOAT_BOUNDS_HEIGHT;
+      max[2] = g_boats[i][2] + BOAT_BOUNDS_HALF_WIDTH;
+      if (intersectBox(ray, min, max, &t) && (t < closestT))
+      {
+        closestT = t;
+        picked = (i == 0) ? boat1 : boat2;
+      }
+    }
   }
+  return picked;
 }
 
 /**
@@ -843,11 +862,13 @@ int initScene(void)
   glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
 
   calcCylinderPoints();
+  initPropMeshes();
+  //mit der letzten Zeile bzw. Spalte hoechstens eine Kugel pro Seite mehr
+  initSphereMesh(SQUARE(SPHERES_PER_SIDE + 1));
   g_amountVerticesSide = START_AMOUNT_VERTICES;
   initLight();
-  initVertexArray();
+  buildVertexArray();
   updateScene();
-  updateBoatHeights();
 
   glLineWidth(2.0f);
 
@@ -882,6 +903,8 @@ void toggleWireframeMode(void)
 void toggleNormal(void)
 {
   setShowNormal(!getShowNormal());
+  //beim Einschalten baut das naechste Bild die Linien auf, auch ohne neuen Stand der Simulation
+  g_normalLineCount = 0;
 }
 
 /**
@@ -890,6 +913,8 @@ void toggleNormal(void)
 void toggleSpheres(void)
 {
   showSpheres = !showSpheres;
+  //beim Einschalten legt das naechste Bild die Kugeln ab, auch ohne neuen Stand der Simulation
+  g_spheresBuilt = GL_FALSE;
 }
 
 /**
@@ -969,3 +994,8 @@ GLfloat getBoatCHeight(GLint index)
 {
   return g_boats[index][1];
 }
+
+CGVector3f *getBoats(void)
+{
+  return g_boats;
+}
@@ -1,6 +1,7 @@
 #ifndef __SCENE_H__
 #define __SCENE_H__
 #include "types.h"
+#include "picking.h"
 /**
  * @file
  * Schnittstelle des Darstellungs-Moduls.
@@ -18,21 +19,19 @@
 void drawScene (void);
 
 /**
- * Zeichen-Funktion fuer das Picking, die nur pickbare Objekte zeichnet
- * @param spheres wenn Kugeln gepickt werden koennen true, fuer Boote false
- */ 
-void drawScenePickable(GLboolean spheres);
-
-/**
- * Aktualisiert die Normalen fuer alle Kugeln
+ * Picking der Szene auf der CPU: bestimmt das dem Betrachter naechste
+ * Objekt, das vom Strahl getroffen wird.
+ * @param ray Strahl von der Kamera durch den Mauszeiger
+ * @param spheres wenn Kugeln bzw. Punkte des Mesh gepickt werden koennen true, fuer Boote false
+ * @return Index des Punktes bzw. Nummer des Bootes (boat1, boat2), -1 wenn nichts getroffen wurde
  */
-void updateNormals(void);
+GLint pickScene(const Ray *ray, GLboolean spheres);
 
 /**
  * Aktualisiert das Vertex-Array, wenn die Aufloesung des Mesh veraendert wird
- * @param state ob vergroessert oder verkleinert wird
+ * @param amountVerticesSide neue Anzahl der Punkte pro Seite
  */
-void updateVertexArray(expandShrinkVertices state);
+void updateVertexArray(GLint amountVerticesSide);
 
 /**
  * Initialisierung der Szene (inbesondere der OpenGL-Statusmaschine).
@@ -111,4 +110,10 @@ void freeAllocatedMem(void);
 
 GLfloat getBoatCHeight(GLint index);
 
+/**
+ * Liefert die Positionen der Boote (AMOUNT_BOATS Eintraege)
+ * @return Positionen der Boote, veraenderbar
+ */
+CGVector3f *getBoats(void);
+
 #endif
@@ -2,6 +2,9 @@
 #include <windows.h>
 #endif
 
+/* GLEW muss vor allen anderen OpenGL-Headern eingebunden werden */
+#include <GL/glew.h>
+
 #ifdef __APPLE__
 #include <OpenGL/gl.h>
 #include <GLUT/glut.h>
@@ -11,9 +14,12 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
 #include <math.h>
 #include "types.h"
 #include "scene.h"
+#include "sceneObjects.h"
 
 
 #define M_PI 3.141592654
@@ -28,13 +34,126 @@
 #define NUM_SLICES_LIGHTHOUSE (25)
 /**Hoehe der Insel*/
 #define ISLAND_HEIGHT (0.4f)
+/** Radius der Insel */
+#define ISLAND_RADIUS (0.25f)
+
+/** Hoehe und Radius des Leuchtturms, das Dach ist ein Viertel so hoch */
+#define LIGHTHOUSE_HEIGHT (0.75f)
+#define LIGHTHOUSE_RADIUS (0.15f)
 
 #define NUM_QUADS (4)
 
+#ifndef DEG2RAD
+/** Winkelumrechnung von Grad nach Radiant */
+#define DEG2RAD(x) ((x) / 180.0f * M_PI)
+#endif
+
 CGVector3f circlePoints[NUM_SLICES_ISLAND];
 GLboolean showNormal = GL_FALSE;
 
 static const CGColor3f COLOR_BROWN = {0.59f, 0.29f, 0.0f};
+static const CGColor3f COLOR_GRAY = {0.75f, 0.75f, 0.75f};
+static const CGColor3f COLOR_WHITE = {1.0f, 1.0f, 1.0f};
+static const CGColor3f COLOR_RED = {1.0f, 0.0f, 0.0f};
+
+/**
+ * Unbewegliche Objekte der Szene, jedes ein zusammenhaengender Bereich im
+ * gemeinsamen Index-Puffer
+ */
+typedef enum
+{
+  propIsland,
+  propLighthouseTower,
+  propLighthouseRoof,
+  propBoat,
+  AMOUNT_PROPS
+} Prop;
+
+/**
+ * Vertex der Objekte der Szene
+ */
+typedef struct
+{
+  GLfloat position[3];
+  GLfloat normal[3];
+  GLfloat texCoord[2];
+} PropVertex;
+
+/**
+ * Bereich eines Objekts im Index-Puffer
+ */
+typedef struct
+{
+  GLint first;
+  GLint count;
+} PropRange;
+
+/**
+ * Geometrie der Objekte waehrend des einmaligen Aufbaus
+ */
+typedef struct
+{
+  PropVertex *vertices;
+  GLushort *indices;
+  GLint vertexCount;
+  GLint indexCount;
+} PropBuilder;
+
+/**
+ * Lage eines Quaders im Boot: Skalierung des Wuerfels, Drehung um die
+ * y-Achse in Grad und Verschiebung relativ zur Position des Bootes
+ */
+typedef struct
+{
+  GLfloat offset[3];
+  GLfloat angle;
+  GLfloat scale[3];
+} BoatPart;
+
+/** Anzahl der Quader eines Bootes */
+#define AMOUNT_BOAT_PARTS (3)
+
+/** Rumpf, Spitze und Fracht, beide Boote sind gleich gebaut */
+static const BoatPart BOAT_PARTS[AMOUNT_BOAT_PARTS] = {{{0.0f, 0.0f, 0.0f}, 0.0f, {0.35f, 0.1f, 0.25f}},
+                                                       {{-0.175f, 0.0f, 0.0f}, 45.0f, {0.175f, 0.1f - 0.00001f, 0.175f}},
+                                                       {{0.1f, 0.075f, 0.0f}, 0.0f, {0.15f, 0.15f, 0.15f}}};
+
+/** Anzahl der Vertizes und Indizes aller Objekte zusammen */
+#define PROP_VERTICES (3 * NUM_SLICES_ISLAND + 2 + 2 * SQUARE(NUM_SLICES_LIGHTHOUSE + 1) + \
+                       AMOUNT_BOAT_PARTS * 6 * SQUARE(NUM_QUADS + 1))
+#define PROP_INDICES (3 * (NUM_SLICES_ISLAND - 2) + 6 * NUM_SLICES_ISLAND + 2 * 6 * SQUARE(NUM_SLICES_LIGHTHOUSE) + \
+                      AMOUNT_BOAT_PARTS * 6 * 6 * SQUARE(NUM_QUADS))
+
+/** Pufferobjekte aller unbeweglichen Objekte und deren Bereiche */
+static GLuint g_propBuffer = 0;
+static GLuint g_propIndexBuffer = 0;
+static PropRange g_props[AMOUNT_PROPS];
+
+/** Anzahl der Vertizes und Indizes einer Kugel */
+#define SPHERE_VERTICES (SQUARE(SLICES + 1))
+#define SPHERE_INDICES (SQUARE(SLICES) * 6)
+
+/**
+ * Vertex einer Kugel im gemeinsamen Pufferobjekt aller Kugeln
+ */
+typedef struct
+{
+  GLfloat position[3];
+  GLfloat normal[3];
+  GLubyte color[4];
+} SphereVertex;
+
+/** Einmalig tessellierte Einheitskugel (Radius 0.5), die fuer jede Kugel verschoben und skaliert wird */
+static SphereVertex g_sphereTemplate[SPHERE_VERTICES];
+
+/** Alle Kugeln eines Standes der Simulation, deren Anzahl und Hoechstzahl */
+static SphereVertex *g_sphereBatch = NULL;
+static GLint g_sphereCount = 0;
+static GLint g_maxSpheres = 0;
+
+/** Pufferobjekte aller Kugeln, die Indizes aendern sich nach dem Start nicht mehr */
+static GLuint g_sphereBuffer = 0;
+static GLuint g_sphereIndexBuffer = 0;
 
 /**
  * Zeichnet eine Linie mit der uebergebenen Farbe,
@@ -75,87 +194,16 @@ static void drawNormal(const CGColor3f color)
 }
 
 /**
- * Zeichnet ein Quadrat mit der uebergebenen Farbe, 
- * mit Seitenlaenge 1 um den Ursprung rum
- * 
- * @param[in] color, Farbe des Quadrats
- */
-static void drawRect(const CGColor3f color)
-{
-  /* Material des Wuerfels */
-  float matShininess[] = {100.0f};
-
-  /* Setzen der Material-Parameter */
-  glMaterialfv(GL_FRONT, GL_AMBIENT, color);
-  glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
-  glMaterialfv(GL_FRONT, GL_SPECULAR, color);
-  glMaterialfv(GL_FRONT, GL_SHININESS, matShininess);
-
-  glBegin(GL_QUADS);
-  {
-    glNormal3f(0.0f, 1.0f, 0.0f);
-    glColor3f(color[0], color[1], color[2]);
-    glVertex3f(-0.5f, 0.0f, -0.5f);
-    glVertex3f(-0.5f, 0.0f, 0.5f);
-    glVertex3f(0.5f, 0.0f, 0.5f);
-    glVertex3f(0.5f, 0.0f, -0.5f);
-  }
-  glEnd();
-}
-
-/**
- * Zeichnet eine Flaeche mit der uebergebenen Farbe, 
- * mit Seitenlaenge 1 um den Ursprung rum.
- * Zusammengesetzt aus AMOUNT_PIXEL_PER_BLOCK kleineren Quadraten
- * 
- * @param[in] color, Farbe des Quadrats
- */
-static void drawPlane(const CGColor3f color)
-{
-  GLint i = 0;
-  GLint m = 0;
-
-  glPushMatrix();
-  {
-    // Verschieben des Mittelpunktes der Grundflaeche in den Ursprung
-    glTranslatef(-0.5f + 0.5f * 1.0f / NUM_QUADS, 0.0f, -0.5f + 0.5f * 1.0f / NUM_QUADS);
-    for (i = 0; i < NUM_QUADS; i++)
-    {
-      glPushMatrix();
-      {
-        glTranslatef(0.0f, 0.0f, (1.0f / NUM_QUADS) * i);
-        for (m = 0; m < NUM_QUADS; m++)
-        {
-          glPushMatrix();
-          {
-            glTranslatef((1.0f / NUM_QUADS) * m, 0.0f, 0.0f);
-            glScalef(1.0f / NUM_QUADS, 1.0f, 1.0f / NUM_QUADS);
-            drawRect(color);
-          }
-          glPopMatrix();
-        }
-      }
-      glPopMatrix();
-    }
-  }
-  glPopMatrix();
-}
-
-/**
- * Zeichnet einen Wuerfel mit Kantenlaenge 1.
+ * Zeichnet die Normalen der sechs Seitenflaechen eines Wuerfels mit
+ * Kantenlaenge 1, dessen Unterseite im Ursprung liegt.
  */
-static void
-drawCube(GLboolean normal)
+static void drawCubeNormals(void)
 {
   /* Unterseite */
   glPushMatrix();
   {
     glRotatef(180, 1.0f, 0.0f, 0.0f);
-    drawPlane(COLOR_BROWN);
-    if (showNormal)
-    {
-      drawNormal(COLOR_BROWN);
-    }
+    drawNormal(COLOR_BROWN);
   }
   glPopMatrix();
 
@@ -165,11 +213,7 @@ drawCube(GLboolean normal)
     glTranslatef(0.5f, 0.5f, 0.0f);
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
     glRotatef(-90.0f, 0.0f, 0.0f, 1.0f);
-    drawPlane(COLOR_BROWN);
-    if (showNormal)
-    {
-      drawNormal(COLOR_BROWN);
-    }
+    drawNormal(COLOR_BROWN);
   }
   glPopMatrix();
 
@@ -180,11 +224,7 @@ drawCube(GLboolean normal)
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
     glRotatef(-90.0f, 0.0f, 0.0f, 1.0f);
     glRotatef(180, 1.0f, 0.0f, 0.0f);
-    drawPlane(COLOR_BROWN);
-    if (showNormal)
-    {
-      drawNormal(COLOR_BROWN);
-    }
+    drawNormal(COLOR_BROWN);
   }
   glPopMatrix();
 
@@ -194,11 +234,7 @@ drawCube(GLboolean normal)
     glTranslatef(0.0f, 0.5f, -0.5f);
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
     glRotatef(180, 1.0f, 0.0f, 0.0f);
-    drawPlane(COLOR_BROWN);
-    if (showNormal)
-    {
-      drawNormal(COLOR_BROWN);
-    }
+    drawNormal(COLOR_BROWN);
   }
   glPopMatrix();
 
@@ -207,11 +243,7 @@ drawCube(GLboolean normal)
   {
     glTranslatef(0.0f, 0.5f, 0.5f);
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
-    drawPlane(COLOR_BROWN);
-    if (showNormal)
-    {
-      drawNormal(COLOR_BROWN);
-    }
+    drawNormal(COLOR_BROWN);
   }
   glPopMatrix();
 
@@ -219,16 +251,110 @@ drawCube(GLboolean normal)
   glPushMatrix();
   {
     glTranslatef(0.0f, 1.0f, 0.0f);
-    drawPlane(COLOR_BROWN);
-    if (showNormal)
+    drawNormal(COLOR_BROWN);
+  }
+  glPopMatrix();
+}
+
+void initSphereMesh(GLint maxSpheres)
+{
+  const GLfloat radius = 0.5f;
+  GLuint *indices = NULL;
+  GLint stack = 0;
+  GLint slice = 0;
+  GLint sphere = 0;
+  GLint i = 0;
+  GLuint upper, lower, base;
+  GLfloat phi, theta;
+
+  for (stack = 0; stack <= SLICES; stack++)
+  {
+    phi = M_PI * stack / SLICES;
+    for (slice = 0; slice <= SLICES; slice++, i++)
     {
-      drawNormal(COLOR_BROWN);
+      theta = 2.0f * M_PI * slice / SLICES;
+      g_sphereTemplate[i].normal[0] = sinf(phi) * cosf(theta);
+      g_sphereTemplate[i].normal[1] = cosf(phi);
+      g_sphereTemplate[i].normal[2] = -sinf(phi) * sinf(theta);
+      g_sphereTemplate[i].position[0] = radius * g_sphereTemplate[i].normal[0];
+      g_sphereTemplate[i].position[1] = radius * g_sphereTemplate[i].normal[1];
+      g_sphereTemplate[i].position[2] = radius * g_sphereTemplate[i].normal[2];
     }
   }
-  glPopMatrix();
+
+  g_maxSpheres = maxSpheres;
+  g_sphereBatch = malloc(sizeof(SphereVertex) * SPHERE_VERTICES * maxSpheres);
+  indices = malloc(sizeof(GLuint) * SPHERE_INDICES * maxSpheres);
+  if ((g_sphereBatch == NULL) || (indices == NULL))
+  {
+    exit(1);
+  }
+
+  //je Segment zwei gegen den Uhrzeigersinn orientierte Dreiecke, fuer jede Kugel versetzt
+  i = 0;
+  for (sphere = 0; sphere < maxSpheres; sphere++)
+  {
+    base = sphere * SPHERE_VERTICES;
+    for (stack = 0; stack < SLICES; stack++)
+    {
+      for (slice = 0; slice < SLICES; slice++)
+      {
+        upper = base + stack * (SLICES + 1) + slice;
+        lower = upper + SLICES + 1;
+        indices[i++] = upper;
+        indices[i++] = lower;
+        indices[i++] = upper + 1;
+        indices[i++] = upper + 1;
+        indices[i++] = lower;
+        indices[i++] = lower + 1;
+      }
+    }
+  }
+
+  glGenBuffers(1, &g_sphereBuffer);
+  glGenBuffers(1, &g_sphereIndexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_sphereIndexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * SPHERE_INDICES * maxSpheres, indices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  free(indices);
+}
+
+void updateSpheres(const Vertex *vertices, GLint side, GLint stride, GLfloat scale)
+{
+  SphereVertex *out = g_sphereBatch;
+  const Vertex *vertex = NULL;
+  GLint x = 0;
+  GLint y = 0;
+  GLint i = 0;
+  GLint k = 0;
+
+  g_sphereCount = 0;
+  for (y = 0; y < side; y = NEXT_SPHERE_POINT(y, stride, side))
+  {
+    for (x = 0; (x < side) && (g_sphereCount < g_maxSpheres); x = NEXT_SPHERE_POINT(x, stride, side), g_sphereCount++)
+    {
+      vertex = &vertices[y * side + x];
+      for (i = 0; i < SPHERE_VERTICES; i++, out++)
+      {
+        for (k = 0; k < 3; k++)
+        {
+          out->position[k] = vertex->position[k] + scale * g_sphereTemplate[i].position[k];
+          out->normal[k] = g_sphereTemplate[i].normal[k];
+        }
+        out->color[0] = vertex->color[0];
+        out->color[1] = vertex->color[1];
+        out->color[2] = vertex->color[2];
+        out->color[3] = vertex->color[3];
+      }
+    }
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, g_sphereBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(SphereVertex) * SPHERE_VERTICES * g_sphereCount, g_sphereBatch, GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void drawSphere(const CGColor3f color)
+void drawSpheres(void)
 {
   /* Material der Kugel*/
   float matShininess[] = {128.0f};
@@ -240,31 +366,31 @@ void drawSphere(const CGColor3f color)
   glMaterialfv(GL_FRONT, GL_SPECULAR, temp);
   glMaterialfv(GL_FRONT, GL_SHININESS, matShininess);
 
-  const GLfloat radius = 0.5f;
-
-  glPushMatrix();
+  /* Zeiger und Arrays des Wasser-Mesh sichern, alle Kugeln mit einem Aufruf */
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
   {
-    glRotatef(-90, 1.0f, 0.0f, 0.0f);
-    /* Quadric erzuegen */
-    GLUquadricObj *qobj = gluNewQuadric();
-
-    if (qobj != 0)
-    {
-      glColor3f(color[0], color[1], color[2]);
-      /* Gefuellt darstellen */
-      gluQuadricDrawStyle(qobj, GLU_FILL);
-      /* Scheibe zeichnen */
-      gluSphere(qobj, radius, SLICES, SLICES);
-      gluQuadricNormals(qobj, GLU_SMOOTH);
-      /* Loeschen des Quadrics nicht vergessen */
-      gluDeleteQuadric(qobj);
-    }
-    else
-    {
-      fprintf(stderr, "Erzeugen der Kugeln fehlgeschlagen\n");
-    }
+    glEnableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, g_sphereBuffer);
+    glVertexPointer(3, GL_FLOAT, sizeof(SphereVertex), (const GLvoid *)offsetof(SphereVertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(SphereVertex), (const GLvoid *)offsetof(SphereVertex, normal));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(SphereVertex), (const GLvoid *)offsetof(SphereVertex, color));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_sphereIndexBuffer);
+
+    glDrawElements(GL_TRIANGLES, SPHERE_INDICES * g_sphereCount, GL_UNSIGNED_INT, (const GLvoid *)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
   }
-  glPopMatrix();
+  glPopClientAttrib();
+}
+
+void freeSphereMesh(void)
+{
+  glDeleteBuffers(1, &g_sphereBuffer);
+  glDeleteBuffers(1, &g_sphereIndexBuffer);
+  free(g_sphereBatch);
+  g_sphereBatch = NULL;
 }
 
 void calcCylinderPoints(void)
@@ -283,192 +409,366 @@ void calcCylinderPoints(void)
 }
 
 /**
- * Zeichnet einen Kreis mit Radius 1 um den Ursprung rum
+ * Setzt die Material-Parameter eines Objekts der Szene
+ * @param color Farbe des Materials
+ * @param shininess Glanzexponent
  */
-static void drawCircle(void)
+static void setMaterial(const CGColor3f color, GLfloat shininess)
 {
-  GLint i = 0;
-  GLfloat theta = 0.0f;
-  glNormal3f(0.0, 1.0f, 0.0f);
-  glBegin(GL_POLYGON);
-  {
-    glColor3f(1.0f, 1.0f, 1.0f);
-    for (i = 0; i < NUM_SLICES_ISLAND; i++)
-    {
-      theta = 2 * M_PI - ((float)i / NUM_SLICES_ISLAND) * 2 * M_PI;
-      glTexCoord2f(cos(theta), sin(theta));
-      glVertex3f(circlePoints[i][0], circlePoints[i][1], circlePoints[i][2]);
-    }
-  }
-  glEnd();
+  glMaterialfv(GL_FRONT, GL_AMBIENT, color);
+  glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
+  glMaterialfv(GL_FRONT, GL_SPECULAR, color);
+  glMaterialfv(GL_FRONT, GL_SHININESS, &shininess);
 }
 
-void drawCylinder(const CGColor3f color, GLfloat lowerRadius, GLfloat upperRadius, GLfloat height, GLboolean texturing)
+/**
+ * Haengt einen Vertex an die Geometrie an
+ * @param builder Geometrie, an die angehaengt wird
+ * @param position Position
+ * @param normal Normale
+ * @param s, t Texturkoordinaten
+ * @return Index des Vertex
+ */
+static GLushort addPropVertex(PropBuilder *builder, const CGVector3f position, const CGVector3f normal, GLfloat s, GLfloat t)
 {
-  /* Material des Wuerfels */
-  float matShininess[] = {5.0f};
-  CGColor3f temp = {0.75f, 0.75f, 0.75f};
-  /* Setzen der Material-Parameter */
-  glMaterialfv(GL_FRONT, GL_AMBIENT, temp);
-  glMaterialfv(GL_FRONT, GL_DIFFUSE, temp);
-  glMaterialfv(GL_FRONT, GL_SPECULAR, temp);
-  glMaterialfv(GL_FRONT, GL_SHININESS, matShininess);
-
-  glPushMatrix();
-  {
-    glRotatef(-90, 1.0f, 0.0f, 0.0f);
-    /* Quadric erzuegen */
-    GLUquadricObj *qobj = gluNewQuadric();
+  PropVertex *vertex = &builder->vertices[builder->vertexCount];
+
+  vertex->position[0] = position[0];
+  vertex->position[1] = position[1];
+  vertex->position[2] = position[2];
+  vertex->normal[0] = normal[0];
+  vertex->normal[1] = normal[1];
+  vertex->normal[2] = normal[2];
+  vertex->texCoord[0] = s;
+  vertex->texCoord[1] = t;
+  return (GLushort)builder->vertexCount++;
+}
 
-    if (qobj != 0)
-    {
+/**
+ * Haengt ein Viereck aus zwei Dreiecken an, die Ecken gegen den Uhrzeigersinn
+ */
+static void addPropQuad(PropBuilder *builder, GLushort a, GLushort b, GLushort c, GLushort d)
+{
+  GLushort *indices = builder->indices + builder->indexCount;
+
+  indices[0] = a;
+  indices[1] = b;
+  indices[2] = c;
+  indices[3] = a;
+  indices[4] = c;
+  indices[5] = d;
+  builder->indexCount += 6;
+}
 
-      glColor3f(color[0], color[1], color[2]);
-      /* Gefuellt darstellen */
-      gluQuadricDrawStyle(qobj, GLU_FILL);
+/**
+ * Tesselliert die Insel aus den vorberechneten Kreispunkten: oberer Kreis als
+ * Faecher und Mantel, beides mit Radius 0.25 und Mittelpunkt im Ursprung.
+ */
+static void addIsland(PropBuilder *builder)
+{
+  const CGVector3f up = {0.0f, 1.0f, 0.0f};
+  CGVector3f position;
+  GLushort first = (GLushort)builder->vertexCount;
+  GLushort top = 0;
+  GLint i = 0;
 
-      gluQuadricTexture(qobj, texturing);
-      /* Scheibe zeichnen */
-      gluCylinder(qobj, lowerRadius, upperRadius, height, NUM_SLICES_LIGHTHOUSE, NUM_SLICES_LIGHTHOUSE);
+  //Oberer Kreis, die Kreispunkte laufen von oben gesehen gegen den Uhrzeigersinn
+  for (i = 0; i < NUM_SLICES_ISLAND; i++)
+  {
+    position[0] = ISLAND_RADIUS * circlePoints[i][0];
+    position[1] = ISLAND_HEIGHT / 2.0f;
+    position[2] = ISLAND_RADIUS * circlePoints[i][2];
+    addPropVertex(builder, position, up, circlePoints[i][0], circlePoints[i][2]);
+  }
+  for (i = 1; i < NUM_SLICES_ISLAND - 1; i++)
+  {
+    builder->indices[builder->indexCount++] = first;
+    builder->indices[builder->indexCount++] = first + i;
+    builder->indices[builder->indexCount++] = first + i + 1;
+  }
 
-      gluQuadricNormals(qobj, GLU_SMOOTH);
-      /* Loeschen des Quadrics nicht vergessen */
-      gluDeleteQuadric(qobj);
-    }
-    else
+  //Mantel, je ein Punkt auf dem oberen und dem unteren Kreis
+  for (i = 0; i <= NUM_SLICES_ISLAND; i++)
+  {
+    position[0] = ISLAND_RADIUS * circlePoints[i % NUM_SLICES_ISLAND][0];
+    position[1] = ISLAND_HEIGHT / 2.0f;
+    position[2] = ISLAND_RADIUS * circlePoints[i % NUM_SLICES_ISLAND][2];
+    top = addPropVertex(builder, position, circlePoints[i % NUM_SLICES_ISLAND],
+                        circlePoints[i % NUM_SLICES_ISLAND][2], circlePoints[i % NUM_SLICES_ISLAND][0]);
+    position[1] = -ISLAND_HEIGHT / 2.0f;
+    addPropVertex(builder, position, circlePoints[i % NUM_SLICES_ISLAND],
+                  circlePoints[i % NUM_SLICES_ISLAND][2], circlePoints[i % NUM_SLICES_ISLAND][0]);
+    if (i > 0)
     {
-      fprintf(stderr, "Erzeugen des Zylinders fehlgeschlagen\n");
+      addPropQuad(builder, top - 2, top - 1, top + 1, top);
     }
   }
-  glPopMatrix();
 }
 
-void drawIsland(void)
+/**
+ * Tesselliert den Mantel eines Kegelstumpfes um die y-Achse mit
+ * NUM_SLICES_LIGHTHOUSE Segmenten und Ringen (wie zuvor gluCylinder).
+ * @param lowerRadius Radius des unteren Kreises
+ * @param upperRadius Radius des oberen Kreises
+ * @param bottom Hoehe des unteren Kreises
+ * @param height Hoehe des Mantels
+ * @param texturing ob Texturkoordinaten erzeugt werden, sonst liegen alle auf (0, 0)
+ */
+static void addLathe(PropBuilder *builder, GLfloat lowerRadius, GLfloat upperRadius, GLfloat bottom, GLfloat height,
+                     GLboolean texturing)
 {
-  GLint i = 0;
+  GLushort first = (GLushort)builder->vertexCount;
+  GLfloat slope = lowerRadius - upperRadius;
+  GLfloat length = sqrtf(height * height + slope * slope);
+  GLfloat radius = 0.0f;
   GLfloat theta = 0.0f;
-  //Oberer Kreis
-  glPushMatrix();
+  GLint ring = 0;
+  GLint slice = 0;
+  CGVector3f position;
+  CGVector3f normal;
+
+  for (ring = 0; ring <= NUM_SLICES_LIGHTHOUSE; ring++)
   {
-    glTranslatef(0.0f, ISLAND_HEIGHT / 2.0f, 0.0f);
-    glScalef(0.25f, 1.0f, 0.25f);
-    drawCircle();
+    radius = lowerRadius + (upperRadius - lowerRadius) * ring / NUM_SLICES_LIGHTHOUSE;
+    for (slice = 0; slice <= NUM_SLICES_LIGHTHOUSE; slice++)
+    {
+      theta = 2.0f * M_PI * slice / NUM_SLICES_LIGHTHOUSE;
+      position[0] = radius * sinf(theta);
+      position[1] = bottom + height * ring / NUM_SLICES_LIGHTHOUSE;
+      position[2] = radius * cosf(theta);
+      normal[0] = height * sinf(theta) / length;
+      normal[1] = slope / length;
+      normal[2] = height * cosf(theta) / length;
+      //die Textur steht wie bei gluCylinder des von oben nach unten gezeichneten Turms
+      addPropVertex(builder, position, normal, texturing ? (GLfloat)slice / NUM_SLICES_LIGHTHOUSE : 0.0f,
+                    texturing ? 1.0f - (GLfloat)ring / NUM_SLICES_LIGHTHOUSE : 0.0f);
+    }
   }
-  glPopMatrix();
 
-  //Tube als TRIANGLE_STRIP, abwechselnd ein Punkt auf dem oberen und ein PUnkt auf dem unteren Kreis
-  glPushMatrix();
+  for (ring = 0; ring < NUM_SLICES_LIGHTHOUSE; ring++)
   {
-    glScalef(0.25f, 1.0f, 0.25f);
-    glBegin(GL_TRIANGLE_STRIP);
+    for (slice = 0; slice < NUM_SLICES_LIGHTHOUSE; slice++)
     {
-      glColor3f(1.0f, 1.0f, 1.0f);
-      for (i = 0; i <= NUM_SLICES_ISLAND; i++)
-      {
-        theta = 2 * M_PI - ((float)i / NUM_SLICES_ISLAND) * 2 * M_PI;
-        glNormal3f(cos(theta), 0.0f, sin(theta));
-        glTexCoord2f(sin(theta), cos(theta));
-        glVertex3f(circlePoints[i % NUM_SLICES_ISLAND][0], circlePoints[i % NUM_SLICES_ISLAND][1] + ISLAND_HEIGHT / 2.0f, circlePoints[i % NUM_SLICES_ISLAND][2]);
-        glTexCoord2f(sin(theta), cos(theta));
-        glVertex3f(circlePoints[i % NUM_SLICES_ISLAND][0], circlePoints[i % NUM_SLICES_ISLAND][1] - ISLAND_HEIGHT / 2.0f, circlePoints[i % NUM_SLICES_ISLAND][2]);
-      }
+      GLushort lower = first + ring * (NUM_SLICES_LIGHTHOUSE + 1) + slice;
+      GLushort upper = lower + NUM_SLICES_LIGHTHOUSE + 1;
+      addPropQuad(builder, lower, lower + 1, upper + 1, upper);
     }
-    glEnd();
   }
-  glPopMatrix();
+}
 
-  //Anzeigen der Normalen des Zylinders
-  if (showNormal)
+/**
+ * Tesselliert einen Quader als Teil eines Bootes: ein Wuerfel mit
+ * Kantenlaenge 1 und der Unterseite im Ursprung, dessen Seiten aus
+ * NUM_QUADS x NUM_QUADS Quadraten bestehen (fuer die Beleuchtung pro Vertex),
+ * wird skaliert, um die y-Achse gedreht und verschoben.
+ * @param part Lage des Quaders im Boot
+ */
+static void addBoatPart(PropBuilder *builder, const BoatPart *part)
+{
+  /* Normale und erste Richtung in der Flaeche je Seite, die zweite ist n x u */
+  static const GLfloat faces[6][2][3] = {{{0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+                                         {{0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+                                         {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+                                         {{-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+                                         {{0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}},
+                                         {{0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}}};
+  GLfloat cosAngle = cosf(DEG2RAD(part->angle));
+  GLfloat sinAngle = sinf(DEG2RAD(part->angle));
+  const GLfloat *n = NULL;
+  const GLfloat *u = NULL;
+  GLfloat v[3];
+  GLfloat local[3];
+  CGVector3f position;
+  CGVector3f normal;
+  GLushort first = 0;
+  GLint face = 0;
+  GLint s = 0;
+  GLint t = 0;
+  GLint k = 0;
+
+  for (face = 0; face < 6; face++)
   {
-    glPushMatrix();
+    n = faces[face][0];
+    u = faces[face][1];
+    v[0] = n[1] * u[2] - n[2] * u[1];
+    v[1] = n[2] * u[0] - n[0] * u[2];
+    v[2] = n[0] * u[1] - n[1] * u[0];
+    normal[0] = cosAngle * n[0] + sinAngle * n[2];
+    normal[1] = n[1];
+    normal[2] = -sinAngle * n[0] + cosAngle * n[2];
+
+    first = (GLushort)builder->vertexCount;
+    for (t = 0; t <= NUM_QUADS; t++)
     {
-      glTranslatef(0.0f, ISLAND_HEIGHT / 2.0f - 0.01, 0.0f);
-      glBegin(GL_LINES);
+      for (s = 0; s <= NUM_QUADS; s++)
       {
-        glColor3f(1.0f, 1.0f, 1.0f);
-        for (i = 0; i <= NUM_SLICES_ISLAND; i++)
+        for (k = 0; k < 3; k++)
         {
-          glPushMatrix();
-          {
-            theta = 2 * M_PI - ((float)i / NUM_SLICES_ISLAND) * 2 * M_PI;
-            glTranslatef(circlePoints[i % NUM_SLICES_ISLAND][0], circlePoints[i % NUM_SLICES_ISLAND][1] + ISLAND_HEIGHT / 2.0f, circlePoints[i % NUM_SLICES_ISLAND][2]);
-            glVertex3f(cos(theta) / 3.0f, 0.0f, sin(theta) / 3.0f);
-            glVertex3f(0.0f, 0.0f, 0.0f);
-          }
-          glPopMatrix();
+          local[k] = part->scale[k] * (0.5f * n[k] + ((GLfloat)s / NUM_QUADS - 0.5f) * u[k] +
+                                       ((GLfloat)t / NUM_QUADS - 0.5f) * v[k] + (k == 1 ? 0.5f : 0.0f));
         }
+        position[0] = part->offset[0] + cosAngle * local[0] + sinAngle * local[2];
+        position[1] = part->offset[1] + local[1];
+        position[2] = part->offset[2] - sinAngle * local[0] + cosAngle * local[2];
+        addPropVertex(builder, position, normal, 0.0f, 0.0f);
+      }
+    }
+
+    //u x v = n, die Ecken (s, t), (s + 1, t), (s + 1, t + 1) laufen von aussen gesehen gegen den Uhrzeigersinn
+    for (t = 0; t < NUM_QUADS; t++)
+    {
+      for (s = 0; s < NUM_QUADS; s++)
+      {
+        GLushort corner = first + t * (NUM_QUADS + 1) + s;
+        addPropQuad(builder, corner, corner + 1, corner + NUM_QUADS + 2, corner + NUM_QUADS + 1);
       }
-      glEnd();
     }
-    glPopMatrix();
   }
 }
 
-void drawBoats(void)
+/**
+ * Zeichnet ein Objekt aus den Pufferobjekten der Szenerie in der aktuellen
+ * Transformation. Zeiger und Arrays des Wasser-Mesh bleiben erhalten.
+ * @param prop zu zeichnendes Objekt
+ * @param color Farbe des Objekts
+ */
+static void drawProp(Prop prop, const CGColor3f color)
 {
-  glPushName(boat1);
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
   {
-    //Rumpf
-    glPushMatrix();
-    {
-      glTranslatef(BOAT_1_X, getBoatCHeight(0), BOAT_1_Z);
-      glScalef(0.35f, 0.1f, 0.25f);
-      drawCube(showNormal);
-    }
-    glPopMatrix();
+    glDisableClientState(GL_COLOR_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glColor3fv(color);
+    glBindBuffer(GL_ARRAY_BUFFER, g_propBuffer);
+    glVertexPointer(3, GL_FLOAT, sizeof(PropVertex), (const GLvoid *)offsetof(PropVertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(PropVertex), (const GLvoid *)offsetof(PropVertex, normal));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(PropVertex), (const GLvoid *)offsetof(PropVertex, texCoord));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_propIndexBuffer);
+    glDrawElements(GL_TRIANGLES, g_props[prop].count, GL_UNSIGNED_SHORT,
+                   (const GLvoid *)(sizeof(GLushort) * g_props[prop].first));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  glPopClientAttrib();
+}
 
-    //Spitze
-    glPushMatrix();
-    {
-      glTranslatef(BOAT_1_X - 0.175f, getBoatCHeight(0), BOAT_1_Z);
-      glRotatef(45, 0.0f, 1.0f - 0.00001f, 0.0f);
-      glScalef(0.175f, 0.1f, 0.175f);
-      drawCube(showNormal);
-    }
-    glPopMatrix();
+void initPropMeshes(void)
+{
+  PropBuilder builder;
+  GLint i = 0;
 
-    //Fracht
-    glPushMatrix();
-    {
-      glTranslatef(BOAT_1_X + 0.1f, getBoatCHeight(0) + 0.075f, BOAT_1_Z);
-      glScalef(0.15f, 0.15f, 0.15f);
-      drawCube(showNormal);
-    }
-    glPopMatrix();
+  builder.vertices = malloc(sizeof(PropVertex) * PROP_VERTICES);
+  builder.indices = malloc(sizeof(GLushort) * PROP_INDICES);
+  builder.vertexCount = 0;
+  builder.indexCount = 0;
+  if ((builder.vertices == NULL) || (builder.indices == NULL))
+  {
+    exit(1);
   }
-  glPopName();
 
-  glPushName(boat2);
+  g_props[propIsland].first = builder.indexCount;
+  addIsland(&builder);
+  g_props[propIsland].count = builder.indexCount - g_props[propIsland].first;
+
+  g_props[propLighthouseTower].first = builder.indexCount;
+  addLathe(&builder, LIGHTHOUSE_RADIUS, LIGHTHOUSE_RADIUS, 0.0f, LIGHTHOUSE_HEIGHT, GL_TRUE);
+  g_props[propLighthouseTower].count = builder.indexCount - g_props[propLighthouseTower].first;
+
+  g_props[propLighthouseRoof].first = builder.indexCount;
+  addLathe(&builder, LIGHTHOUSE_RADIUS, 0.0f, LIGHTHOUSE_HEIGHT, LIGHTHOUSE_HEIGHT / 4.0f, GL_FALSE);
+  g_props[propLighthouseRoof].count = builder.indexCount - g_props[propLighthouseRoof].first;
+
+  g_props[propBoat].first = builder.indexCount;
+  for (i = 0; i < AMOUNT_BOAT_PARTS; i++)
   {
-    //Rumpf
-    glPushMatrix();
-    {
-      glTranslatef(BOAT_2_X, getBoatCHeight(1), BOAT_2_Z);
-      glScalef(0.35f, 0.1f, 0.25f);
-      drawCube(showNormal);
-    }
-    glPopMatrix();
+    addBoatPart(&builder, &BOAT_PARTS[i]);
+  }
+  g_props[propBoat].count = builder.indexCount - g_props[propBoat].first;
+
+  glGenBuffers(1, &g_propBuffer);
+  glGenBuffers(1, &g_propIndexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, g_propBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(PropVertex) * builder.vertexCount, builder.vertices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_propIndexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * builder.indexCount, builder.indices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  free(builder.vertices);
+  free(builder.indices);
+}
 
-    //Spitze
-    glPushMatrix();
+void freePropMeshes(void)
+{
+  glDeleteBuffers(1, &g_propBuffer);
+  glDeleteBuffers(1, &g_propIndexBuffer);
+}
+
+void drawIsland(void)
+{
+  GLint i = 0;
+
+  setMaterial(COLOR_GRAY, 5.0f);
+  drawProp(propIsland, COLOR_WHITE);
+
+  //Anzeigen der Normalen des Zylinders
+  if (showNormal)
+  {
+    //knapp unter dem oberen Rand vom Mantel nach aussen
+    glBegin(GL_LINES);
     {
-      glTranslatef(BOAT_2_X - 0.175f, getBoatCHeight(1), BOAT_2_Z);
-      glRotatef(45, 0.0f, 1.0f, 0.0f);
-      glScalef(0.175f, 0.1f - 0.00001f, 0.175f);
-      drawCube(showNormal);
+      glColor3f(1.0f, 1.0f, 1.0f);
+      for (i = 0; i < NUM_SLICES_ISLAND; i++)
+      {
+        glVertex3f(circlePoints[i][0] * (ISLAND_RADIUS + 1.0f / 3.0f), ISLAND_HEIGHT / 2.0f - 0.01f,
+                   circlePoints[i][2] * (ISLAND_RADIUS + 1.0f / 3.0f));
+        glVertex3f(circlePoints[i][0] * ISLAND_RADIUS, ISLAND_HEIGHT / 2.0f - 0.01f, circlePoints[i][2] * ISLAND_RADIUS);
+      }
     }
-    glPopMatrix();
+    glEnd();
+  }
+}
 
-    //Fracht
+void drawLighthouse(void)
+{
+  setMaterial(COLOR_GRAY, 5.0f);
+  drawProp(propLighthouseTower, COLOR_WHITE);
+  drawProp(propLighthouseRoof, COLOR_RED);
+}
+
+void drawBoats(void)
+{
+  static const GLfloat positions[AMOUNT_BOATS][2] = {{BOAT_1_X, BOAT_1_Z}, {BOAT_2_X, BOAT_2_Z}};
+  GLint boat = 0;
+  GLint i = 0;
+
+  //die Boote sind einfarbig, die zuletzt gebundene Textur gehoert nicht zu ihnen
+  glDisable(GL_TEXTURE_2D);
+  setMaterial(COLOR_BROWN, 100.0f);
+  for (boat = 0; boat < AMOUNT_BOATS; boat++)
+  {
     glPushMatrix();
     {
-      glTranslatef(BOAT_2_X + 0.1f, getBoatCHeight(1) + 0.075f, BOAT_2_Z);
-      glScalef(0.15f, 0.15f, 0.15f);
-      drawCube(showNormal);
+      glTranslatef(positions[boat][0], getBoatCHeight(boat), positions[boat][1]);
+      drawProp(propBoat, COLOR_BROWN);
+
+      if (showNormal)
+      {
+        for (i = 0; i < AMOUNT_BOAT_PARTS; i++)
+        {
+          glPushMatrix();
+          {
+            glTranslatef(BOAT_PARTS[i].offset[0], BOAT_PARTS[i].offset[1], BOAT_PARTS[i].offset[2]);
+            glRotatef(BOAT_PARTS[i].angle, 0.0f, 1.0f, 0.0f);
+            glScalef(BOAT_PARTS[i].scale[0], BOAT_PARTS[i].scale[1], BOAT_PARTS[i].scale[2]);
+            drawCubeNormals();
+          }
+          glPopMatrix();
+        }
+      }
     }
     glPopMatrix();
   }
-  glPopName();
 }
 
 GLboolean getShowNormal(void)
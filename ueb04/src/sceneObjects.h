@@ -19,10 +19,31 @@ void setShowNormal(GLboolean normal);
 GLfloat getIslandHeight(void);
 
 /**
- * Zeichnet eine Kugel in der uebergebenen Farbe
- * @param color Farbe der Kugel
+ * Tesselliert einmalig eine Kugel und erzeugt die Pufferobjekte fuer alle Kugeln
+ * @param maxSpheres Hoechstzahl der gleichzeitig gezeichneten Kugeln
  */
-void drawSphere(const CGColor3f color);
+void initSphereMesh(GLint maxSpheres);
+
+/**
+ * Legt an jedem stride-ten und dem letzten Punkt pro Zeile und Spalte eine
+ * Kugel in dessen Farbe ab (verschobene und skalierte Kopien der einmal
+ * tessellierten Kugel) und laedt alle Kugeln in ein gemeinsames Pufferobjekt.
+ * @param vertices Vertizes des Gitters, zeilenweise
+ * @param side Anzahl der Punkte pro Seite
+ * @param stride Abstand der Punkte mit Kugel, hoechstens maxSpheres Kugeln insgesamt
+ * @param scale Skalierung der Kugel (Radius 0.5)
+ */
+void updateSpheres(const Vertex *vertices, GLint side, GLint stride, GLfloat scale);
+
+/**
+ * Zeichnet die mit updateSpheres abgelegten Kugeln mit einem Aufruf
+ */
+void drawSpheres(void);
+
+/**
+ * Gibt die Pufferobjekte der Kugel frei
+ */
+void freeSphereMesh(void);
 
 /**
  * Berechnet die Punkte auf einem Kreis und speichert sie im circlePoints Array
@@ -30,18 +51,28 @@ void drawSphere(const CGColor3f color);
 void calcCylinderPoints(void);
 
 /**
- * Zeichnet ein Zylinder mit der uebergebenen Farbe
- * @param color Farbe des Zylinder
- * @param lowerRadius Radius des unteren Kreises
- * @param upperRadius Radius des oberen Kreises
- * @param heigth Hoehe des Zylinder
- * @param texturing ob der Zylinder texturiert werden soll
+ * Tesselliert Insel, Leuchtturm und Boote einmalig in gemeinsame statische
+ * Pufferobjekte. Setzt die Kreispunkte (calcCylinderPoints) voraus.
  */
-void drawCylinder(const CGColor3f color, GLfloat lowerRadius, GLfloat upperRadius, GLfloat height, GLboolean texturing);
+void initPropMeshes(void);
+
+/**
+ * Gibt die Pufferobjekte von Insel, Leuchtturm und Booten frei
+ */
+void freePropMeshes(void);
 
 /**
  * Zeichnet die Insel in der Mitte
  */
 void drawIsland(void);
 
-void drawBoats(void);
\ No newline at end of file
+/**
+ * Zeichnet den Leuchtturm mit der Unterseite im Ursprung, die Textur
+ * muss vorher gebunden werden
+ */
+void drawLighthouse(void);
+
+/**
+ * Zeichnet beide Boote auf der aktuellen Hoehe des Wassers
+ */
+void drawBoats(void);
@@ -0,0 +1,46 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+/**
+ * @file
+ * SIMD-Schnittstelle.
+ * Makros fuer die Vektorbefehle, mit denen die Rechenkerne mehrere Werte
+ * gleichzeitig verarbeiten. Je nach Zielarchitektur wird AVX (8 Werte),
+ * SSE2 (4 Werte) oder keine Vektorisierung (SIMD_WIDTH 1) verwendet.
+ * Mit F16C gibt es zusaetzlich die Umwandlung von und nach halber
+ * Genauigkeit (IEEE binary16) fuer je 8 Werte.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+#if defined(__AVX__)
+#include <immintrin.h>
+/** Anzahl der Werte, die pro SIMD-Befehl berechnet werden */
+#define SIMD_WIDTH 8
+#define SIMD_FLOAT __m256
+#define SIMD_SET1 _mm256_set1_ps
+#define SIMD_LOAD _mm256_loadu_ps
+#define SIMD_STORE _mm256_storeu_ps
+#define SIMD_ADD _mm256_add_ps
+#define SIMD_SUB _mm256_sub_ps
+#define SIMD_MUL _mm256_mul_ps
+#if defined(__F16C__)
+/** 8 Werte halber Genauigkeit laden und in GLfloat umwandeln bzw. gerundet speichern */
+#define SIMD_HALF 1
+#define SIMD_LOAD_HALF(p) _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(p)))
+#define SIMD_STORE_HALF(p, x) _mm_storeu_si128((__m128i *)(p), _mm256_cvtps_ph((x), _MM_FROUND_TO_NEAREST_INT))
+#endif
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+#define SIMD_FLOAT __m128
+#define SIMD_SET1 _mm_set1_ps
+#define SIMD_LOAD _mm_loadu_ps
+#define SIMD_STORE _mm_storeu_ps
+#define SIMD_ADD _mm_add_ps
+#define SIMD_SUB _mm_sub_ps
+#define SIMD_MUL _mm_mul_ps
+#else
+#define SIMD_WIDTH 1
+#endif
+
+#endif
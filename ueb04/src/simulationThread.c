@@ -0,0 +1,142 @@
+/**
+ * @file
+ * Simulationsthread-Modul.
+ * Das Modul fuehrt die Simulation des Wassers auf einem eigenen Thread aus,
+ * damit ein langsames Bild die Simulation nicht ausbremst und umgekehrt.
+ * Der Thread rechnet einen Takt unter einer Sperre, die der GLUT-Thread nur
+ * fuer seltene Aenderungen am Zustand (Aufloesung, Verfahren, Pause) nimmt.
+ * Die Hoehen fuer das Zeichnen und die gepickten Punkte werden dagegen ohne
+ * Sperre ausgetauscht (siehe Logik-Modul).
+ *
+ * Unter Windows steht kein pthread zur Verfuegung, dort laeuft die Simulation
+ * wie bisher auf dem GLUT-Thread.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <stdio.h>
+
+#ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+/* ---- Eigene Header einbinden ---- */
+#include "simulationThread.h"
+#include "atomics.h"
+
+/** Anzahl der Takte pro Sekunde, in denen der Simulationsthread rechnet */
+#define SIMULATION_TICKS_PS (200)
+
+#ifndef WIN32
+/** Der Simulationsthread */
+static pthread_t g_thread;
+
+/** Schuetzt den Zustand der Simulation, wird fuer jeden Takt gehalten */
+static pthread_mutex_t g_simulationMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Funktion, die in jedem Takt aufgerufen wird */
+static SimulationTick g_tick = NULL;
+
+/** Flag zum Beenden des Threads */
+static GLboolean g_shutdown = GL_FALSE;
+
+/** Laeuft der Thread? */
+static GLboolean g_running = GL_FALSE;
+
+/**
+ * Liefert die Zeit einer monotonen Uhr
+ * @return Zeit in Sekunden
+ */
+static double now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**
+ * Hauptfunktion des Simulationsthreads: ruft im festen Takt die
+ * Simulationsfunktion auf und schlaeft bis zum naechsten Takt
+ * @param arg unbenutzt
+ * @return immer NULL
+ */
+static void *simulationMain(void *arg)
+{
+  double tickInterval = 1.0 / SIMULATION_TICKS_PS;
+  double lastTime = now();
+  double thisTime = 0.0;
+  double remaining = 0.0;
+  struct timespec pause;
+
+  while (!ATOMIC_LOAD(&g_shutdown))
+  {
+    thisTime = now();
+
+    pthread_mutex_lock(&g_simulationMutex);
+    g_tick(thisTime - lastTime);
+    pthread_mutex_unlock(&g_simulationMutex);
+    lastTime = thisTime;
+
+    //bis zum naechsten Takt schlafen, dauert ein Takt laenger, folgt der naechste sofort
+    remaining = tickInterval - (now() - thisTime);
+    if (remaining > 0.0)
+    {
+      pause.tv_sec = 0;
+      pause.tv_nsec = (long)(remaining * 1e9);
+      nanosleep(&pause, NULL);
+    }
+    else
+    {
+      //wartet der GLUT-Thread auf die Sperre, soll er sie vor dem naechsten Takt bekommen
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+#endif
+
+GLboolean startSimulationThread(SimulationTick tick)
+{
+#ifndef WIN32
+  g_tick = tick;
+  g_shutdown = GL_FALSE;
+  g_running = (pthread_create(&g_thread, NULL, simulationMain, NULL) == 0);
+  if (!g_running)
+  {
+    fprintf(stderr, "Der Simulationsthread konnte nicht erzeugt werden\n");
+  }
+  return g_running;
+#else
+  (void)tick;
+  return GL_FALSE;
+#endif
+}
+
+void lockSimulation(void)
+{
+#ifndef WIN32
+  pthread_mutex_lock(&g_simulationMutex);
+#endif
+}
+
+void unlockSimulation(void)
+{
+#ifndef WIN32
+  pthread_mutex_unlock(&g_simulationMutex);
+#endif
+}
+
+void stopSimulationThread(void)
+{
+#ifndef WIN32
+  if (g_running)
+  {
+    ATOMIC_STORE(&g_shutdown, GL_TRUE);
+    pthread_join(g_thread, NULL);
+    g_running = GL_FALSE;
+  }
+#endif
+}
@@ -0,0 +1,48 @@
+#ifndef __SIMULATIONTHREAD_H__
+#define __SIMULATIONTHREAD_H__
+/**
+ * @file
+ * Schnittstelle des Simulationsthread-Moduls.
+ * Das Modul fuehrt die Simulation des Wassers auf einem eigenen Thread aus,
+ * unabhaengig vom Zeichnen auf dem GLUT-Thread. Der Thread ruft in festem Takt
+ * eine Funktion mit der seit dem letzten Aufruf vergangenen Zeit auf.
+ * Aenderungen am Zustand der Simulation von aussen (z.B. der Aufloesung)
+ * muessen zwischen lockSimulation und unlockSimulation erfolgen.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/**
+ * Funktion, die der Simulationsthread in jedem Takt aufruft
+ * @param interval seit dem letzten Aufruf vergangene Zeit in Sekunden
+ */
+typedef void (*SimulationTick)(double interval);
+
+/**
+ * Startet den Simulationsthread.
+ * @param tick Funktion, die in jedem Takt aufgerufen wird (bei gehaltener Sperre)
+ * @return GL_TRUE, wenn der Thread laeuft; ohne Threads (Windows) GL_FALSE,
+ *         dann muss der Aufrufer die Simulation selbst anstossen
+ */
+GLboolean startSimulationThread(SimulationTick tick);
+
+/**
+ * Haelt den Simulationsthread an: kehrt zurueck, sobald kein Takt mehr
+ * laeuft, bis zum Aufruf von unlockSimulation beginnt kein neuer Takt
+ */
+void lockSimulation(void);
+
+/**
+ * Gibt den mit lockSimulation angehaltenen Simulationsthread wieder frei
+ */
+void unlockSimulation(void);
+
+/**
+ * Beendet den Simulationsthread und wartet auf das Ende des laufenden Taktes
+ */
+void stopSimulationThread(void);
+
+#endif
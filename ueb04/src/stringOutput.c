@@ -8,6 +8,9 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+/* GLEW muss vor allen anderen OpenGL-Headern eingebunden werden */
+#include <GL/glew.h>
+
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #else
@@ -14,6 +14,9 @@
 #include <windows.h>
 #endif
 
+/* GLEW muss vor allen anderen OpenGL-Headern eingebunden werden */
+#include <GL/glew.h>
+
 #ifdef __APPLE__
 #include <OpenGL/glu.h>
 #else
@@ -24,26 +27,16 @@
 
 /* ---- Eigene Header einbinden ---- */
 #include "texture.h"
+#include "textureLoader.h"
 #include "debugGL.h"
 
-/* Bibliothek um Bilddateien zu laden. Es handelt sich um eine
- * Bibliothek, die sowohl den Header als auch die Quelle in einer Datei
- * bereitstellt. Die Quelle kann durch die Definition des Makros
- * STB_IMAGE_IMPLEMENTATION eingebunden werden. Genauere Informationen
- * sind der "stb_image.h" zu entnehmen.
- *
- * Quelle: https://github.com/nothings/stb */
- // define global functions as static inline
-#define STB_IMAGE_STATIC
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>  // Bibliothek um Bilder zu laden
-							// Quelle: https://github.com/nothings/stb
-
 /* ---- Typen ---- */
 typedef struct
 {
   GLuint id;
   char *filename;
+  /* Laufender Ladevorgang, NULL sobald die Textur hochgeladen ist */
+  TextureLoad *load;
 } Texture;
 
 /* ---- Konstanten ---- */
@@ -93,12 +86,6 @@ initTextureArray (void)
   return (GLGETERROR == GL_NO_ERROR);
 }
 
-void
-bindTexture (TexName texture)
-{
-  glBindTexture (GL_TEXTURE_2D, g_textures[texture].id);
-}
-
 static unsigned int
 calculateGLBitmapMode (int n)
 {
@@ -118,52 +105,108 @@ calculateGLBitmapMode (int n)
 }
 
 /**
- * Laedt die Texturen mit der stb_image.h Bibliothek
+ * Prueft, ob eine Kantenlaenge eine Zweierpotenz ist
+ * @param size Kantenlaenge
+ * @return 1, wenn size eine Zweierpotenz ist, sonst 0
+ */
+static int
+isPowerOfTwo (int size)
+{
+  return (size > 0) && ((size & (size - 1)) == 0);
+}
+
+/**
+ * Laedt das fertig geladene Bild einer Textur mit allen Mip-Stufen in die
+ * gebundene Textur hoch und gibt den Ladevorgang frei.
+ * @param texture Textur mit abgeschlossenem Ladevorgang
+ */
+static void
+uploadTexture (Texture *texture)
+{
+  const MipChain *mips = getTextureMips (texture->load);
+  int level;
+
+  if (mips != NULL)
+    {
+      /* Die Zeilen der Stufen liegen ohne Auffuellung hintereinander */
+      glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+
+      if (GLEW_VERSION_2_0
+          || (isPowerOfTwo (mips->width) && isPowerOfTwo (mips->height)))
+        {
+          for (level = 0; level < mips->levels; level++)
+            {
+              glTexImage2D (GL_TEXTURE_2D, level, mips->channels,
+                            mips->width >> level ? mips->width >> level : 1,
+                            mips->height >> level ? mips->height >> level : 1,
+                            0, calculateGLBitmapMode (mips->channels),
+                            GL_UNSIGNED_BYTE, mips->pixels[level]);
+            }
+        }
+      else
+        {
+          /* Ohne NPOT-Texturen skaliert GLU auf eine Zweierpotenz */
+          gluBuild2DMipmaps (GL_TEXTURE_2D,
+                             mips->channels,
+                             mips->width,
+                             mips->height,
+                             calculateGLBitmapMode (mips->channels),
+                             GL_UNSIGNED_BYTE, mips->pixels[0]);
+        }
+
+      glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+
+      glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+      glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+      glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      /* Beide Wege legen alle Stufen an, verkleinert wird trilinear */
+      glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                       GL_LINEAR_MIPMAP_LINEAR);
+    }
+  else
+    {
+      INFO (("Textur %s konnte nicht geladen werden!\n", texture->filename));
+    }
+
+  finishTextureLoad (texture->load);
+  texture->load = NULL;
+}
+
+void
+bindTexture (TexName texture)
+{
+  glBindTexture (GL_TEXTURE_2D, g_textures[texture].id);
+
+  /* Bis das Bild im Hintergrund geladen ist, bleibt die Textur leer */
+  if ((g_textures[texture].load != NULL)
+      && pollTextureLoad (g_textures[texture].load))
+    {
+      uploadTexture (&g_textures[texture]);
+    }
+}
+
+/**
+ * Startet das Laden aller Texturen im Hintergrund. Hochgeladen wird jede
+ * Textur beim ersten Binden, nachdem ihr Bild fertig geladen ist.
  * @return Fehlercode
- */ 
+ */
 static int
 loadTextures (void)
 {
-    int i;
-    
-    unsigned char *data;
-    int width, height;
-    int channels;
-    
-    if (initTextureArray ())
-      {
-        /* Alle Texturen nacheinander laden. */
-        for (i = 0; i < TEX_COUNT; i++)
-          {
-            data = stbi_load (g_textures[i].filename, &width, &height, &channels, 0);
-      
-            if (data != NULL)
-              {
-                glBindTexture (GL_TEXTURE_2D, g_textures[i].id);
-      
-                gluBuild2DMipmaps (GL_TEXTURE_2D,
-                                  channels,
-                                  width,
-                                  height,
-                                  calculateGLBitmapMode (channels),
-                                  GL_UNSIGNED_BYTE, data);
-      
-                glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-                glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      
-                stbi_image_free (data);
-              }
-            else
-              {
-                INFO (("Textur %s konnte nicht geladen werden!\n", g_textures[i].filename));
-                return 0;
-              }
-          }
-      
-        /* Alles in Ordnung? */
-        return (GLGETERROR == GL_NO_ERROR);
+  int i;
+
+  if (initTextureArray ())
+    {
+      for (i = 0; i < TEX_COUNT; i++)
+        {
+          g_textures[i].load = startTextureLoad (g_textures[i].filename);
+          if (g_textures[i].load == NULL)
+            {
+              INFO (("Textur %s konnte nicht geladen werden!\n", g_textures[i].filename));
+              return 0;
+            }
+        }
+      return 1;
     }
   else
     {
@@ -172,8 +215,6 @@ loadTextures (void)
     }
 }
 
-
-
 int
 initTextures (void)
 {
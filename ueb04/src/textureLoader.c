@@ -0,0 +1,598 @@
+/**
+ * @file
+ * Texturlader-Modul.
+ * Das Modul laedt Bilddateien auf eigenen Threads und legt zu jeder
+ * Quelldatei einmalig eine Cache-Datei mit allen Mip-Stufen an. Die
+ * Cache-Datei besteht aus einem Kopf und den unkomprimierten Stufen (je auf
+ * 16 Byte ausgerichtet) und ist damit genau das Speicherabbild, das das
+ * Modul beim Laden benoetigt: bei einem Treffer wird sie nur eingeblendet.
+ * Ihr Name ist der FNV-1a-Hashwert der Quelldatei, geaenderte Bilder
+ * erhalten also automatisch eine neue Cache-Datei.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef WIN32
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <direct.h>
+#include <process.h>
+#endif
+
+/* ---- Eigene Header einbinden ---- */
+#include "textureLoader.h"
+#include "simd.h"
+#include "atomics.h"
+
+/* Bibliothek um Bilddateien zu laden (Header und Quelle in einer Datei).
+ * Quelle: https://github.com/nothings/stb */
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+/** Kennung am Anfang jeder Cache-Datei */
+#define MIP_MAGIC "UEB04MIP"
+
+/** Version des Dateiformats, bei Aenderungen erhoehen */
+#define MIP_FORMAT_VERSION (2)
+
+/** Ausrichtung der Stufen in der Cache-Datei in Byte */
+#define MIP_ALIGNMENT (16)
+
+/** Verzeichnis der Cache-Dateien (relativ zum Arbeitsverzeichnis) */
+#define TEXTURE_CACHE_DIR "texcache"
+
+/** Startwert und Multiplikator des 64-Bit-FNV-1a-Hashes */
+#define FNV_OFFSET (14695981039346656037ULL)
+#define FNV_PRIME (1099511628211ULL)
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+/**
+ * Kopf einer Cache-Datei
+ */
+typedef struct
+{
+  char magic[8];
+  uint32_t formatVersion;
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;
+  uint32_t levels;
+  uint32_t reserved;
+  /** Hashwert und Groesse der Quelldatei */
+  uint64_t sourceHash;
+  uint64_t sourceSize;
+  /** Lage der Stufen ab Dateianfang in Byte */
+  uint64_t offset[TEXTURE_MAX_LEVELS];
+} MipHeader;
+
+struct TextureLoad
+{
+  const char *path;
+  /** Bild, gueltig wenn valid gesetzt ist */
+  MipChain chain;
+  GLboolean valid;
+  /** Speicherabbild der Cache-Datei (eingeblendet oder mit malloc erzeugt) */
+  const char *data;
+  size_t size;
+  GLboolean mapped;
+#ifndef WIN32
+  pthread_t thread;
+  GLboolean threaded;
+  /** Ist das Laden beendet? (atomar zwischen den Threads) */
+  GLint done;
+#endif
+};
+
+/**
+ * Berechnet den 64-Bit-FNV-1a-Hashwert eines Speicherbereichs
+ * @param data Speicherbereich
+ * @param size Groesse in Byte
+ * @return Hashwert
+ */
+static uint64_t hashBytes(const unsigned char *data, size_t size)
+{
+  uint64_t hash = FNV_OFFSET;
+  size_t i = 0;
+
+  for (i = 0; i < size; i++)
+  {
+    hash = (hash ^ data[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * Liest eine Datei vollstaendig ein
+ * @param path Pfad der Datei
+ * @param size Groesse der Datei in Byte (Out)
+ * @return Inhalt der Datei (mit free freizugeben), NULL bei Fehler
+ */
+static char *readFile(const char *path, size_t *size)
+{
+  char *data = NULL;
+  long length = 0;
+  FILE *file = fopen(path, "rb");
+
+  if (file == NULL)
+  {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (length > 0)
+  {
+    *size = (size_t)length;
+    data = malloc(*size);
+    if ((data != NULL) && (fread(data, 1, *size, file) != *size))
+    {
+      free(data);
+      data = NULL;
+    }
+  }
+  fclose(file);
+  return data;
+}
+
+/**
+ * Blendet eine Datei nur lesend in den Speicher ein (ohne mmap: liest sie ein)
+ * @param path Pfad der Datei
+ * @param size Groesse der Datei in Byte (Out)
+ * @return Inhalt der Datei, NULL bei Fehler
+ */
+static const char *mapFile(const char *path, size_t *size)
+{
+#ifndef WIN32
+  const char *data = NULL;
+  struct stat info;
+  int file = open(path, O_RDONLY);
+
+  if (file < 0)
+  {
+    return NULL;
+  }
+  if ((fstat(file, &info) == 0) && (info.st_size > 0))
+  {
+    *size = (size_t)info.st_size;
+    data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (data == MAP_FAILED)
+    {
+      data = NULL;
+    }
+  }
+  close(file);
+  return data;
+#else
+  return readFile(path, size);
+#endif
+}
+
+/**
+ * Gibt eine mit mapFile eingeblendete Datei wieder frei
+ * @param data Inhalt der Datei
+ * @param size Groesse der Datei in Byte
+ */
+static void unmapFile(const char *data, size_t size)
+{
+#ifndef WIN32
+  munmap((void *)data, size);
+#else
+  (void)size;
+  free((void *)data);
+#endif
+}
+
+/**
+ * Rundet eine Groesse auf die Ausrichtung der Stufen auf
+ * @param size Groesse in Byte
+ * @return aufgerundete Groesse
+ */
+static size_t alignSize(size_t size)
+{
+  return (size + MIP_ALIGNMENT - 1) & ~(size_t)(MIP_ALIGNMENT - 1);
+}
+
+/**
+ * Berechnet die Kantenlaenge einer Mip-Stufe
+ * @param size Kantenlaenge der Stufe 0
+ * @param level Stufe
+ * @return Kantenlaenge der Stufe
+ */
+static GLint levelSize(GLint size, GLint level)
+{
+  return MAX(1, size >> level);
+}
+
+/**
+ * Traegt Stufenzahl und Lage der Stufen in einen Kopf ein
+ * @param header Kopf mit gesetzten Abmessungen und Kanaelen (In/Out)
+ * @return Groesse der gesamten Datei in Byte
+ */
+static size_t layoutMipFile(MipHeader *header)
+{
+  size_t offset = alignSize(sizeof(MipHeader));
+  GLint width = (GLint)header->width;
+  GLint height = (GLint)header->height;
+  GLint level = 0;
+
+  header->levels = 1;
+  while ((levelSize(width, header->levels - 1) > 1) || (levelSize(height, header->levels - 1) > 1))
+  {
+    header->levels++;
+  }
+
+  for (level = 0; level < (GLint)header->levels; level++)
+  {
+    header->offset[level] = offset;
+    offset += alignSize((size_t)levelSize(width, level) * levelSize(height, level) * header->channels);
+  }
+  return offset;
+}
+
+/**
+ * Prueft, ob ein Speicherabbild eine vollstaendige Cache-Datei zur Quelldatei ist
+ * @param data Speicherabbild
+ * @param size Groesse in Byte
+ * @param sourceHash Hashwert der Quelldatei
+ * @param sourceSize Groesse der Quelldatei in Byte
+ * @return GL_TRUE, wenn die Datei verwendet werden kann
+ */
+static GLboolean isValidMipFile(const char *data, size_t size, uint64_t sourceHash, uint64_t sourceSize)
+{
+  MipHeader header;
+  MipHeader expected;
+
+  if (size < sizeof(MipHeader))
+  {
+    return GL_FALSE;
+  }
+  memcpy(&header, data, sizeof(MipHeader));
+  if ((memcmp(header.magic, MIP_MAGIC, sizeof(header.magic)) != 0) || (header.formatVersion != MIP_FORMAT_VERSION)
+      || (header.sourceHash != sourceHash) || (header.sourceSize != sourceSize)
+      || (header.width < 1) || (header.height < 1) || (header.width > (1u << (TEXTURE_MAX_LEVELS - 1)))
+      || (header.height > (1u << (TEXTURE_MAX_LEVELS - 1))) || (header.channels < 1) || (header.channels > 4))
+  {
+    return GL_FALSE;
+  }
+
+  //die Lage der Stufen ist durch die Abmessungen festgelegt
+  memset(&expected, 0, sizeof(MipHeader));
+  expected.width = header.width;
+  expected.height = header.height;
+  expected.channels = header.channels;
+  return (layoutMipFile(&expected) == size) && (expected.levels == header.levels)
+         && (memcmp(expected.offset, header.offset, sizeof(header.offset)) == 0);
+}
+
+/**
+ * Addiert eine Zeile Bytes auf die Summen einer Zeile, mit SIMD fuer 16 Bytes gleichzeitig
+ * @param row Zeile der Stufe
+ * @param rowBytes Laenge der Zeile in Byte
+ * @param sums Summen (In/Out)
+ */
+static void accumulateRow(const GLubyte *row, GLint rowBytes, GLushort *sums)
+{
+  GLint i = 0;
+#if SIMD_WIDTH > 1
+  __m128i zero = _mm_setzero_si128();
+  __m128i a;
+  __m128i lo;
+  __m128i hi;
+
+  for (; i + 16 <= rowBytes; i += 16)
+  {
+    a = _mm_loadu_si128((const __m128i *)(row + i));
+    lo = _mm_loadu_si128((const __m128i *)(sums + i));
+    hi = _mm_loadu_si128((const __m128i *)(sums + i + 8));
+    _mm_storeu_si128((__m128i *)(sums + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(a, zero)));
+    _mm_storeu_si128((__m128i *)(sums + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(a, zero)));
+  }
+#endif
+  for (; i < rowBytes; i++)
+  {
+    sums[i] = (GLushort)(sums[i] + row[i]);
+  }
+}
+
+/**
+ * Verkleinert eine Stufe mit einem Boxfilter auf die naechste. Jeder Pixel
+ * mittelt 2 x 2 Pixel; bei ungerader Kantenlaenge nimmt der letzte Pixel der
+ * Zeile bzw. Spalte die uebrige Spalte bzw. Zeile mit auf (3 statt 2 Werte),
+ * damit kein Randpixel verloren geht und die Stufen deckungsgleich bleiben.
+ * Bei Kantenlaenge 1 wird die einzige Zeile bzw. Spalte doppelt gezaehlt.
+ * Die senkrechten Summen werden mit SIMD fuer 16 Bytes gleichzeitig gebildet,
+ * danach werden je zwei (bzw. drei) benachbarte Summen gemittelt.
+ * @param src Pixel der Stufe
+ * @param width Breite der Stufe
+ * @param height Hoehe der Stufe
+ * @param channels Kanaele pro Pixel
+ * @param dst Ziel fuer die Pixel der naechsten Stufe
+ * @param sums Zwischenspeicher fuer width * channels Summen
+ */
+static void downsampleLevel(const GLubyte *src, GLint width, GLint height, GLint channels, GLubyte *dst,
+                            GLushort *sums)
+{
+  GLint outWidth = levelSize(width, 1);
+  GLint outHeight = levelSize(height, 1);
+  GLint rowBytes = width * channels;
+  GLint rows = 0;
+  GLint columns = 0;
+  GLint count = 0;
+  GLint sum = 0;
+  GLubyte *out = NULL;
+  GLint left = 0;
+  GLint x = 0;
+  GLint y = 0;
+  GLint c = 0;
+  GLint k = 0;
+
+  for (y = 0; y < outHeight; y++)
+  {
+    //die letzte Zeile einer ungeraden Stufe gehoert zum letzten Pixel der Spalte
+    rows = ((y == outHeight - 1) && (height % 2 == 1) && (height > 1)) ? 3 : 2;
+    memset(sums, 0, sizeof(GLushort) * rowBytes);
+    for (k = 0; k < rows; k++)
+    {
+      accumulateRow(src + (size_t)MIN(2 * y + k, height - 1) * rowBytes, rowBytes, sums);
+    }
+
+    out = dst + (size_t)y * outWidth * channels;
+    for (x = 0; x < outWidth; x++)
+    {
+      columns = ((x == outWidth - 1) && (width % 2 == 1) && (width > 1)) ? 3 : 2;
+      count = rows * columns;
+      for (k = 0; k < channels; k++)
+      {
+        sum = 0;
+        for (c = 0; c < columns; c++)
+        {
+          left = MIN(2 * x + c, width - 1) * channels;
+          sum += sums[left + k];
+        }
+        out[x * channels + k] = (GLubyte)((sum + count / 2) / count);
+      }
+    }
+  }
+}
+
+/**
+ * Erzeugt das Speicherabbild einer Cache-Datei aus einem dekodierten Bild
+ * @param pixels Pixel des Bildes
+ * @param width Breite
+ * @param height Hoehe
+ * @param channels Kanaele pro Pixel
+ * @param sourceHash Hashwert der Quelldatei
+ * @param sourceSize Groesse der Quelldatei in Byte
+ * @param size Groesse des Speicherabbilds in Byte (Out)
+ * @return Speicherabbild (mit free freizugeben)
+ */
+static char *buildMipFile(const GLubyte *pixels, GLint width, GLint height, GLint channels, uint64_t sourceHash,
+                          uint64_t sourceSize, size_t *size)
+{
+  MipHeader header;
+  char *data = NULL;
+  GLushort *sums = NULL;
+  GLint level = 0;
+
+  memset(&header, 0, sizeof(MipHeader));
+  memcpy(header.magic, MIP_MAGIC, sizeof(header.magic));
+  header.formatVersion = MIP_FORMAT_VERSION;
+  header.width = (uint32_t)width;
+  header.height = (uint32_t)height;
+  header.channels = (uint32_t)channels;
+  header.sourceHash = sourceHash;
+  header.sourceSize = sourceSize;
+  *size = layoutMipFile(&header);
+
+  //mit Nullen vorbelegt, damit auch die Auffuellung der Datei festgelegt ist
+  data = calloc(*size, 1);
+  sums = malloc(sizeof(GLushort) * width * channels);
+  if ((data == NULL) || (sums == NULL))
+  {
+    exit(1);
+  }
+
+  memcpy(data, &header, sizeof(MipHeader));
+  memcpy(data + header.offset[0], pixels, (size_t)width * height * channels);
+  for (level = 1; level < (GLint)header.levels; level++)
+  {
+    downsampleLevel((const GLubyte *)(data + header.offset[level - 1]), levelSize(width, level - 1),
+                    levelSize(height, level - 1), channels, (GLubyte *)(data + header.offset[level]), sums);
+  }
+
+  free(sums);
+  return data;
+}
+
+/**
+ * Schreibt eine Cache-Datei ueber eine temporaere Datei, damit parallel
+ * startende Programme nie eine halb geschriebene Datei einblenden. Der Name
+ * der temporaeren Datei enthaelt die Prozess-ID und den Ladevorgang und ist
+ * damit ueber Prozesse und Threads hinweg eindeutig.
+ * @param path Pfad der Cache-Datei
+ * @param data Speicherabbild
+ * @param size Groesse in Byte
+ * @param load Ladevorgang (fuer einen eindeutigen temporaeren Namen)
+ */
+static void writeMipFile(const char *path, const char *data, size_t size, const TextureLoad *load)
+{
+  char tempFile[FILENAME_MAX + 48];
+  unsigned long process = 0;
+  FILE *file = NULL;
+  GLboolean written = GL_FALSE;
+
+  //existiert das Verzeichnis schon, schlaegt das Anlegen einfach fehl
+#ifndef WIN32
+  mkdir(TEXTURE_CACHE_DIR, 0755);
+#else
+  _mkdir(TEXTURE_CACHE_DIR);
+#endif
+
+#ifndef WIN32
+  process = (unsigned long)getpid();
+#else
+  process = (unsigned long)_getpid();
+#endif
+  snprintf(tempFile, sizeof(tempFile), "%s.%lu.%lx.tmp", path, process, (unsigned long)(uintptr_t)load);
+  file = fopen(tempFile, "wb");
+  if (file != NULL)
+  {
+    written = fwrite(data, 1, size, file) == size;
+    written = (fclose(file) == 0) && written;
+  }
+
+  if (!written || (rename(tempFile, path) != 0))
+  {
+    fprintf(stderr, "Textur-Cache %s konnte nicht geschrieben werden\n", path);
+    remove(tempFile);
+  }
+}
+
+/**
+ * Laedt ein Bild aus dem Cache oder dekodiert es und legt die Cache-Datei an
+ * @param load Ladevorgang (In/Out)
+ */
+static void loadTexture(TextureLoad *load)
+{
+  char cachePath[FILENAME_MAX];
+  size_t sourceSize = 0;
+  unsigned char *source = (unsigned char *)readFile(load->path, &sourceSize);
+  uint64_t sourceHash = 0;
+  stbi_uc *pixels = NULL;
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  MipHeader header;
+  GLint level = 0;
+
+  if (source != NULL)
+  {
+    sourceHash = hashBytes(source, sourceSize);
+    snprintf(cachePath, sizeof(cachePath), "%s/%016llx.mip", TEXTURE_CACHE_DIR, (unsigned long long)sourceHash);
+
+    load->data = mapFile(cachePath, &load->size);
+    load->mapped = load->data != NULL;
+    if (load->mapped && !isValidMipFile(load->data, load->size, sourceHash, sourceSize))
+    {
+      unmapFile(load->data, load->size);
+      load->data = NULL;
+      load->mapped = GL_FALSE;
+    }
+
+    if (load->data == NULL)
+    {
+      pixels = stbi_load_from_memory(source, (int)sourceSize, &width, &height, &channels, 0);
+      if ((pixels != NULL) && (width <= (1 << (TEXTURE_MAX_LEVELS - 1))) && (height <= (1 << (TEXTURE_MAX_LEVELS - 1))))
+      {
+        load->data = buildMipFile(pixels, width, height, channels, sourceHash, sourceSize, &load->size);
+        writeMipFile(cachePath, load->data, load->size, load);
+      }
+      stbi_image_free(pixels);
+    }
+    free(source);
+  }
+
+  if (load->data != NULL)
+  {
+    memcpy(&header, load->data, sizeof(MipHeader));
+    load->chain.width = (GLint)header.width;
+    load->chain.height = (GLint)header.height;
+    load->chain.channels = (GLint)header.channels;
+    load->chain.levels = (GLint)header.levels;
+    for (level = 0; level < load->chain.levels; level++)
+    {
+      load->chain.pixels[level] = (const GLubyte *)(load->data + header.offset[level]);
+    }
+    load->valid = GL_TRUE;
+  }
+}
+
+#ifndef WIN32
+/**
+ * Einstiegspunkt eines Lade-Threads
+ * @param arg Ladevorgang
+ * @return immer NULL
+ */
+static void *runTextureLoad(void *arg)
+{
+  TextureLoad *load = arg;
+
+  loadTexture(load);
+  ATOMIC_STORE(&load->done, 1);
+  return NULL;
+}
+#endif
+
+TextureLoad *startTextureLoad(const char *path)
+{
+  TextureLoad *load = calloc(1, sizeof(TextureLoad));
+
+  if (load != NULL)
+  {
+    load->path = path;
+#ifndef WIN32
+    load->threaded = pthread_create(&load->thread, NULL, runTextureLoad, load) == 0;
+    if (!load->threaded)
+    {
+      runTextureLoad(load);
+    }
+#else
+    loadTexture(load);
+#endif
+  }
+  return load;
+}
+
+GLboolean pollTextureLoad(TextureLoad *load)
+{
+#ifndef WIN32
+  return ATOMIC_LOAD(&load->done) != 0;
+#else
+  (void)load;
+  return GL_TRUE;
+#endif
+}
+
+const MipChain *getTextureMips(const TextureLoad *load)
+{
+  return load->valid ? &load->chain : NULL;
+}
+
+void finishTextureLoad(TextureLoad *load)
+{
+  if (load != NULL)
+  {
+#ifndef WIN32
+    if (load->threaded)
+    {
+      pthread_join(load->thread, NULL);
+    }
+#endif
+    if (load->mapped)
+    {
+      unmapFile(load->data, load->size);
+    }
+    else
+    {
+      free((void *)load->data);
+    }
+    free(load);
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef __TEXTURE_LOADER_H__
+#define __TEXTURE_LOADER_H__
+/**
+ * @file
+ * Schnittstelle des Texturlader-Moduls.
+ * Das Modul laedt Bilddateien im Hintergrund (je Datei ein eigener Thread)
+ * und liefert sie mit allen Mip-Stufen. Die Stufen werden einmalig mit
+ * einem Boxfilter berechnet und in einem Cache-Verzeichnis als rohe,
+ * direkt einblendbare Datei abgelegt, deren Name aus dem Hashwert der
+ * Quelldatei gebildet wird. Bei weiteren Starts wird nur noch die Quelldatei
+ * gehasht und die passende Cache-Datei eingeblendet, dekodiert wird nicht mehr.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/** Hoechstzahl der Mip-Stufen (Kantenlaenge bis 32768) */
+#define TEXTURE_MAX_LEVELS (16)
+
+/**
+ * Bild mit allen Mip-Stufen bis 1 x 1. Stufe l ist max(1, width >> l) x
+ * max(1, height >> l) Pixel gross, die Zeilen liegen ohne Auffuellung hintereinander.
+ */
+typedef struct
+{
+  GLint width;
+  GLint height;
+  /** Kanaele pro Pixel (1 bis 4, je ein Byte) */
+  GLint channels;
+  GLint levels;
+  const GLubyte *pixels[TEXTURE_MAX_LEVELS];
+} MipChain;
+
+/**
+ * Laufender oder abgeschlossener Ladevorgang
+ */
+typedef struct TextureLoad TextureLoad;
+
+/**
+ * Beginnt das Laden einer Bilddatei. Ohne Threads (WIN32) wird sofort
+ * vollstaendig geladen.
+ * @param path Pfad der Bilddatei (JPEG, PNG, ...), muss bis finishTextureLoad gueltig bleiben
+ * @return Ladevorgang, NULL wenn kein Speicher verfuegbar ist
+ */
+TextureLoad *startTextureLoad(const char *path);
+
+/**
+ * Prueft, ohne zu warten, ob ein Ladevorgang abgeschlossen ist
+ * @param load Ladevorgang
+ * @return GL_TRUE, wenn das Laden (erfolgreich oder nicht) beendet ist
+ */
+GLboolean pollTextureLoad(TextureLoad *load);
+
+/**
+ * Liefert das geladene Bild eines abgeschlossenen Ladevorgangs
+ * @param load Ladevorgang, fuer den pollTextureLoad GL_TRUE geliefert hat
+ * @return Bild mit allen Mip-Stufen, NULL wenn das Laden fehlgeschlagen ist
+ */
+const MipChain *getTextureMips(const TextureLoad *load);
+
+/**
+ * Wartet auf das Ende eines Ladevorgangs und gibt ihn mitsamt Bild frei
+ * @param load Ladevorgang
+ */
+void finishTextureLoad(TextureLoad *load);
+
+#endif
@@ -16,6 +16,9 @@
 #include <windows.h>
 #endif
 
+/* GLEW muss vor allen anderen OpenGL-Headern eingebunden werden */
+#include <GL/glew.h>
+
 #ifdef __APPLE__
 #include <OpenGL/gl.h>
 #else
@@ -25,6 +28,11 @@
 /** Makro, um das Quadrat einer Zahl zu bestimmen*/
 #define SQUARE(x) ((x) * (x))
 
+/** Naechster Punkt einer Zeile bzw. Spalte nach v, der eine Kugel traegt:
+ *  jeder stride-te Punkt und immer der letzte (side - 1) */
+#define NEXT_SPHERE_POINT(v, stride, side) \
+  ((((v) < (side) - 1) && ((v) + (stride) > (side) - 1)) ? (side) - 1 : (v) + (stride))
+
 /* ---- Konstanten ---- */
 // Default Fenster Groesse
 #define DEFAULT_WINDOW_WIDTH 600
@@ -37,23 +45,35 @@
 #define CY (1)
 #define CZ (2)
 
-#define CR (3)
-#define CG (4)
-#define CB (5)
-
-#define CNX (6)
-#define CNY (7)
-#define CNZ (8)
-
-#define CTX (9)
-#define CTY (10)
+/** Skalierung der als GLbyte gespeicherten Normalenkomponenten */
+#define NORMAL_SCALE (127.0f)
 
-//Typdefinition fuer einen Vertex
-typedef GLfloat Vertex[11];
+/**
+ * Typdefinition fuer den veraenderlichen Teil eines Vertex des Wasser-Mesh.
+ * Normale und Farbe sind gepackt (je 4 Byte), so dass pro Vertex 20 statt
+ * 44 Byte hochgeladen werden. Die Texturkoordinaten aendern sich nicht und
+ * liegen in einem eigenen, statischen Pufferobjekt.
+ */
+typedef struct
+{
+  /** Position (x, y, z), Index ueber CX, CY, CZ */
+  GLfloat position[3];
+  /** Normale, Komponenten mit NORMAL_SCALE skaliert, 4. Byte ungenutzt */
+  GLbyte normal[4];
+  /** Farbe als RGBA8 */
+  GLubyte color[4];
+} Vertex;
 
 //Anzahl der Punkte pro Seite, aus denen das Mesh initial aufgebaut ist
 #define START_AMOUNT_VERTICES (15)
 
+//Grenzen fuer die Anzahl der Punkte pro Seite, verfeinerte Kacheln rechnen doppelt so fein
+#define MAX_AMOUNT_VERTICES (2048)
+#define MIN_AMOUNT_VERTICES (2)
+
+
+/** Anzahl der Boote in der Szene */
+#define AMOUNT_BOATS (2)
 
 #define BOAT_1_X (0.52f)
 #define BOAT_1_Z (-0.57f)
@@ -83,13 +103,32 @@ typedef enum e_light1State
   off
 } light1State;
 
-
-/** enum fuer die Anpassung des Mesh*/
-typedef enum e_expandShrinkVertices
+/**
+ * Anstoss der Wasseroberflaeche (z.B. Pick, Regentropfen, Bugwelle): die
+ * Amplitude wird mit einem glatten Kern ueber einen Kreis verteilt
+ */
+typedef struct
 {
-  expand = 1,
-  shrink = -1
-} expandShrinkVertices;
+  /** Mittelpunkt in der xz-Ebene ueber [-1, 1] */
+  GLfloat x;
+  GLfloat z;
+  /** Radius des Kreises in Szeneneinheiten */
+  GLfloat radius;
+  /** Hoehenaenderung im Mittelpunkt */
+  GLfloat amplitude;
+} Impulse;
+
+/** enum fuer das Verfahren, mit dem die Hoehen des Wassers berechnet werden */
+typedef enum e_waterSolver
+{
+  explicitSolver,
+  implicitSolver,
+  spectralSolver
+} waterSolver;
+
+/** Anzahl der Verfahren fuer das Wasser */
+#define AMOUNT_WATER_SOLVERS (3)
+
 
 /** Mausereignisse */
 enum e_MouseEventType
@@ -0,0 +1,251 @@
+/**
+ * @file
+ * Worker-Modul.
+ * Das Modul kapselt einen Pool persistenter Threads, auf denen rechenintensive
+ * Aufgaben (insbesondere die Wassersimulation) parallel ausgefuehrt werden.
+ * Zwischen zwei Auftraegen schlafen die Threads auf einer Bedingungsvariable,
+ * innerhalb eines Auftrags synchronisieren sie sich ueber eine kurz wartende
+ * (spinnende) Barriere, da diese pro Simulationsschritt durchlaufen wird.
+ *
+ * Unter Windows steht kein pthread zur Verfuegung, dort werden alle
+ * Auftraege vom aufrufenden Thread allein ausgefuehrt.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Standard Header einbinden ---- */
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdint.h>
+#endif
+
+/* ---- Eigene Header einbinden ---- */
+#include "workers.h"
+#include "atomics.h"
+
+/** Anzahl der Durchlaeufe, die an der Barriere aktiv gewartet wird, bevor die CPU abgegeben wird */
+#define BARRIER_SPINS (4096)
+
+/** Anzahl der Worker inkl. des aufrufenden Threads */
+static GLint g_workerCount = 1;
+
+#ifndef WIN32
+/** Worker-Threads (Worker 1 bis g_workerCount - 1) */
+static pthread_t *g_threads = NULL;
+
+/** Schuetzt die Verwaltung der Auftraege */
+static pthread_mutex_t g_jobMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Signalisiert einen neuen Auftrag oder das Beenden */
+static pthread_cond_t g_jobCond = PTHREAD_COND_INITIALIZER;
+
+/** Signalisiert, dass alle Worker eines Auftrags fertig sind */
+static pthread_cond_t g_doneCond = PTHREAD_COND_INITIALIZER;
+
+/** aktueller Auftrag und dessen Argument */
+static WorkerJob g_job = NULL;
+static void *g_jobArg = NULL;
+
+/** Anzahl der Worker, die am aktuellen Auftrag beteiligt sind */
+static GLint g_jobWorkers = 1;
+
+/** Zaehler der erteilten Auftraege, daran erkennen die Threads neue Auftraege */
+static GLuint g_jobGeneration = 0;
+
+/** Anzahl der Threads, die den aktuellen Auftrag noch bearbeiten */
+static GLint g_jobPending = 0;
+
+/** Flag zum Beenden der Threads */
+static GLboolean g_shutdown = GL_FALSE;
+
+/** Anzahl der Worker, die die Barriere bereits erreicht haben */
+static GLint g_barrierCount = 0;
+
+/** Durchlaeufe der Barriere, daran erkennen die wartenden Worker das Oeffnen */
+static GLuint g_barrierGeneration = 0;
+
+/**
+ * Hauptfunktion eines Worker-Threads: wartet auf Auftraege und fuehrt sie aus
+ * @param arg Nummer des Workers
+ * @return immer NULL
+ */
+static void *workerMain(void *arg)
+{
+  GLint worker = (GLint)(intptr_t)arg;
+  GLuint seenGeneration = 0;
+  WorkerJob job = NULL;
+  void *jobArg = NULL;
+  GLint jobWorkers = 0;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&g_jobMutex);
+    while (!g_shutdown && (g_jobGeneration == seenGeneration))
+    {
+      pthread_cond_wait(&g_jobCond, &g_jobMutex);
+    }
+    if (g_shutdown)
+    {
+      pthread_mutex_unlock(&g_jobMutex);
+      break;
+    }
+    seenGeneration = g_jobGeneration;
+    job = g_job;
+    jobArg = g_jobArg;
+    jobWorkers = g_jobWorkers;
+    pthread_mutex_unlock(&g_jobMutex);
+
+    //nicht beteiligte Worker warten direkt auf den naechsten Auftrag
+    if (worker < jobWorkers)
+    {
+      job(worker, jobWorkers, jobArg);
+
+      pthread_mutex_lock(&g_jobMutex);
+      g_jobPending--;
+      if (g_jobPending == 0)
+      {
+        pthread_cond_signal(&g_doneCond);
+      }
+      pthread_mutex_unlock(&g_jobMutex);
+    }
+  }
+  return NULL;
+}
+#endif
+
+void initWorkers(GLint count)
+{
+#ifndef WIN32
+  GLint i = 0;
+
+  if (count < 1)
+  {
+    count = (GLint)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (count < 1)
+  {
+    count = 1;
+  }
+
+  g_threads = malloc(sizeof(pthread_t) * count);
+  if (g_threads == NULL)
+  {
+    exit(1);
+  }
+
+  //Worker 0 ist der aufrufende Thread
+  g_workerCount = 1;
+  for (i = 1; i < count; i++)
+  {
+    if (pthread_create(&g_threads[i], NULL, workerMain, (void *)(intptr_t)i) != 0)
+    {
+      fprintf(stderr, "Es konnten nur %d Worker-Threads erzeugt werden\n", i);
+      break;
+    }
+    g_workerCount++;
+  }
+#else
+  (void)count;
+  g_workerCount = 1;
+#endif
+}
+
+GLint getWorkerCount(void)
+{
+  return g_workerCount;
+}
+
+void runOnWorkers(WorkerJob job, void *arg, GLint count)
+{
+  if (count > g_workerCount)
+  {
+    count = g_workerCount;
+  }
+
+  if (count <= 1)
+  {
+#ifndef WIN32
+    //Barrieren im Auftrag duerfen nicht auf die Worker eines frueheren Auftrags warten
+    g_jobWorkers = 1;
+#endif
+    job(0, 1, arg);
+  }
+#ifndef WIN32
+  else
+  {
+    pthread_mutex_lock(&g_jobMutex);
+    g_job = job;
+    g_jobArg = arg;
+    g_jobWorkers = count;
+    g_jobPending = count - 1;
+    g_barrierCount = 0;
+    g_jobGeneration++;
+    pthread_cond_broadcast(&g_jobCond);
+    pthread_mutex_unlock(&g_jobMutex);
+
+    job(0, count, arg);
+
+    pthread_mutex_lock(&g_jobMutex);
+    while (g_jobPending > 0)
+    {
+      pthread_cond_wait(&g_doneCond, &g_jobMutex);
+    }
+    pthread_mutex_unlock(&g_jobMutex);
+  }
+#endif
+}
+
+void waitAtBarrier(void)
+{
+#ifndef WIN32
+  GLuint generation = ATOMIC_LOAD(&g_barrierGeneration);
+  GLint spins = 0;
+
+  if (g_jobWorkers <= 1)
+  {
+    return;
+  }
+
+  if (ATOMIC_ADD_FETCH(&g_barrierCount, 1) == g_jobWorkers)
+  {
+    //letzter Worker oeffnet die Barriere
+    ATOMIC_STORE(&g_barrierCount, 0);
+    ATOMIC_STORE(&g_barrierGeneration, generation + 1);
+  }
+  else
+  {
+    while (ATOMIC_LOAD(&g_barrierGeneration) == generation)
+    {
+      if (++spins > BARRIER_SPINS)
+      {
+        sched_yield();
+      }
+    }
+  }
+#endif
+}
+
+void freeWorkers(void)
+{
+#ifndef WIN32
+  GLint i = 0;
+
+  pthread_mutex_lock(&g_jobMutex);
+  g_shutdown = GL_TRUE;
+  pthread_cond_broadcast(&g_jobCond);
+  pthread_mutex_unlock(&g_jobMutex);
+
+  for (i = 1; i < g_workerCount; i++)
+  {
+    pthread_join(g_threads[i], NULL);
+  }
+  free(g_threads);
+  g_threads = NULL;
+#endif
+  g_workerCount = 1;
+}
@@ -0,0 +1,58 @@
+#ifndef __WORKERS_H__
+#define __WORKERS_H__
+/**
+ * @file
+ * Schnittstelle des Worker-Moduls.
+ * Das Modul kapselt einen Pool persistenter Threads, auf denen rechenintensive
+ * Aufgaben (insbesondere die Wassersimulation) parallel ausgefuehrt werden.
+ * Die Threads werden einmalig erzeugt und warten zwischen zwei Auftraegen.
+ *
+ * @author Mario da Graca, Leonhard Brandes
+ */
+
+/* ---- Eigene Header einbinden ---- */
+#include "types.h"
+
+/**
+ * Auftrag, der parallel auf mehreren Workern ausgefuehrt wird
+ * @param worker Nummer des ausfuehrenden Workers (0 bis workerCount - 1)
+ * @param workerCount Anzahl der Worker, die den Auftrag gemeinsam bearbeiten
+ * @param arg Argument des Auftrags
+ */
+typedef void (*WorkerJob)(GLint worker, GLint workerCount, void *arg);
+
+/**
+ * Erzeugt den Pool der Worker-Threads.
+ * @param count Anzahl der Worker inkl. des aufrufenden Threads,
+ *        bei einem Wert kleiner 1 wird die Anzahl der Prozessorkerne verwendet
+ */
+void initWorkers(GLint count);
+
+/**
+ * Liefert die Anzahl der verfuegbaren Worker inkl. des aufrufenden Threads
+ * @return Anzahl der Worker
+ */
+GLint getWorkerCount(void);
+
+/**
+ * Fuehrt einen Auftrag auf den Workern aus und kehrt zurueck, wenn alle
+ * beteiligten Worker fertig sind. Der aufrufende Thread arbeitet als Worker 0 mit.
+ * @param job auszufuehrender Auftrag
+ * @param arg Argument des Auftrags
+ * @param count Anzahl der beteiligten Worker (wird auf 1 bis getWorkerCount() begrenzt)
+ */
+void runOnWorkers(WorkerJob job, void *arg, GLint count);
+
+/**
+ * Barriere fuer die Worker eines laufenden Auftrags: kehrt erst zurueck,
+ * wenn alle beteiligten Worker die Barriere erreicht haben.
+ * Darf nur innerhalb eines Auftrags aufgerufen werden.
+ */
+void waitAtBarrier(void);
+
+/**
+ * Beendet die Worker-Threads und gibt den Speicher des Pools frei
+ */
+void freeWorkers(void);
+
+#endif
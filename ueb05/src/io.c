@@ -52,6 +52,7 @@ static void printHelp(void)
   printf("'s'/'S': Sepia-Shading an-/ausschaltern.\n");
   printf("'g'/'G': Gray-Shading an-/ausschaltern.\n");
   printf("'+'/'-': Staerke der Verschiebung durch die Heightmap anpassen.\n");
+  printf("'*'/'/': Aufloesung des Meshes verdoppeln/halbieren.\n");
   printf("F1: Schaltet zwischen WireFrame und Flaechendarstellung um.\n");
   printf("F2: Normalen Anzeige an-/aussschalten.\n");
   printf("F3: Heightmap Anzeige an-/aussschalten.\n");
@@ -274,6 +275,14 @@ handleKeyboardEvent(unsigned char key, int status, GLboolean isSpecialKey, int x
       case '-':
         setElevation(-ELEVATION_VALUE);
         break;
+      /* Aufloesung verdoppeln */
+      case '*':
+        setMeshResolution(getMeshResolution() * 2);
+        break;
+      /* Aufloesung halbieren */
+      case '/':
+        setMeshResolution(getMeshResolution() / 2);
+        break;
       }
     }
   }
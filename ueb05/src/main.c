@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* ---- Eigene Header einbinden ---- */
 #include "utility.h"
@@ -18,6 +19,31 @@
 #include "types.h"
 #include "io.h"
 
+/**
+ * Wertet die Kommandozeilenparameter aus (nach glutInit, das seine eigenen
+ * Parameter entfernt).
+ * Unterstuetzt wird --resolution N fuer die Anzahl der Vertices pro Seite
+ * des Meshes.
+ * @param argc Anzahl der Kommandozeilenparameter (In).
+ * @param argv Kommandozeilenparameter (In).
+ */
+static void parseArguments(int argc, char **argv)
+{
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((strcmp(argv[i], "--resolution") == 0) && (i + 1 < argc))
+    {
+      setMeshResolution(atoi(argv[++i]));
+    }
+    else
+    {
+      fprintf(stderr, "Unbekannter Parameter: %s\n", argv[i]);
+    }
+  }
+}
+
 /**
  * Hauptprogramm.
  * Initialisiert Fenster, Anwendung und Callbacks, startet glutMainLoop.
@@ -31,6 +57,7 @@ int main(int argc, char **argv)
 
   /* Glut initialisieren */
   glutInit(&argc, argv);
+  parseArguments(argc, argv);
 
   /* Erzeugen des Fensters */
   if (!createWindow("Shader", DEFAULT_WINDOW_SIZE, DEFAULT_WINDOW_SIZE))
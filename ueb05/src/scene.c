@@ -13,6 +13,8 @@
 #ifdef WIN32
 #include <windows.h>
 #endif
+#include <stdio.h>
+#include <stdlib.h>
 #include "utility.h"
 
 #include "scene.h"
@@ -38,14 +40,18 @@
 
 /** Makro, um das Quadrat einer Zahl zu bestimmen*/
 #define SQUARE(x) ((x) * (x))
-/** Anzahl der Vertices pro Seite, aus denen das Mesh erzeugt wird */
-#define MESH_AMOUNT_VERTICES (314)
-/** Anzahl an Indizes die zum Zeichnen benoetigt werden */
-#define AMOUNT_INDICES (SQUARE(MESH_AMOUNT_VERTICES - 1) * 2 * 3)
+/** Voreingestellte Anzahl der Vertices pro Seite, aus denen das Mesh erzeugt wird */
+#define MESH_DEFAULT_VERTICES (314)
+/** Grenzen fuer die Anzahl der Vertices pro Seite */
+#define MESH_MIN_VERTICES (2)
+#define MESH_MAX_VERTICES (4096)
 
 /** Buffer-Objekt, um die Vertizes zu speichern. */
 static GLuint g_arrayBuffer;
 
+/** Buffer-Objekt, um die Indizes der Dreiecke zu speichern. */
+static GLuint g_indexBuffer;
+
 /** Vertex-Array-Objekt, um die Attribut-Pointer zu speichern. */
 static GLuint g_vertexArrayObject;
 
@@ -75,12 +81,11 @@ static GLuint g_locationLightPos;
 static GLuint g_locationAmountVertices;
 static GLuint g_locationDebugState;
 
-// Index-Array
-static GLint g_indexArray[AMOUNT_INDICES];
-// Vertex-Array mit allen benoetigten Infos zu allen Vertices
-static Vertex g_vertices[AMOUNT_INDICES];
-// Zwischenspeicher
-static Vertex helper[SQUARE(MESH_AMOUNT_VERTICES)];
+/** Anzahl der Vertices pro Seite des Meshes */
+static GLint g_amountVertices = MESH_DEFAULT_VERTICES;
+
+/** Anzahl der Indizes im Index-Buffer */
+static GLsizei g_amountIndices = 0;
 
 //Statusvariablen
 static effectState currEffect;
@@ -90,95 +95,105 @@ static GLdouble g_timer = 0.0f;
 
 /**
  * Fuellt das Index Array
+ * Die beiden Dreiecke einer Zelle folgen direkt aufeinander, damit sich
+ * moeglichst viele Vertizes im Post-Transform-Cache wiederverwenden lassen.
  * 
+ * @param indexArray; Ziel fuer SQUARE(amountVertices - 1) * 6 Indizes
+ * @param amountVertices; Anzahl der Vertices pro Seite
 */
-static void fillIndexArray(void)
+static void fillIndexArray(GLuint *indexArray, GLint amountVertices)
 {
-    GLint i = 0;
-    GLint countUpperTri = 0;
-    GLint countLowerTri = 0;
-    GLint rowCount = -1;
-    GLboolean upperTri = GL_FALSE;
-    for (i = 0; i < AMOUNT_INDICES; i += 3)
+    size_t i = 0;
+    GLuint row = 0;
+    GLuint col = 0;
+    GLuint corner = 0;
+    GLuint side = (GLuint)amountVertices;
+    for (row = 0; row < side - 1; row++)
     {
-        //Jede Reihe besteht aus einer Reihe normaler Dreiecke und einer Reihe die auf dem Kopf steht
-        if (upperTri && (countUpperTri % (MESH_AMOUNT_VERTICES - 1) == 0))
+        for (col = 0; col < side - 1; col++)
         {
-            upperTri = GL_FALSE;
-        }
-        else if (!upperTri && (countLowerTri % (MESH_AMOUNT_VERTICES - 1) == 0))
-        {
-            upperTri = GL_TRUE;
-            rowCount++;
-        }
+            corner = row * side + col;
 
-        if (upperTri)
-        {
-            g_indexArray[i] = countUpperTri + rowCount;
-            g_indexArray[i + 1] = countUpperTri + MESH_AMOUNT_VERTICES + rowCount;
-            g_indexArray[i + 2] = countUpperTri + 1 + rowCount;
-            countUpperTri++;
-        }
-        else
-        {
-            g_indexArray[i] = countLowerTri + 1 + rowCount;
-            g_indexArray[i + 1] = countLowerTri + MESH_AMOUNT_VERTICES + rowCount;
-            g_indexArray[i + 2] = countLowerTri + MESH_AMOUNT_VERTICES + 1 + rowCount;
-            countLowerTri++;
+            //oberes Dreieck
+            indexArray[i++] = corner;
+            indexArray[i++] = corner + side;
+            indexArray[i++] = corner + 1;
+
+            //unteres Dreieck
+            indexArray[i++] = corner + 1;
+            indexArray[i++] = corner + side;
+            indexArray[i++] = corner + side + 1;
         }
     }
 }
 
 /**
- * Fuellt das Zwischenstands-Array aus dem spaeter das Vertex Array zusammenggesetzt wird
- * Enthaelt jeden Punkt genau einmal
+ * Fuellt das Vertex Array, das ueber das Index Array gezeichnet wird
+ * Enthaelt jeden Punkt genau einmal, die Koordinaten werden je Punkt aus
+ * Zeile und Spalte berechnet (kein Aufsummieren von Rundungsfehlern)
+ * 
+ * @param helper; Ziel fuer SQUARE(amountVertices) Vertizes
+ * @param amountVertices; Anzahl der Vertices pro Seite
 */
-static void fillHelperArray(void)
+static void fillHelperArray(Vertex *helper, GLint amountVertices)
 {
-    GLint i = 0;
-    GLfloat currX = -1.0f;
-    GLfloat currZ = -1.0f - (2.0f / (MESH_AMOUNT_VERTICES - 1));
-    GLfloat currTexS = 0.0f;
-    GLfloat currTexT = 1.0f + 1.0f / (MESH_AMOUNT_VERTICES - 1);
+    size_t i = 0;
+    GLint row = 0;
+    GLint col = 0;
+    GLfloat step = 1.0f / (amountVertices - 1);
 
-    for (i = 0; i < SQUARE(MESH_AMOUNT_VERTICES); i++)
+    for (row = 0; row < amountVertices; row++)
     {
-        if (i % MESH_AMOUNT_VERTICES == 0)
+        for (col = 0; col < amountVertices; col++)
         {
-            currX = -1.0f;
-            currZ += 2.0f / (MESH_AMOUNT_VERTICES - 1);
-            currTexS = 0.0f;
-            currTexT -= 1.0f / (MESH_AMOUNT_VERTICES - 1);
+            helper[i].x = -1.0f + 2.0f * col * step;
+            helper[i].y = 0.0f;
+            helper[i].z = -1.0f + 2.0f * row * step;
+            helper[i].s = col * step;
+            helper[i].t = 1.0f - row * step;
+            helper[i].nx = 0.0f;
+            helper[i].ny = 1.0f;
+            helper[i].nz = 0.0f;
+            i++;
         }
-        else
-        {
-            currX += 2.0f / (MESH_AMOUNT_VERTICES - 1);
-            currTexS += 1.0f / (MESH_AMOUNT_VERTICES - 1);
-        }
-
-        helper[i].x = currX;
-        helper[i].y = 0.0f;
-        helper[i].z = currZ;
-        helper[i].s = currTexS;
-        helper[i].t = currTexT;
-        helper[i].nx = 0.0f;
-        helper[i].ny = 1.0f;
-        helper[i].nz = 0.0f;
     }
 }
 
 /**
- * Alle benoetigten Vertices, um das Mesh zu konstruieren
- * Enthaelt Punkte auch mehrfach
- * 
+ * Erzeugt Vertizes und Indizes des Meshes in der aktuellen Aufloesung und
+ * laedt sie in die Buffer-Objekte. Die Arrays werden nur fuer das Hochladen
+ * angelegt und danach wieder freigegeben.
 */
-static void fillVerticesArray(void)
+static void buildMesh(void)
 {
-    GLint i = 0;
-    for (i = 0; i < AMOUNT_INDICES; i++)
+    size_t amountVertices = SQUARE((size_t)g_amountVertices);
+    size_t amountIndices = SQUARE((size_t)g_amountVertices - 1) * 2 * 3;
+    Vertex *helper = malloc(amountVertices * sizeof(Vertex));
+    GLuint *indexArray = malloc(amountIndices * sizeof(GLuint));
+
+    if ((helper == NULL) || (indexArray == NULL))
     {
-        g_vertices[i] = helper[g_indexArray[i]];
+        fprintf(stderr, "Kein Speicher fuer ein Mesh mit %i x %i Vertizes!\n", g_amountVertices, g_amountVertices);
+        exit(1);
     }
+
+    fillIndexArray(indexArray, g_amountVertices);
+    fillHelperArray(helper, g_amountVertices);
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_arrayBuffer);
+    glBufferData(GL_ARRAY_BUFFER, amountVertices * sizeof(Vertex), helper, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    /* Der Index-Buffer ist Teil des VAO-Zustands */
+    glBindVertexArray(g_vertexArrayObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, amountIndices * sizeof(GLuint), indexArray, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    g_amountIndices = (GLsizei)amountIndices;
+
+    free(helper);
+    free(indexArray);
 }
 
 void initScene(void)
@@ -224,10 +239,6 @@ void initScene(void)
         stbi_image_free(worldMap);
     }
 
-    fillIndexArray();
-    fillHelperArray();
-    fillVerticesArray();
-
     {
         /* Erstellen eines Buffer-Objektes. 
      * In modernem OpenGL werden alle Vertex-Daten in Buffer-Objekten 
@@ -249,9 +260,12 @@ void initScene(void)
      * übergeben. OpenGL kann diesen Hinweis nutzen, um Optimierungen
      * vorzunehmen. */
         glGenBuffers(1, &g_arrayBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, g_arrayBuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertices), g_vertices, GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        /* Die Indizes liegen in einem eigenen Buffer-Objekt am Target
+     * GL_ELEMENT_ARRAY_BUFFER. Jeder Punkt wird so nur einmal gespeichert
+     * und kann nach der Transformation wiederverwendet werden.
+     * Gefuellt werden beide Buffer erst in buildMesh. */
+        glGenBuffers(1, &g_indexBuffer);
     }
 
     {
@@ -298,6 +312,10 @@ void initScene(void)
         glEnableVertexAttribArray(normalLocation);
         glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, nx));
 
+        /* Anders als GL_ARRAY_BUFFER ist der gebundene Index-Buffer Teil
+     * des VAO-Zustands und darf deshalb erst nach dem VAO geloest werden. */
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_indexBuffer);
+
         /* Um Programmierfehler leichter zu finden, sollte der OpenGL-
      * Zustand wieder zurückgesetzt werden. Wird beispielweise das Binden
      * eines Vertex-Array-Objekts vergessen werden, arbeitet OpenGL
@@ -305,8 +323,11 @@ void initScene(void)
      * sind diese Fehler schwer zu finden. */
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 
+    buildMesh();
+
     {
         /* Erstellen des Programms */
         g_program = createProgram("../content/shaders/color.vert", "../content/shaders/color.frag");
@@ -347,7 +368,7 @@ void initScene(void)
         glUniform1f(g_locationElevation, 1.0f);
         glUniform1i(g_locationEnableTexture, showTextures);
         glUniform1i(g_locationCurrEffect, currEffect);
-        glUniform1i(g_locationAmountVertices, MESH_AMOUNT_VERTICES);
+        glUniform1i(g_locationAmountVertices, g_amountVertices);
         glUniform1i(g_locationDebugState, currDebugState);
         glUseProgram(0);
     }
@@ -400,10 +421,10 @@ void drawScene(void)
     glBindVertexArray(g_vertexArrayObject);
 
     /* Rendern der Dreiecke.
-   * Ab dem ersten Dreieck im Buffer werden alle Dreiecke gerendert.
-   * Dem Draw-Command wird jedoch die Anzahl der Vertizes übergeben, die
+   * Die Dreiecke werden ueber den Index-Buffer des VAOs gerendert.
+   * Dem Draw-Command wird die Anzahl der Indizes übergeben, die
    * gezeichnet werden sollen. */
-    glDrawArrays(GL_TRIANGLES, 0, AMOUNT_INDICES);
+    glDrawElements(GL_TRIANGLES, g_amountIndices, GL_UNSIGNED_INT, (void *)0);
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -412,6 +433,32 @@ void drawScene(void)
     glUseProgram(0);
 }
 
+void setMeshResolution(GLint amountVertices)
+{
+    amountVertices = amountVertices < MESH_MIN_VERTICES ? MESH_MIN_VERTICES : amountVertices;
+    amountVertices = amountVertices > MESH_MAX_VERTICES ? MESH_MAX_VERTICES : amountVertices;
+
+    if (amountVertices != g_amountVertices)
+    {
+        g_amountVertices = amountVertices;
+
+        //vor initScene wird nur die Aufloesung gemerkt
+        if (g_program != 0)
+        {
+            buildMesh();
+            glUseProgram(g_program);
+            glUniform1i(g_locationAmountVertices, g_amountVertices);
+            glUseProgram(0);
+        }
+        printf("Mesh mit %i x %i Vertizes\n", g_amountVertices, g_amountVertices);
+    }
+}
+
+GLint getMeshResolution(void)
+{
+    return g_amountVertices;
+}
+
 void setEffectState(effectState newEffect)
 {
     currEffect = newEffect;
@@ -15,6 +15,21 @@ void setElevation(GLdouble elevation);
 */
 void setTimer(double interval);
 
+/**
+ * Setzt die Aufloesung des Meshes und baut es neu auf. Vor initScene wird
+ * die Aufloesung nur fuer den ersten Aufbau gemerkt.
+ * 
+ * @param amountVertices; Anzahl der Vertices pro Seite (wird auf 2 bis 4096 begrenzt)
+*/
+void setMeshResolution(GLint amountVertices);
+
+/**
+ * Liefert die Aufloesung des Meshes
+ * 
+ * @return GLint; Anzahl der Vertices pro Seite
+*/
+GLint getMeshResolution(void);
+
 /**
  * Bereitet die Szene vor.
  */